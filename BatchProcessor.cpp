@@ -0,0 +1,402 @@
+#include "BatchProcessor.h"
+#include "LlamaRuntime.h"
+#include "JsonValue.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+
+const char *finishReasonName(FinishReason reason) {
+    switch (reason) {
+    case FINISH_EOG:           return "eog";
+    case FINISH_CONTEXT_FULL:  return "context_full";
+    case FINISH_STOP_SEQUENCE: return "stop";
+    case FINISH_MAX_TOKENS:    return "max_tokens";
+    case FINISH_DEADLINE:      return "deadline";
+    case FINISH_ERROR:         return "error";
+    case FINISH_CANCELLED:     return "cancelled";
+    }
+    return "error";
+}
+
+} // namespace
+
+BatchProcessor::BatchProcessor(LlamaRuntime &runtime, const BatchOptions &options)
+    : runtime(runtime), options(options) {
+    this->options.slots = std::max(this->options.slots, 1);
+    this->options.maxTokens = std::max(this->options.maxTokens, 1);
+}
+
+BatchProcessor::~BatchProcessor() {
+    if (ctx) {
+        llama_free(ctx);
+        ctx = nullptr;
+    }
+}
+
+// Collects the ids already written by a previous run
+bool BatchProcessor::readCheckpoint(const std::string &outputPath) {
+    std::ifstream previous(outputPath, std::ios::binary);
+    if (!previous)
+        return false;
+
+    std::string line;
+    while (std::getline(previous, line)) {
+        JsonValue result;
+        if (!JsonValue::parse(line, result))
+            continue; // a line cut short by an interrupted run is processed again
+
+        const JsonValue *id = result.get("id");
+        if (id && id->isString())
+            completedIds.insert(id->stringValue);
+    }
+
+    if (!completedIds.empty())
+        runtime.logInfo("Batch resume: " + std::to_string(completedIds.size()) + " records already completed");
+    return true;
+}
+
+bool BatchProcessor::formatPrompt(const std::string &system, const std::string &prompt, std::string &formatted) {
+    std::vector<llama_chat_message> messages;
+    if (!system.empty())
+        messages.push_back({ "system", system.c_str() });
+    messages.push_back({ "user", prompt.c_str() });
+
+    const char *tmpl = llama_model_chat_template(runtime.model, nullptr);
+    std::vector<char> buffer(prompt.size() + system.size() + 256);
+    int len = llama_chat_apply_template(tmpl, messages.data(), messages.size(), true, buffer.data(), buffer.size());
+    if (len > (int)buffer.size()) {
+        buffer.resize(len);
+        len = llama_chat_apply_template(tmpl, messages.data(), messages.size(), true, buffer.data(), buffer.size());
+    }
+    if (len < 0)
+        return false;
+
+    formatted.assign(buffer.data(), len);
+    return true;
+}
+
+// Reads input lines until a record ready for decoding is found, invalid records are written as errors
+bool BatchProcessor::nextRecord(std::ifstream &input, Slot &slot) {
+    const int n_ctx = llama_n_ctx(ctx);
+
+    std::string line;
+    while (std::getline(input, line)) {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r\n") == std::string::npos)
+            continue;
+
+        JsonValue record;
+        std::string parseError;
+        bool valid = JsonValue::parse(line, record, &parseError) && record.isObject();
+
+        std::string id = "line-" + std::to_string(lineNumber);
+        if (valid) {
+            const JsonValue *recordId = record.get("id");
+            if (recordId && recordId->isString())
+                id = recordId->stringValue;
+            else if (recordId && recordId->isNumber())
+                id = recordId->dump();
+        }
+
+        if (completedIds.count(id))
+            continue;
+
+        if (!valid) {
+            writeError(id, "Invalid JSON: " + parseError);
+            continue;
+        }
+
+        const JsonValue *prompt = record.get("prompt");
+        if (!prompt || !prompt->isString()) {
+            writeError(id, "Missing prompt");
+            continue;
+        }
+
+        std::string formatted;
+        if (!formatPrompt(record.getString("system"), prompt->stringValue, formatted)) {
+            writeError(id, "Failed to apply the chat template");
+            continue;
+        }
+
+        std::vector<llama_token> tokens = runtime.tokenizePrompt(formatted, true);
+        if (tokens.empty() || (int)tokens.size() >= n_ctx) {
+            writeError(id, "Prompt does not fit the batch context");
+            continue;
+        }
+
+        std::vector<std::string> stop;
+        if (const JsonValue *stops = record.get("stop")) {
+            if (stops->isString())
+                stop.push_back(stops->stringValue);
+            for (const auto &item : stops->arrayValue) {
+                if (item.isString())
+                    stop.push_back(item.stringValue);
+            }
+        }
+
+        int maxTokens = (int)record.getNumber("max_tokens", options.maxTokens);
+        if (maxTokens <= 0)
+            maxTokens = options.maxTokens;
+
+        slot = Slot();
+        slot.id = id;
+        slot.promptTokens = (int)tokens.size();
+        slot.prompt = std::move(tokens);
+        slot.maxTokens = std::min(maxTokens, n_ctx - slot.promptTokens);
+        slot.reserved = slot.promptTokens + slot.maxTokens;
+        slot.stopMatcher = StopSequenceMatcher(stop);
+        return true;
+    }
+    return false;
+}
+
+void BatchProcessor::writeResult(const std::string &json) {
+    output << json << '\n';
+    output.flush(); // every written line is a checkpoint
+
+    written++;
+    if (progress)
+        progress(written);
+}
+
+void BatchProcessor::writeError(const std::string &id, const std::string &message) {
+    JsonValue result = JsonValue::object();
+    result.set("id", id);
+    result.set("error", message);
+    writeResult(result.dump());
+}
+
+void BatchProcessor::finishSlot(Slot &slot, int seqId, FinishReason reason) {
+    slot.response += slot.stopMatcher.flush();
+
+    JsonValue result = JsonValue::object();
+    result.set("id", slot.id);
+    result.set("response", slot.response);
+    result.set("finish_reason", finishReasonName(reason));
+    result.set("prompt_tokens", slot.promptTokens);
+    result.set("completion_tokens", slot.generated);
+    writeResult(result.dump());
+
+    llama_kv_cache_seq_rm(ctx, seqId, -1, -1);
+    if (slot.chain)
+        llama_sampler_free(slot.chain);
+
+    reservedCells -= slot.reserved;
+    slot = Slot();
+}
+
+long BatchProcessor::process(const std::string &inputPath, const std::string &outputPath, ProgressCallback progressCallback) {
+    if (!runtime.model || !runtime.vocab) {
+        error = "Error: Model not loaded.";
+        runtime.logError(error);
+        return -1;
+    }
+
+    std::ifstream input(inputPath, std::ios::binary);
+    if (!input) {
+        error = "Error: Cannot open batch input: " + inputPath;
+        runtime.logError(error);
+        return -1;
+    }
+
+    completedIds.clear();
+    if (options.resume)
+        readCheckpoint(outputPath);
+
+    output.open(outputPath, options.resume ? (std::ios::binary | std::ios::app) : (std::ios::binary | std::ios::trunc));
+    if (!output) {
+        error = "Error: Cannot open batch output: " + outputPath;
+        runtime.logError(error);
+        return -1;
+    }
+
+    // One context shared by all slots, each slot decodes in its own sequence
+    if (!ctx) {
+        const int n_ctx = options.contextSize > 0 ? options.contextSize : runtime.context_size;
+
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = n_ctx;
+        ctx_params.n_batch = n_ctx;
+        ctx_params.n_seq_max = options.slots;
+
+        ctx = llama_new_context_with_model(runtime.model, ctx_params);
+        if (!ctx) {
+            error = "Error: Failed to create batch context";
+            runtime.logError(error);
+            return -1;
+        }
+    }
+    llama_kv_cache_clear(ctx);
+
+    const int n_ctx = llama_n_ctx(ctx);
+    const int n_slots = options.slots;
+
+    progress = progressCallback;
+    lineNumber = 0;
+    written = 0;
+    reservedCells = 0;
+
+    std::vector<Slot> slots(n_slots);
+    std::deque<Slot> staged; // Records read ahead or backed out of a step, in input order
+    bool inputDone = false;
+    bool admitPrompts = true;
+
+    llama_batch batch = llama_batch_init(n_ctx, 0, 1);
+    bool success = true;
+
+    while (success) {
+        // Slots keep their KV cache while higher priority requests use the model
+        if (yieldCallback)
+            yieldCallback();
+
+        batch.n_tokens = 0;
+
+        // Next token of every generating slot
+        for (int s = 0; s < n_slots; s++) {
+            Slot &slot = slots[s];
+            slot.batchIndex = -1;
+            if (!slot.active)
+                continue;
+
+            int n = batch.n_tokens;
+            batch.token[n] = slot.token;
+            batch.pos[n] = slot.pos++;
+            batch.n_seq_id[n] = 1;
+            batch.seq_id[n][0] = s;
+            batch.logits[n] = true;
+            slot.batchIndex = n;
+            batch.n_tokens++;
+        }
+
+        // Refill free slots while the KV cache has room for the whole record
+        std::vector<int> admitted;
+        for (int s = 0; s < n_slots && admitPrompts; s++) {
+            if (slots[s].active)
+                continue;
+
+            if (staged.empty() && !inputDone) {
+                Slot record;
+                if (nextRecord(input, record))
+                    staged.push_back(std::move(record));
+                else
+                    inputDone = true;
+            }
+            if (staged.empty() || reservedCells + staged.front().reserved > n_ctx)
+                break;
+
+            Slot &slot = slots[s];
+            slot = std::move(staged.front());
+            staged.pop_front();
+            admitted.push_back(s);
+
+            slot.active = true;
+            slot.chain = runtime.createSamplerChain();
+            reservedCells += slot.reserved;
+
+            for (size_t i = 0; i < slot.prompt.size(); i++) {
+                int n = batch.n_tokens;
+                batch.token[n] = slot.prompt[i];
+                batch.pos[n] = i;
+                batch.n_seq_id[n] = 1;
+                batch.seq_id[n][0] = s;
+                batch.logits[n] = false;
+                batch.n_tokens++;
+            }
+            batch.logits[batch.n_tokens - 1] = true;
+            slot.batchIndex = batch.n_tokens - 1;
+            slot.pos = slot.prompt.size();
+        }
+        admitPrompts = true;
+
+        if (batch.n_tokens == 0)
+            break; // input exhausted and every slot finished
+
+        const int ret = llama_decode(ctx, batch);
+
+        // 1 means no contiguous run of free KV cells for a ubatch. Finished slots
+        // fragment the cache, so the reserved total can fit while a long prompt
+        // does not. The prompts admitted this step are backed out and the step is
+        // retried with the generating slots alone, freeing cells as they finish.
+        if (ret == 1 && !admitted.empty()) {
+            for (auto it = admitted.rbegin(); it != admitted.rend(); ++it) {
+                Slot &slot = slots[*it];
+                llama_kv_cache_seq_rm(ctx, *it, -1, -1);
+                llama_sampler_free(slot.chain);
+                reservedCells -= slot.reserved;
+
+                Slot record = std::move(slot);
+                record.active = false;
+                record.chain = nullptr;
+                staged.push_front(std::move(record));
+                slot = Slot();
+            }
+
+            // Cells a partially applied batch gave the generating slots are dropped, their token is decoded again
+            bool generating = false;
+            for (int s = 0; s < n_slots; s++) {
+                if (slots[s].active) {
+                    llama_kv_cache_seq_rm(ctx, s, --slots[s].pos, -1);
+                    generating = true;
+                }
+            }
+
+            if (generating) {
+                runtime.logDebug("Batch: no KV slot for the new prompts, retrying with the generating slots");
+                admitPrompts = false;
+                continue;
+            }
+        }
+
+        if (ret != 0) {
+            error = "Error: Failed to decode batch";
+            runtime.logError(error);
+            success = false;
+            break;
+        }
+
+        for (int s : admitted) {
+            slots[s].prompt.clear();
+            slots[s].prompt.shrink_to_fit();
+        }
+
+        for (int s = 0; s < n_slots; s++) {
+            Slot &slot = slots[s];
+            if (!slot.active || slot.batchIndex < 0)
+                continue;
+
+            llama_token token = runtime.sampleToken(ctx, slot.chain, nullptr, candidates, slot.batchIndex);
+            slot.generated++;
+
+            if (llama_vocab_is_eog(runtime.vocab, token)) {
+                finishSlot(slot, s, FINISH_EOG);
+                continue;
+            }
+
+            char buf[256];
+            int len = llama_token_to_piece(runtime.vocab, token, buf, sizeof(buf), 0, false);
+            if (len > 0)
+                slot.response += slot.stopMatcher.push(std::string(buf, len));
+
+            if (slot.stopMatcher.stopped())
+                finishSlot(slot, s, FINISH_STOP_SEQUENCE);
+            else if (slot.generated >= slot.maxTokens)
+                finishSlot(slot, s, FINISH_MAX_TOKENS);
+            else
+                slot.token = token;
+        }
+    }
+
+    llama_batch_free(batch);
+
+    // Records cut short by an error are left out of the checkpoint and run again on resume
+    for (auto &slot : slots) {
+        if (slot.chain)
+            llama_sampler_free(slot.chain);
+    }
+    output.close();
+
+    runtime.logInfo("Batch finished: " + std::to_string(written) + " records written to " + outputPath);
+    return success ? (long)written : -1;
+}
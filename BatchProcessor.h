@@ -0,0 +1,117 @@
+#ifndef BatchProcessor_h
+#define BatchProcessor_h
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_set>
+#include <fstream>
+
+#include "llama.h"
+#include "GenerationOptions.h"
+#include "StopSequenceMatcher.h"
+
+class LlamaRuntime;
+
+/**
+ * @brief Options of an offline batch run.
+ */
+struct BatchOptions {
+    int slots = 8;             ///< Number of prompts decoded together.
+    int maxTokens = 512;       ///< Default token limit of a record without max_tokens.
+    int contextSize = 0;       ///< KV cells shared by all slots, 0 for the runtime context size.
+    bool resume = true;        ///< Skip records whose id is already in the output file.
+};
+
+/**
+ * @brief Runs a JSONL file of prompts through the model with continuous batching.
+ *
+ * Each input line is a JSON object with a `prompt` and optional `id`, `system`,
+ * `max_tokens` and `stop` (string or array of strings) members. Prompts are
+ * streamed from the file into a fixed number of slots that share one context,
+ * every decode step carries the prompt of newly admitted records together with
+ * the next token of every generating slot, and a slot is refilled as soon as
+ * its record finishes.
+ *
+ * Results are appended to the output JSONL file as they finish, in completion
+ * order, one object per record with `id`, `response`, `finish_reason`,
+ * `prompt_tokens` and `completion_tokens` (or `error`). The output file is the
+ * checkpoint: a resumed run skips every id already present in it.
+ */
+class BatchProcessor {
+public:
+    /**
+     * @brief Called after each finished record with the number of records written so far.
+     */
+    using ProgressCallback = std::function<void(size_t completed)>;
+
+    /**
+     * @brief Constructs a processor over a runtime with a loaded model.
+     * @param runtime The runtime providing the model.
+     * @param options Batch options.
+     */
+    BatchProcessor(LlamaRuntime &runtime, const BatchOptions &options);
+    ~BatchProcessor();
+
+    /**
+     * @brief Processes an input JSONL file into an output JSONL file.
+     * @param inputPath Path of the input JSONL file.
+     * @param outputPath Path of the output JSONL file, appended to when resuming.
+     * @param progressCallback Optional progress callback.
+     * @return Number of records written by this run, -1 on failure.
+     */
+    long process(const std::string &inputPath, const std::string &outputPath, ProgressCallback progressCallback = nullptr);
+
+    /**
+     * @brief Sets a function called between decode steps to let other requests run.
+     * @param callback The yield function.
+     */
+    void setYieldCallback(std::function<void()> callback) { yieldCallback = std::move(callback); }
+
+    /**
+     * @brief Returns the description of the last error.
+     */
+    const std::string &getError() const { return error; }
+
+private:
+    /**
+     * @brief State of one record while it is decoded.
+     */
+    struct Slot {
+        bool active = false;                  ///< True while the slot holds a record.
+        std::string id;                       ///< Record id.
+        std::vector<llama_token> prompt;      ///< Prompt tokens not yet decoded.
+        int promptTokens = 0;                 ///< Prompt length.
+        int maxTokens = 0;                    ///< Token limit of the record.
+        int generated = 0;                    ///< Generated token count.
+        int reserved = 0;                     ///< KV cells reserved for the record.
+        llama_pos pos = 0;                    ///< Next position in the sequence.
+        llama_token token = 0;                ///< Last sampled token, decoded next step.
+        int batchIndex = -1;                  ///< Index of the slot's logits in the current batch.
+        llama_sampler *chain = nullptr;       ///< Sampler chain of the record.
+        StopSequenceMatcher stopMatcher;      ///< Stop strings of the record.
+        std::string response;                 ///< Generated text.
+    };
+
+    bool readCheckpoint(const std::string &outputPath);
+    bool nextRecord(std::ifstream &input, Slot &slot);
+    bool formatPrompt(const std::string &system, const std::string &prompt, std::string &formatted);
+    void finishSlot(Slot &slot, int seqId, FinishReason reason);
+    void writeError(const std::string &id, const std::string &message);
+    void writeResult(const std::string &json);
+
+    LlamaRuntime &runtime;
+    BatchOptions options;
+    llama_context *ctx = nullptr;
+    std::vector<llama_token_data> candidates;
+    std::unordered_set<std::string> completedIds;
+    std::ofstream output;
+    size_t lineNumber = 0;
+    size_t written = 0;
+    int reservedCells = 0;
+    ProgressCallback progress;
+    std::function<void()> yieldCallback;
+    std::string error;
+};
+
+#endif // BatchProcessor_h
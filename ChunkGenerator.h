@@ -0,0 +1,138 @@
+#ifndef ChunkGenerator_h
+#define ChunkGenerator_h
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Coroutine generator yielding the chunks of a generation.
+ *
+ * The coroutine only runs while the caller asks for the next chunk, so chunks
+ * are generated on demand by the thread iterating the generator:
+ *
+ *     for (const std::string &chunk : client.generate(sessionId, prompt, options))
+ *         send(chunk);
+ *
+ * Destroying the generator before the end abandons the generation, the
+ * function set with onAbandoned then releases it. Requires C++20.
+ */
+class ChunkGenerator {
+public:
+    struct promise_type {
+        const std::string *current = nullptr;
+        std::exception_ptr exception;
+
+        ChunkGenerator get_return_object() {
+            return ChunkGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const std::string &chunk) noexcept {
+            current = &chunk;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    /**
+     * @brief Input iterator over the chunks, incrementing generates the next one.
+     */
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        iterator() = default;
+        explicit iterator(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+
+        reference operator*() const { return *coroutine.promise().current; }
+        pointer operator->() const { return coroutine.promise().current; }
+
+        iterator& operator++() {
+            resume(coroutine);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !coroutine || coroutine.done(); }
+
+    private:
+        std::coroutine_handle<promise_type> coroutine;
+    };
+
+    ChunkGenerator(ChunkGenerator &&other) noexcept
+        : coroutine(std::exchange(other.coroutine, {})), abandoned(std::move(other.abandoned)) {}
+    ChunkGenerator& operator=(ChunkGenerator &&other) noexcept {
+        if (this != &other) {
+            release();
+            coroutine = std::exchange(other.coroutine, {});
+            abandoned = std::move(other.abandoned);
+        }
+        return *this;
+    }
+    ChunkGenerator(const ChunkGenerator&) = delete;
+    ChunkGenerator& operator=(const ChunkGenerator&) = delete;
+
+    ~ChunkGenerator() {
+        release();
+    }
+
+    /**
+     * @brief Sets the function called when the generator is destroyed before the coroutine completes.
+     *
+     * The coroutine body only starts with begin(), so cleanup that must also run
+     * for a generator that was never iterated belongs here, not in the body.
+     */
+    void onAbandoned(std::function<void()> handler) { abandoned = std::move(handler); }
+
+    /**
+     * @brief Generates the first chunk and returns an iterator to it.
+     */
+    iterator begin() {
+        resume(coroutine);
+        return iterator(coroutine);
+    }
+
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit ChunkGenerator(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+
+    void release() {
+        if (!coroutine)
+            return;
+
+        const bool completed = coroutine.done();
+        coroutine.destroy();
+        coroutine = {};
+        if (!completed && abandoned)
+            abandoned();
+        abandoned = nullptr;
+    }
+
+    static void resume(std::coroutine_handle<promise_type> coroutine) {
+        if (!coroutine || coroutine.done())
+            return;
+
+        coroutine.resume();
+        if (coroutine.promise().exception)
+            std::rethrow_exception(std::exchange(coroutine.promise().exception, {}));
+    }
+
+    std::coroutine_handle<promise_type> coroutine;
+    std::function<void()> abandoned;
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // ChunkGenerator_h
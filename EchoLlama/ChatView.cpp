@@ -0,0 +1,182 @@
+#include "ChatView.h"
+
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+#include <QPainter>
+#include <QFontMetrics>
+#include <QScrollBar>
+#include <QMenu>
+#include <QContextMenuEvent>
+#include <QGuiApplication>
+#include <QClipboard>
+#include <QVector>
+
+#include <climits>
+
+namespace {
+
+const int promptIndent = 100;  // Prompts are indented like the former chat document
+const int messageSpacing = 10; // Space above each message
+const int sidePadding = 8;
+
+} // namespace
+
+/**
+ * @brief List model of the chat messages with their cached heights.
+ */
+class ChatModel : public QAbstractListModel {
+public:
+    struct Message {
+        ChatView::MessageRole role;
+        QString text;
+        mutable int measuredWidth = -1; ///< Width the height was measured for, -1 when stale
+        mutable int height = 0;
+    };
+
+    using QAbstractListModel::QAbstractListModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : messages.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if (!index.isValid() || index.row() >= messages.size() || role != Qt::DisplayRole)
+            return QVariant();
+        return messages[index.row()].text;
+    }
+
+    const Message &message(int row) const { return messages[row]; }
+
+    void append(ChatView::MessageRole role, const QString &text) {
+        beginInsertRows(QModelIndex(), messages.size(), messages.size());
+        messages.push_back({ role, text });
+        endInsertRows();
+    }
+
+    // Extends the last message, only its height is measured again
+    bool appendToLast(const QString &text) {
+        if (messages.isEmpty())
+            return false;
+
+        Message &last = messages.last();
+        last.text += text;
+        last.measuredWidth = -1;
+
+        QModelIndex changed = index(messages.size() - 1);
+        emit dataChanged(changed, changed, { Qt::DisplayRole });
+        return true;
+    }
+
+    bool lastIs(ChatView::MessageRole role) const {
+        return !messages.isEmpty() && messages.last().role == role;
+    }
+
+private:
+    QVector<Message> messages;
+};
+
+/**
+ * @brief Paints a message as word wrapped text, measuring it at most once per width.
+ */
+class ChatDelegate : public QStyledItemDelegate {
+public:
+    explicit ChatDelegate(ChatView *view) : QStyledItemDelegate(view), view(view) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const ChatModel::Message &message = messageAt(index);
+
+        painter->save();
+        painter->setFont(option.font);
+        painter->setPen(message.role == ChatView::Response ? QColor(Qt::white) : QColor(Qt::gray));
+        painter->drawText(textRect(option.rect, message.role), Qt::TextWordWrap, message.text);
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const ChatModel::Message &message = messageAt(index);
+        const int width = view->viewport()->width();
+
+        if (message.measuredWidth != width) {
+            QRect bounds(0, 0, textRect(QRect(0, 0, width, 0), message.role).width(), INT_MAX / 2);
+            message.height = QFontMetrics(option.font).boundingRect(bounds, Qt::TextWordWrap, message.text).height() + messageSpacing;
+            message.measuredWidth = width;
+        }
+        return QSize(width, message.height);
+    }
+
+    /**
+     * @brief Asks the view to lay out a message again after its text changed.
+     */
+    void remeasure(const QModelIndex &index) { emit sizeHintChanged(index); }
+
+private:
+    static const ChatModel::Message &messageAt(const QModelIndex &index) {
+        return static_cast<const ChatModel*>(index.model())->message(index.row());
+    }
+
+    static QRect textRect(const QRect &rect, ChatView::MessageRole role) {
+        const int indent = role == ChatView::Prompt ? promptIndent : 0;
+        return rect.adjusted(sidePadding + indent, messageSpacing, -sidePadding, 0);
+    }
+
+    ChatView *view;
+};
+
+ChatView::ChatView(QWidget *parent)
+    : QListView(parent), chatModel(new ChatModel(this)) {
+
+    ChatDelegate *delegate = new ChatDelegate(this);
+    setModel(chatModel);
+    setItemDelegate(delegate);
+
+    // Rows have their own heights, laid out in batches so a long history never blocks the UI
+    setUniformItemSizes(false);
+    setLayoutMode(QListView::Batched);
+    setResizeMode(QListView::Adjust);
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setSelectionMode(QAbstractItemView::NoSelection);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setFocusPolicy(Qt::NoFocus);
+
+    connect(chatModel, &QAbstractItemModel::dataChanged, delegate,
+            [delegate](const QModelIndex &topLeft) { delegate->remeasure(topLeft); });
+
+    // Growing content keeps the newest text in view unless the user scrolled away from it
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        followBottom = value >= verticalScrollBar()->maximum();
+    });
+    connect(verticalScrollBar(), &QScrollBar::rangeChanged, this, [this](int, int maximum) {
+        if (followBottom)
+            verticalScrollBar()->setValue(maximum);
+    });
+}
+
+void ChatView::append(const QString &text) {
+    chatModel->append(Status, text);
+}
+
+void ChatView::appendPrompt(const QString &text) {
+    chatModel->append(Prompt, text);
+}
+
+void ChatView::beginResponse() {
+    chatModel->append(Response, QString());
+}
+
+void ChatView::appendResponse(const QString &text) {
+    if (!chatModel->lastIs(Response))
+        beginResponse();
+    chatModel->appendToLast(text);
+}
+
+void ChatView::contextMenuEvent(QContextMenuEvent *event) {
+    QModelIndex index = indexAt(event->pos());
+    if (!index.isValid())
+        return;
+
+    QMenu menu(this);
+    QAction *copy = menu.addAction("Copy");
+    if (menu.exec(event->globalPos()) == copy)
+        QGuiApplication::clipboard()->setText(index.data().toString());
+}
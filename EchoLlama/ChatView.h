@@ -0,0 +1,65 @@
+#ifndef ChatView_H
+#define ChatView_H
+
+#include <QListView>
+
+class ChatModel;
+
+/**
+ * @class ChatView
+ * @brief Chat history that only lays out and paints the visible messages.
+ *
+ * Each prompt, response and status line is a row of a list model drawn by a
+ * delegate. Message heights are measured once per view width and cached, so
+ * appending to the current response re-measures that message alone and the
+ * cost of a frame does not grow with the length of the session the way a
+ * QTextEdit document does. The view follows new text while it is scrolled to
+ * the bottom and stays put once the user scrolls up.
+ */
+class ChatView : public QListView {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Kinds of messages, drawn with different colours and indentation.
+     */
+    enum MessageRole {
+        Prompt,
+        Response,
+        Status
+    };
+
+    explicit ChatView(QWidget *parent = nullptr);
+
+    /**
+     * @brief Appends a status line.
+     * @param text The text of the line.
+     */
+    void append(const QString &text);
+
+    /**
+     * @brief Appends a prompt typed by the user.
+     * @param text The prompt.
+     */
+    void appendPrompt(const QString &text);
+
+    /**
+     * @brief Starts an empty response message that appendResponse extends.
+     */
+    void beginResponse();
+
+    /**
+     * @brief Appends text to the current response message.
+     * @param text The text generated since the last call.
+     */
+    void appendResponse(const QString &text);
+
+protected:
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+    ChatModel *chatModel;
+    bool followBottom = true; ///< Keep the newest text in view, cleared while the user looks at older messages
+};
+
+#endif // ChatView_H
@@ -36,7 +36,12 @@ void DownloadManager::downloadFile(const QString& url, QFile* file)
         emit downloadError(url, error);
         });
 
-    networkUtils->downloadFile(url, file);
+    networkUtils->downloadSegmented(url, file, segmentCount);
+}
+
+void DownloadManager::setSegmentCount(int count)
+{
+    segmentCount = qMax(1, count);
 }
 
 void DownloadManager::pauseDownload(const QString& url)
@@ -20,6 +20,12 @@ public:
     void resumeDownload(const QString& url, QFile* file);
     void cancelDownload(const QString& url);
 
+    /**
+     * @brief Sets the number of parallel connections used for each download.
+     * @param count Connections per file, 1 downloads over a single stream.
+     */
+    void setSegmentCount(int count);
+
 signals:
     void progressUpdated(const QString& url, qint64 startOffset, qint64 bytesReceived, qint64 totalBytes);
     void downloadFinished(const QString& url);
@@ -33,6 +39,7 @@ private:
     };
 
     QMap<QString, NetworkUtils*> activeDownloads;
+    int segmentCount = 4;
 };
 
 #endif // DownloadManager_H
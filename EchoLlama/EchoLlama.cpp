@@ -3,15 +3,16 @@
 #include "LlamaClient.h"
 #include "FontAwesome.h"
 #include "DownloadManager.h"
+#include "ChatView.h"
 
 #include <QVBoxLayout>
-#include <QTextEdit>
 #include <QScrollBar>
 #include <QPlainTextEdit>
 #include <QToolButton>
 #include <QGuiApplication>
 #include <QTimer>
 #include <QDir>
+#include <QFileInfo>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QMessageBox>
@@ -27,14 +28,17 @@
 
 #include "llama_version.h"
 
-bool systemPrompt=false;
-
 EchoLlama::EchoLlama(QWidget *parent)
-    : QWidget(parent), chatDisplay(new QTextEdit(this)), promptInput(new QPlainTextEdit(this)), sendButton(new QToolButton(this)){
+    : QWidget(parent), chatDisplay(new ChatView(this)), promptInput(new QPlainTextEdit(this)), sendButton(new QToolButton(this)), stopButton(new QToolButton(this)){
 
     downloadManager = nullptr;
     llamaClient = nullptr;
 
+    // Generated text is drawn at most once per display frame
+    renderTimer = new QTimer(this);
+    renderTimer->setSingleShot(true);
+    renderTimer->setInterval(16);
+
     // Initialize UI components
     setupUI();
 
@@ -59,6 +63,15 @@ EchoLlama::EchoLlama(QWidget *parent)
 }
 
 EchoLlama::~EchoLlama() {
+    // Stop a running model load or generation before the client goes away
+    if (loadThread) {
+        llamaClient->cancelLoadModel();
+        loadThread->wait();
+    }
+    if (generationThread) {
+        llamaClient->cancelGeneration();
+        generationThread->wait();
+    }
     delete llamaClient;
 }
 
@@ -188,14 +201,18 @@ void EchoLlama::setupUI() {
     sendButton->setToolTip("Send");
     sendButton->setCursor(Qt::PointingHandCursor);  // Make it look clickable
 
+    stopButton->setFont(fa);
+    stopButton->setText(QChar(0xf04d));  // Stop icon
+    stopButton->setToolTip("Stop");
+    stopButton->setCursor(Qt::PointingHandCursor);
+    stopButton->hide();
+
     // Set style for inputGroup
     inputGroup = new QWidget(this);
     inputGroup->setFixedHeight(75);
 
     // Initialize UI components
-    chatDisplay->setReadOnly(true);
     chatDisplay->setMinimumHeight(160);
-    //chatDisplay->setCurrentCharFormat()
     promptInput->setFixedHeight(46);
     promptInput->setMinimumHeight(46);
 
@@ -208,6 +225,7 @@ void EchoLlama::setupUI() {
     // Create a horizontal layout for the send button
     QHBoxLayout* buttonLayout = new QHBoxLayout();
     buttonLayout->addWidget(sendButton, 0, Qt::AlignRight);
+    buttonLayout->addWidget(stopButton, 0, Qt::AlignRight);
 
     // Spacer to offset the button by -10 pixels to the left (after the button)
     QSpacerItem* spacer = new QSpacerItem(10, 0, QSizePolicy::Fixed, QSizePolicy::Minimum);
@@ -227,6 +245,8 @@ void EchoLlama::setupUI() {
 
 void EchoLlama::setupConnections() {
 
+    connect(renderTimer, &QTimer::timeout, this, &EchoLlama::flushResponse);
+
     // Architecture selection dropdown connect
     connect(architectureComboBox, &QComboBox::currentIndexChanged, this, &EchoLlama::handleArchitectureChange);
 
@@ -242,6 +262,7 @@ void EchoLlama::setupConnections() {
     // Connect signals to slots
     connect(promptInput, &QPlainTextEdit::textChanged, this, &EchoLlama::handleTextChange);
     connect(sendButton, &QToolButton::clicked, this, &EchoLlama::sendClicked);
+    connect(stopButton, &QToolButton::clicked, this, &EchoLlama::stopGeneration);
 
     connect(downloadManager, &DownloadManager::progressUpdated, this, &EchoLlama::updateDownloadProgress);
     connect(downloadManager, &DownloadManager::downloadFinished, this, &EchoLlama::onDownloadFinished);
@@ -341,6 +362,11 @@ bool EchoLlama::loadLlama() {
         return false;
     }
 
+    if(modelLoading) {
+        qDebug() << "loadLlama (2C) model load already in progress";
+        return false;
+    }
+
     QJsonObject modelObject = getSelectedModelObject();
     if(modelObject.isEmpty())
         return false;
@@ -386,115 +412,121 @@ bool EchoLlama::loadLlama() {
 
     qDebug() << "loadLlama (7) setup model parameters: ";
 
-    int contextSize = 4096;
-    float temperature = 0.7f;
-    float topK = 40;
-    float topP = 0.6;
-    float repetitionPenalty = 1.2;
-
-    ModelParameter params[] = {
-        {"temperature", PARAM_FLOAT, &temperature},
-        {"context_size", PARAM_INT, &contextSize},
-        {"top_k", PARAM_FLOAT, &topK},
-        {"top_P", PARAM_FLOAT, &topP},
-        {"repetition_penalty", PARAM_FLOAT, &repetitionPenalty}
-    };
-
-    size_t paramCount = sizeof(params) / sizeof(params[0]);
-
     QFile modelFile(modelPathFile);
     if(!modelFile.exists()) {
         qDebug() << "EchoLlama model file does not exist: " << modelPathFile;
         return false;
     }
 
-    bool success = llamaClient->loadModel(modelPathFile.toUtf8().constData(), params, paramCount);
-    if (!success) {
-        qDebug() << "loadLlama Failed to open model file: "<<modelPathFile;
-        chatDisplay->append("Failed to open model file: \n"+modelPathFile+"\n");
-        return false;
-    }
+    modelLoading = true;
+    loadingModelFile = modelPathFile;
+    progressBar->setValue(0);
+    progressBar->show();
+
+    // Load on a background thread so the UI stays responsive for large models
+    loadThread = QThread::create([this, modelPathFile]() {
+        // Largest context this machine holds, capped since a chat rarely needs more.
+        // If even the estimate fails, 0 lets the engine size it and report why it does not fit.
+        int contextSize = 0;
+        ModelMemoryEstimate estimate;
+        if (llamaClient->estimateMemory(modelPathFile.toStdString(), 0, 1, 0, estimate))
+            contextSize = std::min(estimate.contextSize, 16384);
+        float temperature = 0.7f;
+        float topK = 40;
+        float topP = 0.6;
+        float repetitionPenalty = 1.2;
+
+        ModelParameter params[] = {
+            {"temperature", PARAM_FLOAT, &temperature},
+            {"context_size", PARAM_INT, &contextSize},
+            {"top_k", PARAM_FLOAT, &topK},
+            {"top_P", PARAM_FLOAT, &topP},
+            {"repetition_penalty", PARAM_FLOAT, &repetitionPenalty}
+        };
+
+        size_t paramCount = sizeof(params) / sizeof(params[0]);
+
+        // Only post progress to the UI when the displayed percentage changes
+        struct LoadProgress {
+            EchoLlama *echo;
+            int lastPercent;
+        } progress = { this, -1 };
+
+        bool success = llamaClient->loadModel(modelPathFile.toUtf8().constData(), params, paramCount, nullptr,
+            [](float value, void *userData) -> bool {
+                LoadProgress *progress = (LoadProgress*)userData;
+                int percent = static_cast<int>(value * 100);
+                if (percent != progress->lastPercent) {
+                    progress->lastPercent = percent;
+                    EchoLlama *echo = progress->echo;
+                    QMetaObject::invokeMethod(echo, [echo, value]() { echo->updateLoadProgress(value); }, Qt::QueuedConnection);
+                }
+                return true;
+            }, &progress);
 
-    systemPrompt = true;
-    generateResponse("Hello!");
-    promptInput->setFocus();
+        QMetaObject::invokeMethod(this, [this, success, modelPathFile]() { onModelLoaded(success, modelPathFile); }, Qt::QueuedConnection);
+    });
+
+    connect(loadThread, &QThread::finished, loadThread, &QObject::deleteLater);
+    loadThread->start();
 
     return true;
 }
 
-void EchoLlama::processPrompt(const QString& prompt) {
-    //chatDisplay->append("Prompt: " + prompt + "\n");
-    QTextCursor cursor = chatDisplay->textCursor();
-    cursor.movePosition(QTextCursor::End);
-
-    cursor.insertBlock(); // insert new block for the prompt
-
-    // Create a QTextBlockFormat for the block formatting options
-    QTextBlockFormat blockFormat;
-    blockFormat.setLeftMargin(100); // Set the left margin to 20 pixels
-    blockFormat.setTopMargin(10);
-    blockFormat.setLineHeight(25, QTextBlockFormat::FixedHeight);
-    //blockFormat.setLineSpacing(QTextBlockFormat::FixedHeight, 20.0); // Set line spacing to 20 pixels
+void EchoLlama::updateLoadProgress(float progress) {
+    progressBar->setValue(static_cast<int>(progress * 100));
+}
 
-    // Apply the block format to the current block
-    cursor.setBlockFormat(blockFormat);
+void EchoLlama::onModelLoaded(bool success, const QString& modelPathFile) {
+    modelLoading = false;
+    loadingModelFile.clear();
+    progressBar->hide();
 
-    QTextCharFormat format;
-    format.setForeground(Qt::gray); // #c8a2c8 in RGB
-    cursor.setBlockCharFormat(format);
-
-    cursor.insertText(prompt);
+    // The selection changed while loading, pick it up now
+    if (selectedModelPathFile() != modelPathFile) {
+        handleModelSelectionChange();
+        return;
+    }
 
-    // Ensure the scroll bar is updated to the bottom
-    chatDisplay->ensureCursorVisible();
+    if (!success) {
+        qDebug() << "loadLlama Failed to open model file: "<<modelPathFile;
+        chatDisplay->append("Failed to open model file: \n"+modelPathFile+"\n");
+        return;
+    }
 
-    cursor.insertBlock(); // insert new block for the response
+    generateResponse("Hello!");
+    promptInput->setFocus();
+}
 
-    cursor.movePosition(QTextCursor::End);
-    chatDisplay->ensureCursorVisible();
+QString EchoLlama::selectedModelPathFile() {
+    QJsonObject modelObject = getSelectedModelObject();
+    if (modelObject.isEmpty())
+        return QString();
 
-    QGuiApplication::processEvents();
+    QString downloadFile = QUrl(modelObject["download_link"].toString()).fileName();
+    QString modelPath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/.cache/EchoLlama/models";
+    return QString("%1/%2").arg(modelPath).arg(downloadFile);
+}
 
+void EchoLlama::processPrompt(const QString& prompt) {
+    chatDisplay->appendPrompt(prompt);
     generateResponse(prompt);
 }
 
-void EchoLlama::responseCallback(const char* msg, void* userData) {
-    // Save current scrollbar position and check if it was at the bottom
-    QScrollBar* scrollBar = chatDisplay->verticalScrollBar();
-    bool wasAtBottom = scrollBar->value() == scrollBar->maximum();
-
-    QTextCursor cursor = chatDisplay->textCursor();
-    cursor.movePosition(QTextCursor::End);
-
-    // Create a QTextBlockFormat for the block formatting options
-    QTextBlockFormat blockFormat;
-    blockFormat.setLeftMargin(0); // Set the left margin to 20 pixels
-    blockFormat.setLineHeight(25, QTextBlockFormat::FixedHeight); // Set line spacing to 25 pixels
-    // Apply the block format to the current block
-    cursor.setBlockFormat(blockFormat);
-
-    QTextCharFormat format;
-    format.setForeground(Qt::white); // #c8a2c8 in RGB
-    cursor.setBlockCharFormat(format);
-
-    cursor.insertText(msg);
-
-    // Set the modified cursor back to the text edit
-    chatDisplay->setTextCursor(cursor);
-
-    // Ensure the scroll bar is updated to the bottom
-    cursor.movePosition(QTextCursor::End);
-    chatDisplay->ensureCursorVisible();
+void EchoLlama::responseCallback(const QString& msg) {
+    // Tokens arrive faster than the screen refreshes, they are accumulated and
+    // drawn together when the frame timer fires
+    pendingResponse += msg;
+    if (!renderTimer->isActive())
+        renderTimer->start();
+}
 
-    // Only auto-scroll if we were already at the bottom before adding text
-    if (wasAtBottom) {
-        chatDisplay->moveCursor(QTextCursor::End);
-        chatDisplay->ensureCursorVisible();
-    }
+void EchoLlama::flushResponse() {
+    if (pendingResponse.isEmpty())
+        return;
 
-    // Force an update
-    chatDisplay->update();
-    QGuiApplication::processEvents();
+    chatDisplay->appendResponse(pendingResponse);
+    pendingResponse.clear();
 }
 
 void EchoLlama::generateResponse(const QString& prompt) {
@@ -503,29 +535,59 @@ void EchoLlama::generateResponse(const QString& prompt) {
         return;
     }
 
-    llamaClient->generateResponse(prompt.toUtf8().constData(),
-          [](const char* msg, void* userData) {
-              ((EchoLlama*)userData)->responseCallback(msg, userData);
-          },
-          [](const char* msg, void* userData) {
-              ((EchoLlama*)userData)->finishedCallback(msg, userData);
-          },
-        this
-    );
+    if (generating) {
+        qDebug() << "generateResponse: a response is already being generated";
+        return;
+    }
+
+    setGenerating(true);
+    chatDisplay->beginResponse();
+
+    // Decode on a worker thread, text reaches the chat through queued calls so
+    // rendering never holds up decoding and the event loop is never re-entered
+    generationThread = QThread::create([this, prompt]() {
+        bool success = llamaClient->generateResponse(prompt.toUtf8().constData(),
+              [](const char* msg, void* userData) {
+                  EchoLlama *echo = (EchoLlama*)userData;
+                  QString text = QString::fromUtf8(msg);
+                  QMetaObject::invokeMethod(echo, [echo, text]() { echo->responseCallback(text); }, Qt::QueuedConnection);
+              },
+              nullptr,
+            this
+        );
+
+        QMetaObject::invokeMethod(this, [this, success]() { onGenerationFinished(success); }, Qt::QueuedConnection);
+    });
+
+    connect(generationThread, &QThread::finished, generationThread, &QObject::deleteLater);
+    generationThread->start();
+}
+
+void EchoLlama::stopGeneration() {
+    if (generating && llamaClient)
+        llamaClient->cancelGeneration();
 }
 
+void EchoLlama::setGenerating(bool active) {
+    generating = active;
+    sendButton->setVisible(!active);
+    stopButton->setVisible(active);
+}
+
+void EchoLlama::onGenerationFinished(bool success) {
+    // The last tokens are drawn now rather than on the next frame
+    renderTimer->stop();
+    flushResponse();
+
+    setGenerating(false);
 
-void EchoLlama::finishedCallback(const char* msg, void* userData) {
-    // Optional: Handle any cleanup after response is finished
-    if(systemPrompt){
-        // system promps are generated directly without a user question directly by calling generateResponse vs processPromt
-        // we need to add a new line
-        QTextCursor cursor = chatDisplay->textCursor();
-        cursor.movePosition(QTextCursor::End);
-        cursor.insertBlock(); // insert new block for the prompt
+    if (!success)
+        qDebug() << "generateResponse failed";
 
-        // pop system prompt status
-        systemPrompt = false;
+    // A model selected during the generation is loaded now
+    if (selectionChanged) {
+        selectionChanged = false;
+        handleModelSelectionChange();
     }
 }
 
@@ -533,10 +595,9 @@ void EchoLlama::handleTextChange() {
     QString text = promptInput->toPlainText();
     if (text.endsWith("\n")) {
         Qt::KeyboardModifiers modifiers = QGuiApplication::keyboardModifiers();
-        if (!(modifiers & Qt::ShiftModifier)) {
+        if (!(modifiers & Qt::ShiftModifier) && !generating) {
             text.chop(1);
             processPrompt(text);
-            QGuiApplication::processEvents();
             promptInput->clear();
         }
     }
@@ -544,14 +605,16 @@ void EchoLlama::handleTextChange() {
 
 void EchoLlama::sendClicked() {
     // Handle the send button click
+    if (generating)
+        return;
+
     processPrompt(promptInput->toPlainText());
-    QGuiApplication::processEvents();
     promptInput->clear();
 }
 
-void applyModernScrollbarStyle(QTextEdit* textEdit) {
+void applyModernScrollbarStyle(QAbstractScrollArea* scrollArea) {
     // Get the vertical scrollbar specifically
-    QScrollBar* verticalScrollBar = textEdit->verticalScrollBar();
+    QScrollBar* verticalScrollBar = scrollArea->verticalScrollBar();
 
     QString scrollbarStyle = R"(
         QScrollBar:vertical {
@@ -666,7 +729,7 @@ void EchoLlama::applyStyles() {
 
     // Set style for chatDisplay
     chatDisplay->setStyleSheet(
-            "QTextEdit {"
+            "QListView {"
             "background-color: #272931;"
             "border-radius: 15px;"
             "   font-size: 16px;" // Increased font size
@@ -729,14 +792,10 @@ void EchoLlama::applyStyles() {
                 color: #0077CC;
             }
         )");
+    stopButton->setStyleSheet(sendButton->styleSheet());
 
 
-    QTextCursor cursor = chatDisplay->textCursor();
     QTextCharFormat format;
-    format.setForeground(Qt::gray); // #c8a2c8 in RGB
-    chatDisplay->setCurrentCharFormat(format);
-
-    cursor = promptInput->textCursor();
     format.setForeground(QColor(230, 230, 230)); // #c8a2c8 in RGB
     promptInput->setCurrentCharFormat(format);
 
@@ -761,6 +820,22 @@ void EchoLlama::handleModelSelectionChange() {
         return;
     }
 
+    // The model cannot change under a running generation, stop it and
+    // handle the selection again once the worker thread has finished
+    if (generating) {
+        selectionChanged = true;
+        stopGeneration();
+        return;
+    }
+
+    // Cancel a model load that no longer matches the selection, the selection
+    // is handled again once the load thread has finished
+    if (modelLoading) {
+        if (llamaClient && selectedModelPathFile() != loadingModelFile)
+            llamaClient->cancelLoadModel();
+        return;
+    }
+
     QString downloadLink = modelObject["download_link"].toString();
     if (downloadManager && downloadManager->isActive(downloadLink)){
         //chatDisplay->append("Model download in progress");
@@ -776,7 +851,7 @@ void EchoLlama::handleModelSelectionChange() {
     qint64 bytesDownloaded = 0;
 
     if(file->exists()){
-        bytesDownloaded = file->size();
+        bytesDownloaded = NetworkUtils::downloadedSize(downloadFilePath);
 
         if(bytesDownloaded < bytesTotal){
             //if(!llamaClient || !llamaClient->isModelLoaded())
@@ -811,7 +886,48 @@ void EchoLlama::handleModelSelectionChange() {
 }
 
 void EchoLlama::showModelInfo() {
-    QMessageBox::information(this, "Model Info", "Detailed information about the selected model.");
+    QString modelPathFile = selectedModelPathFile();
+    if (!llamaClient || modelPathFile.isEmpty()) {
+        QMessageBox::information(this, "Model Info", "Select a model to see its details.");
+        return;
+    }
+
+    // Served from the catalogue index, only new or changed model files are opened
+    QFileInfo modelFileInfo(modelPathFile);
+    std::vector<LlamaClient::ModelInfo> models;
+    llamaClient->scanModels(modelFileInfo.absolutePath().toStdString(), models);
+
+    // The catalogue keys are canonical paths, empty here when the file does not exist
+    const QString selectedPath = modelFileInfo.canonicalFilePath();
+    for (const LlamaClient::ModelInfo &model : models) {
+        if (QDir::cleanPath(QDir::fromNativeSeparators(QString::fromStdString(model.path))) != selectedPath)
+            continue;
+
+        if (!model.valid) {
+            QMessageBox::information(this, "Model Info",
+                                     "The model file could not be read: " + QString::fromStdString(model.error));
+            return;
+        }
+
+        const double parameters = (double)model.parameterCount;
+        const QString parameterText = parameters >= 1e9 ? QString::number(parameters / 1e9, 'f', 1) + "B"
+                                                        : QString::number(parameters / 1e6, 'f', 0) + "M";
+
+        QString info = QString("Name: %1\nArchitecture: %2\nParameters: %3\nContext length: %4\n"
+                               "Embedding length: %5\nLayers: %6\nVocabulary: %7\nFile size: %8 MB")
+                           .arg(QString::fromStdString(model.name))
+                           .arg(QString::fromStdString(model.architecture))
+                           .arg(parameterText)
+                           .arg(model.contextLength)
+                           .arg(model.embeddingLength)
+                           .arg(model.blockCount)
+                           .arg(model.vocabularySize)
+                           .arg(model.size / (1024 * 1024));
+        QMessageBox::information(this, "Model Info", info);
+        return;
+    }
+
+    QMessageBox::information(this, "Model Info", "The selected model has not been downloaded yet.");
 }
 
 void EchoLlama::downloadModel() {
@@ -873,6 +989,68 @@ void EchoLlama::onDownloadFinished(const QString &url)
 {
     qDebug() << "Download complete";
 
+    QString modelPath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/.cache/EchoLlama/models";
+    QString modelPathFile = QString("%1/%2").arg(modelPath).arg(QUrl(url).fileName());
+
+    // Curated models may list the sha256 published with the file
+    QString expectedDigest;
+    for (const QJsonValue &modelValue : modelsArray) {
+        QJsonObject modelObject = modelValue.toObject();
+        if (modelObject["download_link"].toString() == url)
+            expectedDigest = modelObject["sha256"].toString();
+    }
+
+    progressBar->setValue(0);
+    progressBar->show();
+
+    // Catch truncated or corrupted downloads before the model is loaded, hashing runs off the UI thread
+    QThread *verifyThread = QThread::create([this, url, modelPathFile, expectedDigest]() {
+        struct VerifyProgress {
+            EchoLlama *echo;
+            int lastPercent;
+        } progress = { this, -1 };
+
+        std::string digest;
+        std::string error;
+        bool verified = llamaClient->verifyModel(modelPathFile.toStdString(),
+            expectedDigest.isEmpty() ? DIGEST_NONE : DIGEST_SHA256, expectedDigest.toStdString(), true, digest, error,
+            [](float value, void *userData) -> bool {
+                VerifyProgress *progress = (VerifyProgress*)userData;
+                int percent = static_cast<int>(value * 100);
+                if (percent != progress->lastPercent) {
+                    progress->lastPercent = percent;
+                    EchoLlama *echo = progress->echo;
+                    QMetaObject::invokeMethod(echo, [echo, value]() { echo->updateLoadProgress(value); }, Qt::QueuedConnection);
+                }
+                return true;
+            }, &progress);
+
+        QString message = QString::fromStdString(error);
+        QMetaObject::invokeMethod(this, [this, url, verified, message]() { onModelVerified(url, verified, message); }, Qt::QueuedConnection);
+    });
+
+    connect(verifyThread, &QThread::finished, verifyThread, &QObject::deleteLater);
+    verifyThread->start();
+}
+
+void EchoLlama::onModelVerified(const QString &url, bool verified, const QString &error)
+{
+    progressBar->hide();
+
+    if (!verified) {
+        qDebug() << "Model verification failed: " << error;
+        QMessageBox::warning(this, "Model Download",
+                             "The downloaded model is damaged and cannot be used:\n" + error +
+                             "\n\nDelete the file and download it again.");
+        return;
+    }
+
+    // Index the new model now so showing its details later does not open the file
+    if (llamaClient) {
+        std::vector<LlamaClient::ModelInfo> models;
+        llamaClient->scanModels((QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/.cache/EchoLlama/models").toStdString(), models);
+    }
+
     if (!llamaClient->isModelLoaded()) {
         //chatDisplay->append("Model download complete, loading llama...\n");
         QGuiApplication::processEvents();
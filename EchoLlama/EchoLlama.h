@@ -3,15 +3,18 @@
 
 #include <QWidget>
 #include <QJsonArray>
+#include <QPointer>
+#include <QThread>
 
 class LlamaClient;
-class QTextEdit;
+class QTimer;
 class QPlainTextEdit;
 class QToolButton;
 class QComboBox;
 class QProgressBar;
 
 class DownloadManager;
+class ChatView;
 /**
  * @file EchoLlama.h
  * @brief Defines the EchoLlama class for interacting with the LlamaEngine.
@@ -40,7 +43,7 @@ public:
     ~EchoLlama();
 
     /**
-     * @brief Generates a response based on the given prompt.
+     * @brief Starts generating a response to the given prompt on a worker thread.
      * @param prompt The input text prompt.
      */
     void generateResponse(const QString& prompt);
@@ -67,6 +70,11 @@ private slots:
      */
     void sendClicked();
 
+    /**
+     * @brief Slot to handle the stop button, cancels the running generation.
+     */
+    void stopGeneration();
+
     void handleArchitectureChange(int index);
     void handleModelSelectionChange();
     void showModelInfo();
@@ -78,9 +86,9 @@ private slots:
 
 private:
     /**
-     * @brief Text edit widget for displaying chat messages.
+     * @brief View of the chat messages, only the visible ones are laid out.
      */
-    QTextEdit* chatDisplay;
+    ChatView* chatDisplay;
 
     /**
      * @brief Widget group containing input components (promptInput and sendButton).
@@ -97,6 +105,11 @@ private:
      */
     QToolButton *sendButton;
 
+    /**
+     * @brief Stop button replacing the send button while a response is generated.
+     */
+    QToolButton *stopButton;
+
     /**
      * @brief Pointer to the Llama client instance.
      */
@@ -116,25 +129,72 @@ private:
     void setupConnections();
 
     /**
-     * @brief Callback function to handle incoming response messages.
-     * @param msg The message content.
-     * @param userData User data pointer (points to this EchoLlama instance).
+     * @brief Queues generated text for the next frame, called on the UI thread.
+     * @param msg The text generated since the last call.
+     */
+    void responseCallback(const QString& msg);
+
+    /**
+     * @brief Draws the text queued since the last frame.
      */
-    void responseCallback(const char* msg, void* userData);
+    void flushResponse();
 
     /**
-     * @brief Callback function to handle the completion of a response generation.
-     * @param msg The message content.
-     * @param userData User data pointer (points to this EchoLlama instance).
+     * @brief Called on the UI thread once the worker thread has finished generating.
+     * @param success True if the response was generated, also when it was stopped.
      */
-    void finishedCallback(const char* msg, void* userData);
+    void onGenerationFinished(bool success);
 
     /**
-     * @brief Loads the Llama model with specified parameters.
-     * @return True if the model loads successfully, false otherwise.
+     * @brief Switches between the send and stop buttons.
+     * @param active True while a response is generated.
+     */
+    void setGenerating(bool active);
+
+    /**
+     * @brief Starts loading the Llama model with specified parameters on a background thread.
+     * @return True if the model is loaded or a load was started, false otherwise.
      */
     bool loadLlama();
 
+    /**
+     * @brief Called on the UI thread once the background model load has finished.
+     * @param success True if the model loaded successfully.
+     * @param modelPathFile Path of the model file that was loaded.
+     */
+    void onModelLoaded(bool success, const QString& modelPathFile);
+
+    /**
+     * @brief Called on the UI thread once a finished download has been verified.
+     * @param url Download link of the model.
+     * @param verified True if the file passed the tensor check and matched its digest.
+     * @param error Why the verification failed.
+     */
+    void onModelVerified(const QString &url, bool verified, const QString &error);
+
+    /**
+     * @brief Updates the progress bar while the model is loading.
+     * @param progress Load progress in the range [0, 1].
+     */
+    void updateLoadProgress(float progress);
+
+    /**
+     * @brief Returns the local file path of the currently selected model.
+     * @return The model file path, or an empty string if no valid model is selected.
+     */
+    QString selectedModelPathFile();
+
+    QPointer<QThread> loadThread; ///< Background thread running the current model load
+    bool modelLoading = false;    ///< True while a model load is in progress
+    QString loadingModelFile;     ///< Path of the model file being loaded
+
+    QPointer<QThread> generationThread; ///< Worker thread running the current generation
+    bool generating = false;            ///< True while a response is generated
+    bool selectionChanged = false;      ///< The model selection changed during a generation
+
+    QTimer *renderTimer;     ///< Frame timer drawing the queued response text
+    QString pendingResponse; ///< Text generated since the last frame
+
     /**
      * @brief Applies styles to UI components (chatDisplay, inputGroup, promptInput, sendButton).
      */
@@ -14,6 +14,7 @@ SOURCES += \
     EchoLlama.cpp \
     FontAwesome.cpp \
     DownloadManager.cpp \
+    ChatView.cpp \
     NetworkUtils.cpp \
     ../LlamaClient.cpp
 
@@ -21,8 +22,10 @@ HEADERS += \
     EchoLlama.h \
     FontAwesome.h \
     DownloadManager.h \
+    ChatView.h \
     NetworkUtils.h \
-    ..//LlamaClient.h
+    ..//LlamaClient.h \
+    ../ChunkGenerator.h
 
 # Include Paths
 INCLUDEPATH += \
@@ -2,18 +2,37 @@
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTimer>
 #include <QDebug>
 
 //#include "Log.h"
 //using GameFusion::Log;
 
+namespace {
+
+const qint64 minSegmentSize = 16 * 1024 * 1024; // Smaller ranges cost more in requests than parallelism gains
+
+} // namespace
+
+QString errorString(QNetworkReply::NetworkError code);
+
 NetworkUtils::NetworkUtils(QObject *parent)
     : QObject(parent),
     networkManager(new QNetworkAccessManager(this)),
     currentFile(nullptr),
     currentReply(nullptr),
-    rangeStart(0)
+    rangeStart(0),
+    partFile(nullptr),
+    segmentedSize(0),
+    saveTimer(new QTimer(this))
 {
+    saveTimer->setInterval(1000);
+    connect(saveTimer, &QTimer::timeout, this, &NetworkUtils::saveSegments);
 }
 
 void NetworkUtils::downloadFile(const QString &url, QFile *file)
@@ -40,11 +59,78 @@ void NetworkUtils::downloadFile(const QString &url, QFile *file)
             this, &NetworkUtils::handleDownloadProgress);
 }
 
+void NetworkUtils::downloadSegmented(const QString &url, QFile *file, int segmentCount)
+{
+    currentFile = file;
+    segmentedUrl = url;
+
+    // Bytes left by a single stream download can only be resumed by a single stream
+    if (segmentCount <= 1 || (file->size() > 0 && !QFile::exists(segmentsPath()))) {
+        downloadFile(url, file);
+        return;
+    }
+
+    if (loadSegments()) {
+        startSegments(QUrl(url));
+        return;
+    }
+
+    // The size of the file and the range support of the server decide how it is split
+    QNetworkRequest request(url);
+    request.setRawHeader("Accept-Encoding", "identity");
+    currentReply = networkManager->head(request);
+
+    QNetworkReply *reply = currentReply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, url, file, segmentCount]() {
+        // Paused or cancelled, the reply is released by pauseDownload or cancelDownload
+        if (reply->error() == QNetworkReply::OperationCanceledError)
+            return;
+
+        currentReply = nullptr;
+        reply->deleteLater();
+
+        const qint64 size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        const bool ranges = reply->rawHeader("Accept-Ranges").trimmed().toLower() == "bytes";
+        const int count = (int)qMin<qint64>(segmentCount, size / minSegmentSize);
+        if (reply->error() != QNetworkReply::NoError || !ranges || count <= 1) {
+            downloadFile(url, file);
+            return;
+        }
+
+        partFile = new QFile(partPath(), this);
+        if (!partFile->open(QIODevice::ReadWrite | QIODevice::Truncate) || !partFile->resize(size)) {
+            failSegments("Cannot create " + partPath());
+            return;
+        }
+
+        segmentedSize = size;
+        segments.clear();
+        for (int i = 0; i < count; i++)
+            segments.push_back({ size * i / count, size * (i + 1) / count - 1, 0, nullptr });
+        saveSegments();
+
+        // Redirects were followed by the HEAD request, the ranges go straight to the final host
+        startSegments(reply->url());
+    });
+}
+
 qint64 NetworkUtils::startOffset()
 {
     return rangeStart;
 }
 
+qint64 NetworkUtils::downloadedSize(const QString &fileName)
+{
+    QFile stateFile(fileName + ".segments");
+    if (!stateFile.open(QIODevice::ReadOnly))
+        return QFileInfo(fileName).size();
+
+    qint64 received = 0;
+    for (const QJsonValue &value : QJsonDocument::fromJson(stateFile.readAll()).object()["segments"].toArray())
+        received += value.toObject()["received"].toInteger();
+    return received;
+}
+
 void NetworkUtils::handleReadyRead()
 {
     if (currentFile) {
@@ -52,6 +138,217 @@ void NetworkUtils::handleReadyRead()
     }
 }
 
+void NetworkUtils::startSegments(const QUrl &url)
+{
+    rangeStart = segmentsReceived();
+    if (rangeStart == segmentedSize) {
+        completeSegments();
+        return;
+    }
+
+    for (int i = 0; i < segments.size(); i++) {
+        if (segments[i].received < segments[i].end - segments[i].start + 1)
+            startSegment(i, url);
+    }
+    saveTimer->start();
+}
+
+void NetworkUtils::startSegment(int index, const QUrl &url)
+{
+    Segment &segment = segments[index];
+
+    QNetworkRequest request(url);
+    request.setRawHeader("Accept-Encoding", "identity");
+    request.setRawHeader("Range", QString("bytes=%1-%2").arg(segment.start + segment.received).arg(segment.end).toUtf8());
+
+    segment.reply = networkManager->get(request);
+    connect(segment.reply, &QNetworkReply::readyRead, this, [this, index]() { handleSegmentReadyRead(index); });
+    connect(segment.reply, &QNetworkReply::finished, this, [this, index]() { handleSegmentFinished(index); });
+}
+
+void NetworkUtils::handleSegmentReadyRead(int index)
+{
+    Segment &segment = segments[index];
+    if (!segment.reply)
+        return;
+
+    // A server answering 200 ignored the range and is sending the whole file
+    if (segment.reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+        failSegments("The server does not support range requests");
+        return;
+    }
+
+    const QByteArray data = segment.reply->readAll();
+    const qint64 length = qMin<qint64>(data.size(), segment.end - segment.start + 1 - segment.received);
+    if (!partFile->seek(segment.start + segment.received) || partFile->write(data.constData(), length) != length) {
+        failSegments("Cannot write to " + partPath());
+        return;
+    }
+
+    segment.received += length;
+    emit progressUpdated(segmentsReceived() - rangeStart, segmentedSize - rangeStart);
+}
+
+void NetworkUtils::handleSegmentFinished(int index)
+{
+    Segment &segment = segments[index];
+    if (!segment.reply)
+        return; // Stopped by stopSegments
+
+    if (segment.reply->error() == QNetworkReply::NoError && segment.reply->bytesAvailable() > 0) {
+        handleSegmentReadyRead(index);
+        if (!segment.reply)
+            return;
+    }
+
+    QNetworkReply *reply = segment.reply;
+    segment.reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        failSegments(errorString(reply->error()));
+        return;
+    }
+
+    if (segment.received != segment.end - segment.start + 1) {
+        failSegments("The connection closed before the range was complete");
+        return;
+    }
+
+    if (segmentsReceived() == segmentedSize)
+        completeSegments();
+}
+
+void NetworkUtils::completeSegments()
+{
+    saveTimer->stop();
+    partFile->close();
+    partFile->deleteLater();
+    partFile = nullptr;
+
+    // The empty file opened by the caller is replaced by the complete part file
+    const QString fileName = currentFile->fileName();
+    const QString partName = partPath();
+    currentFile->close();
+    currentFile->remove();
+    if (!QFile::rename(partName, fileName)) {
+        emit downloadError("Cannot rename " + partName + " to " + fileName);
+        return;
+    }
+
+    QFile::remove(segmentsPath());
+    currentFile = nullptr;
+    emit downloadFinished();
+}
+
+// Restores the ranges of an interrupted download, false if there is none to resume
+bool NetworkUtils::loadSegments()
+{
+    QFile stateFile(segmentsPath());
+    if (!stateFile.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject state = QJsonDocument::fromJson(stateFile.readAll()).object();
+    const qint64 size = state["size"].toInteger();
+    if (state["url"].toString() != segmentedUrl || size <= 0 || QFileInfo(partPath()).size() != size)
+        return false;
+
+    // The ranges must cover the file end to end
+    QVector<Segment> loaded;
+    qint64 next = 0;
+    for (const QJsonValue &value : state["segments"].toArray()) {
+        const QJsonObject object = value.toObject();
+        Segment segment = { object["start"].toInteger(), object["end"].toInteger(), object["received"].toInteger(), nullptr };
+        if (segment.start != next || segment.end < segment.start || segment.received < 0 ||
+            segment.received > segment.end - segment.start + 1)
+            return false;
+
+        next = segment.end + 1;
+        loaded.push_back(segment);
+    }
+    if (next != size)
+        return false;
+
+    partFile = new QFile(partPath(), this);
+    if (!partFile->open(QIODevice::ReadWrite)) {
+        delete partFile;
+        partFile = nullptr;
+        return false;
+    }
+
+    segments = loaded;
+    segmentedSize = size;
+    return true;
+}
+
+void NetworkUtils::saveSegments()
+{
+    if (!partFile)
+        return;
+
+    // The data reaches the file before the state records it as received
+    partFile->flush();
+
+    QJsonArray array;
+    for (const Segment &segment : segments)
+        array.append(QJsonObject{ { "start", segment.start }, { "end", segment.end }, { "received", segment.received } });
+
+    QJsonObject state{ { "url", segmentedUrl }, { "size", segmentedSize }, { "segments", array } };
+
+    // Written to a temporary file and renamed, an interruption never leaves a damaged state
+    QSaveFile stateFile(segmentsPath());
+    if (stateFile.open(QIODevice::WriteOnly)) {
+        stateFile.write(QJsonDocument(state).toJson(QJsonDocument::Compact));
+        stateFile.commit();
+    }
+}
+
+// Aborts the running ranges and saves how far each one got
+void NetworkUtils::stopSegments()
+{
+    saveTimer->stop();
+
+    for (Segment &segment : segments) {
+        if (QNetworkReply *reply = segment.reply) {
+            segment.reply = nullptr; // Cleared first, abort emits finished right away
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+
+    if (partFile) {
+        saveSegments();
+        partFile->close();
+        partFile->deleteLater();
+        partFile = nullptr;
+    }
+}
+
+void NetworkUtils::failSegments(const QString &errorMessage)
+{
+    stopSegments();
+    emit downloadError(errorMessage);
+    qWarning() << "Download error:" << errorMessage;
+}
+
+qint64 NetworkUtils::segmentsReceived() const
+{
+    qint64 received = 0;
+    for (const Segment &segment : segments)
+        received += segment.received;
+    return received;
+}
+
+QString NetworkUtils::partPath() const
+{
+    return currentFile ? currentFile->fileName() + ".part" : QString();
+}
+
+QString NetworkUtils::segmentsPath() const
+{
+    return currentFile ? currentFile->fileName() + ".segments" : QString();
+}
+
 QString errorString(QNetworkReply::NetworkError code)
 {
     switch (code) {
@@ -143,6 +440,12 @@ void NetworkUtils::handleDownloadProgress(qint64 bytesReceived, qint64 totalByte
 
 void NetworkUtils::cancelDownload()
 {
+    stopSegments();
+    if (!segmentedUrl.isEmpty()) {
+        QFile::remove(partPath());
+        QFile::remove(segmentsPath());
+    }
+
     if (currentReply) {
         currentReply->abort();
         currentReply->deleteLater();
@@ -159,6 +462,9 @@ void NetworkUtils::cancelDownload()
 
 void NetworkUtils::pauseDownload()
 {
+    // Each range resumes where it stopped on the next downloadSegmented
+    stopSegments();
+
     if (currentReply) {
         currentReply->abort();
         //bytesWritten = currentFile->pos(); // Save the position
@@ -6,10 +6,12 @@
 #include <QUrl>
 #include <QNetworkReply>
 #include <QNetworkAccessManager>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QNetworkAccessManager;
 class QNetworkReply;
+class QTimer;
 QT_END_NAMESPACE
 
 class NetworkUtils : public QObject {
@@ -22,6 +24,13 @@ public:
 
     qint64 startOffset();
 
+    /**
+     * @brief Returns the number of bytes of a file downloaded so far.
+     * @param fileName The destination file of the download.
+     * @return The bytes received by all ranges of a segmented download, the file size otherwise.
+     */
+    static qint64 downloadedSize(const QString &fileName);
+
 signals:
     void progressUpdated(qint64 bytesReceived, qint64 totalBytes);
     void downloadFinished();
@@ -30,16 +39,58 @@ signals:
 public slots:
     void downloadFile(const QString &url, QFile *file);
 
+    /**
+     * @brief Downloads a file over several connections, each fetching its own byte range.
+     *
+     * Ranges are written at their offsets in <file>.part and the bytes received
+     * for each one are saved in <file>.segments, so an interrupted download
+     * resumes every range where it stopped. The part file replaces the file once
+     * all ranges are complete. A file already holding a partial single stream
+     * download, or a server without range support, falls back to downloadFile.
+     *
+     * @param url The file to download.
+     * @param file The destination file, opened by the caller.
+     * @param segmentCount Number of parallel connections.
+     */
+    void downloadSegmented(const QString &url, QFile *file, int segmentCount);
+
 private slots:
     void handleReadyRead();
     void handleError(QNetworkReply::NetworkError code);
     void handleDownloadProgress(qint64 bytesReceived, qint64 totalBytes);
     
 private:
+    struct Segment {
+        qint64 start;
+        qint64 end;           ///< Last byte of the range, inclusive as in the Range header
+        qint64 received;
+        QNetworkReply *reply;
+    };
+
+    void startSegments(const QUrl &url);
+    void startSegment(int index, const QUrl &url);
+    void handleSegmentReadyRead(int index);
+    void handleSegmentFinished(int index);
+    void completeSegments();
+    bool loadSegments();
+    void saveSegments();
+    void stopSegments();
+    void failSegments(const QString &errorMessage);
+    qint64 segmentsReceived() const;
+    QString partPath() const;
+    QString segmentsPath() const;
+
     QNetworkAccessManager *networkManager;
     QFile *currentFile;
     QNetworkReply *currentReply;
     qint64 rangeStart;
+
+    // Segmented download state
+    QString segmentedUrl;
+    QFile *partFile;
+    QVector<Segment> segments;
+    qint64 segmentedSize;
+    QTimer *saveTimer;        ///< Saves the progress of the ranges while they download
 };
 
 #endif // NetworkUtils_H
@@ -3,18 +3,25 @@
 
 #include <string>
 #include <unordered_map>
+#include <cstdint>
 
 // GGUF Type Enum
 enum GGUFType {
     TYPE_UNKNOWN,
     TYPE_UINT32,
-    TYPE_STRING
+    TYPE_STRING,
+    TYPE_INT64,     // Other integer types, value is an int64_t
+    TYPE_FLOAT64,   // float32 and float64, value is a double
+    TYPE_BOOL,      // value is a bool
+    TYPE_ARRAY      // value is a summary string such as "[151936 x string]", elements are not decoded
 };
 
 // GGUF Metadata Entry
 struct GGUFMetadataEntry {
     GGUFType type;
     uint32_t ivalue;
+    int64_t lvalue = 0;
+    double fvalue = 0.0;
     std::string svalue;
 
     GGUFMetadataEntry() : type(TYPE_UNKNOWN), ivalue(0) {}
@@ -26,7 +33,14 @@ struct GGUFMetadataEntry {
         case TYPE_UINT32:
             return std::to_string(ivalue);
         case TYPE_STRING:
+        case TYPE_ARRAY:
             return svalue;
+        case TYPE_INT64:
+            return std::to_string(lvalue);
+        case TYPE_FLOAT64:
+            return std::to_string(fvalue);
+        case TYPE_BOOL:
+            return lvalue ? "true" : "false";
         default:
             return "[Unknown Type]";
         }
@@ -0,0 +1,406 @@
+#include "GGUFReader.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const uint32_t defaultAlignment = 32;
+
+// Size of a scalar of each type, 0 for strings and arrays
+size_t scalarSize(uint32_t type) {
+    switch (type) {
+    case GGUFReader::UINT8:
+    case GGUFReader::INT8:
+    case GGUFReader::BOOL:    return 1;
+    case GGUFReader::UINT16:
+    case GGUFReader::INT16:   return 2;
+    case GGUFReader::UINT32:
+    case GGUFReader::INT32:
+    case GGUFReader::FLOAT32: return 4;
+    case GGUFReader::UINT64:
+    case GGUFReader::INT64:
+    case GGUFReader::FLOAT64: return 8;
+    default:                  return 0;
+    }
+}
+
+template <typename T>
+T load(const uint8_t *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T)); // GGUF values are unaligned little endian
+    return value;
+}
+
+bool isInteger(uint32_t type) {
+    return type == GGUFReader::UINT8 || type == GGUFReader::INT8 || type == GGUFReader::UINT16 ||
+           type == GGUFReader::INT16 || type == GGUFReader::UINT32 || type == GGUFReader::INT32 ||
+           type == GGUFReader::UINT64 || type == GGUFReader::INT64 || type == GGUFReader::BOOL;
+}
+
+int64_t loadInteger(uint32_t type, const uint8_t *data) {
+    switch (type) {
+    case GGUFReader::UINT8:  return load<uint8_t>(data);
+    case GGUFReader::INT8:   return load<int8_t>(data);
+    case GGUFReader::BOOL:   return load<uint8_t>(data) != 0;
+    case GGUFReader::UINT16: return load<uint16_t>(data);
+    case GGUFReader::INT16:  return load<int16_t>(data);
+    case GGUFReader::UINT32: return load<uint32_t>(data);
+    case GGUFReader::INT32:  return load<int32_t>(data);
+    case GGUFReader::UINT64: return (int64_t)load<uint64_t>(data);
+    case GGUFReader::INT64:  return load<int64_t>(data);
+    default:                 return 0;
+    }
+}
+
+double loadNumber(uint32_t type, const uint8_t *data) {
+    if (type == GGUFReader::FLOAT32)
+        return load<float>(data);
+    if (type == GGUFReader::FLOAT64)
+        return load<double>(data);
+    if (type == GGUFReader::UINT64)
+        return (double)load<uint64_t>(data);
+    return (double)loadInteger(type, data);
+}
+
+/**
+ * Bounds checked reads over the mapping, every read fails once the end is passed.
+ */
+struct Cursor {
+    const uint8_t *data;
+    uint64_t size;
+    uint64_t pos = 0;
+
+    bool skip(uint64_t count) {
+        if (count > size - pos)
+            return false;
+        pos += count;
+        return true;
+    }
+
+    template <typename T>
+    bool read(T &value) {
+        if (sizeof(T) > size - pos)
+            return false;
+        value = load<T>(data + pos);
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string_view &value) {
+        uint64_t length;
+        if (!read(length) || length > size - pos)
+            return false;
+        value = std::string_view((const char *)data + pos, (size_t)length);
+        pos += length;
+        return true;
+    }
+
+    // Skips a value, string arrays are walked by their length prefixes without decoding
+    bool skipValue(uint32_t type, uint64_t count) {
+        const size_t scalar = scalarSize(type);
+        if (scalar > 0)
+            return count <= (size - pos) / scalar && skip(count * scalar);
+
+        if (type != GGUFReader::STRING)
+            return false;
+
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t length;
+            if (!read(length) || !skip(length))
+                return false;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+GGUFReader::~GGUFReader() {
+    close();
+}
+
+bool GGUFReader::fail(const std::string &message) {
+    error_ = message;
+    close();
+    return false;
+}
+
+bool GGUFReader::open(const std::string &path) {
+    close();
+    error_.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return fail("Failed to open GGUF file: " + path);
+    fileHandle_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+        return fail("Failed to read the size of GGUF file: " + path);
+    size_ = (uint64_t)fileSize.QuadPart;
+    if (size_ == 0)
+        return fail("GGUF file is empty: " + path);
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+        return fail("Failed to map GGUF file: " + path);
+    mappingHandle_ = mapping;
+
+    mapping_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping_)
+        return fail("Failed to map GGUF file: " + path);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return fail("Failed to open GGUF file: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return fail("GGUF file is empty or unreadable: " + path);
+    }
+    size_ = (uint64_t)st.st_size;
+
+    // The mapping keeps the file referenced, the descriptor is not needed afterwards
+    void *mapping = mmap(nullptr, (size_t)size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return fail("Failed to map GGUF file: " + path);
+    mapping_ = mapping;
+
+    // Only the header is read, in order, the tensor data is never faulted in
+    madvise(mapping_, (size_t)size_, MADV_SEQUENTIAL);
+#endif
+
+    base_ = (const uint8_t *)mapping_;
+    if (!parse()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GGUFReader::close() {
+#ifdef _WIN32
+    if (mapping_)
+        UnmapViewOfFile(mapping_);
+    if (mappingHandle_)
+        CloseHandle((HANDLE)mappingHandle_);
+    if (fileHandle_)
+        CloseHandle((HANDLE)fileHandle_);
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+#else
+    if (mapping_)
+        munmap(mapping_, (size_t)size_);
+#endif
+    mapping_ = nullptr;
+    base_ = nullptr;
+    size_ = 0;
+    version_ = 0;
+    dataOffset_ = 0;
+    keys_.clear();
+    values_.clear();
+    tensors_.clear();
+}
+
+bool GGUFReader::parse() {
+    Cursor cursor{ base_, size_ };
+
+    char magic[4];
+    if (size_ < sizeof(magic) || std::memcmp(base_, "GGUF", sizeof(magic)) != 0) {
+        error_ = "Not a GGUF file";
+        return false;
+    }
+    cursor.skip(sizeof(magic));
+
+    uint64_t tensorCount, keyCount;
+    if (!cursor.read(version_) || !cursor.read(tensorCount) || !cursor.read(keyCount)) {
+        error_ = "Truncated GGUF header";
+        return false;
+    }
+
+    // Version 1 used 32 bit counts and lengths, llama.cpp no longer loads it either
+    if (version_ < 2) {
+        error_ = "Unsupported GGUF version: " + std::to_string(version_);
+        return false;
+    }
+
+    // Every key and tensor needs at least a few bytes, reject counts the file cannot hold
+    if (keyCount > size_ / 12 || tensorCount > size_ / 24) {
+        error_ = "Invalid GGUF key or tensor count";
+        return false;
+    }
+
+    keys_.reserve((size_t)keyCount);
+    values_.reserve((size_t)keyCount);
+    for (uint64_t i = 0; i < keyCount; i++) {
+        std::string_view key;
+        uint32_t type;
+        if (!cursor.readString(key) || !cursor.read(type)) {
+            error_ = "Truncated GGUF key " + std::to_string(i);
+            return false;
+        }
+
+        Value value;
+        value.type = (ValueType)type;
+        if (type == ARRAY) {
+            uint32_t elementType;
+            if (!cursor.read(elementType) || !cursor.read(value.count) ||
+                elementType >= TYPE_COUNT || elementType == ARRAY) {
+                error_ = "Invalid GGUF array: " + std::string(key);
+                return false;
+            }
+            value.elementType = (ValueType)elementType;
+        }
+        else if (type >= TYPE_COUNT) {
+            error_ = "Invalid GGUF value type " + std::to_string(type) + " for key: " + std::string(key);
+            return false;
+        }
+        else {
+            value.elementType = value.type;
+        }
+
+        const uint64_t start = cursor.pos;
+        if (!cursor.skipValue(value.elementType, value.count)) {
+            error_ = "Truncated GGUF value: " + std::string(key);
+            return false;
+        }
+        value.data = base_ + start;
+        value.size = (size_t)(cursor.pos - start);
+
+        keys_.push_back(key);
+        values_[key] = value;
+    }
+
+    tensors_.resize((size_t)tensorCount);
+    for (uint64_t i = 0; i < tensorCount; i++) {
+        TensorInfo &tensor = tensors_[(size_t)i];
+        uint32_t dimCount;
+        if (!cursor.readString(tensor.name) || !cursor.read(dimCount) || dimCount > 8) {
+            error_ = "Invalid GGUF tensor info " + std::to_string(i);
+            return false;
+        }
+
+        tensor.dims.resize(dimCount);
+        for (uint32_t d = 0; d < dimCount; d++) {
+            if (!cursor.read(tensor.dims[d])) {
+                error_ = "Truncated GGUF tensor info: " + std::string(tensor.name);
+                return false;
+            }
+        }
+
+        if (!cursor.read(tensor.type) || !cursor.read(tensor.offset)) {
+            error_ = "Truncated GGUF tensor info: " + std::string(tensor.name);
+            return false;
+        }
+    }
+
+    int64_t alignment = defaultAlignment;
+    if (!getInt("general.alignment", alignment) || alignment <= 0 || (alignment & (alignment - 1)) != 0)
+        alignment = defaultAlignment;
+    dataOffset_ = (cursor.pos + alignment - 1) / alignment * alignment;
+
+    return true;
+}
+
+const GGUFReader::Value *GGUFReader::find(std::string_view key) const {
+    auto found = values_.find(key);
+    return found != values_.end() ? &found->second : nullptr;
+}
+
+bool GGUFReader::getInt(std::string_view key, int64_t &value) const {
+    const Value *found = find(key);
+    if (!found || !isInteger(found->type))
+        return false;
+    value = loadInteger(found->type, found->data);
+    return true;
+}
+
+bool GGUFReader::getFloat(std::string_view key, double &value) const {
+    const Value *found = find(key);
+    if (!found || found->type == STRING || found->type == ARRAY)
+        return false;
+    value = loadNumber(found->type, found->data);
+    return true;
+}
+
+bool GGUFReader::getString(std::string_view key, std::string_view &value) const {
+    const Value *found = find(key);
+    if (!found || found->type != STRING)
+        return false;
+    value = std::string_view((const char *)found->data + sizeof(uint64_t), found->size - sizeof(uint64_t));
+    return true;
+}
+
+bool GGUFReader::getStringArray(std::string_view key, std::vector<std::string_view> &values) const {
+    const Value *found = find(key);
+    if (!found || found->type != ARRAY || found->elementType != STRING)
+        return false;
+
+    // The array was validated while indexing, the reads cannot fail
+    Cursor cursor{ found->data, found->size };
+    values.resize((size_t)found->count);
+    for (auto &value : values)
+        cursor.readString(value);
+    return true;
+}
+
+bool GGUFReader::getNumberArray(std::string_view key, std::vector<double> &values) const {
+    const Value *found = find(key);
+    if (!found || found->type != ARRAY || found->elementType == STRING)
+        return false;
+
+    const size_t scalar = scalarSize(found->elementType);
+    values.resize((size_t)found->count);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = loadNumber(found->elementType, found->data + i * scalar);
+    return true;
+}
+
+std::string GGUFReader::toString(const Value &value) {
+    switch (value.type) {
+    case STRING:
+        return std::string((const char *)value.data + sizeof(uint64_t), value.size - sizeof(uint64_t));
+    case ARRAY:
+        return "[" + std::to_string(value.count) + " x " + typeName(value.elementType) + "]";
+    case BOOL:
+        return load<uint8_t>(value.data) ? "true" : "false";
+    case FLOAT32:
+    case FLOAT64:
+        return std::to_string(loadNumber(value.type, value.data));
+    case UINT64:
+        return std::to_string(load<uint64_t>(value.data));
+    default:
+        return std::to_string(loadInteger(value.type, value.data));
+    }
+}
+
+const char *GGUFReader::typeName(ValueType type) {
+    switch (type) {
+    case UINT8:   return "uint8";
+    case INT8:    return "int8";
+    case UINT16:  return "uint16";
+    case INT16:   return "int16";
+    case UINT32:  return "uint32";
+    case INT32:   return "int32";
+    case FLOAT32: return "float32";
+    case BOOL:    return "bool";
+    case STRING:  return "string";
+    case ARRAY:   return "array";
+    case UINT64:  return "uint64";
+    case INT64:   return "int64";
+    case FLOAT64: return "float64";
+    default:      return "unknown";
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef GGUFReader_h
+#define GGUFReader_h
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Reads the header of a GGUF file without loading the model.
+ *
+ * The file is memory mapped and only the key/value section and the tensor
+ * infos are walked, the tensor data is never touched. Values are not decoded
+ * while indexing: a key records where its value lives and arrays are skipped
+ * over, so a tokenizer vocabulary of 150k strings costs a pass over its length
+ * prefixes and is only materialized when asked for. Keys, strings and tensor
+ * names are views into the mapping and stay valid until the reader is closed.
+ */
+class GGUFReader {
+public:
+    /**
+     * @brief Value types as stored in the file.
+     */
+    enum ValueType : uint32_t {
+        UINT8   = 0,
+        INT8    = 1,
+        UINT16  = 2,
+        INT16   = 3,
+        UINT32  = 4,
+        INT32   = 5,
+        FLOAT32 = 6,
+        BOOL    = 7,
+        STRING  = 8,
+        ARRAY   = 9,
+        UINT64  = 10,
+        INT64   = 11,
+        FLOAT64 = 12,
+        TYPE_COUNT
+    };
+
+    /**
+     * @brief Location of an undecoded value in the mapping.
+     */
+    struct Value {
+        ValueType type = UINT8;
+        ValueType elementType = UINT8;  ///< Type of the elements of an array.
+        uint64_t count = 1;             ///< Number of elements of an array, 1 for a scalar.
+        const uint8_t *data = nullptr;  ///< First byte of the value, after the array header for arrays.
+        size_t size = 0;                ///< Bytes spanned by the value.
+    };
+
+    /**
+     * @brief Description of a tensor stored in the file.
+     */
+    struct TensorInfo {
+        std::string_view name;
+        std::vector<uint64_t> dims;
+        uint32_t type = 0;              ///< ggml_type of the tensor data.
+        uint64_t offset = 0;            ///< Offset of the data from dataOffset().
+
+        /**
+         * @brief Returns the number of elements of the tensor.
+         */
+        uint64_t elementCount() const {
+            uint64_t count = 1;
+            for (uint64_t dim : dims)
+                count *= dim;
+            return count;
+        }
+    };
+
+    GGUFReader() = default;
+    ~GGUFReader();
+
+    GGUFReader(const GGUFReader&) = delete;
+    GGUFReader& operator=(const GGUFReader&) = delete;
+
+    /**
+     * @brief Maps a file and indexes its keys and tensor infos.
+     * @param path Path to the GGUF file.
+     * @return True on success, false if the file cannot be mapped or is malformed, see error().
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Unmaps the file, invalidating every view returned by the reader.
+     */
+    void close();
+
+    /**
+     * @brief Returns the reason the last open failed.
+     */
+    const std::string &error() const { return error_; }
+
+    uint32_t version() const { return version_; }
+    uint64_t fileSize() const { return size_; }
+
+    /**
+     * @brief Returns the offset of the tensor data section in the file.
+     */
+    uint64_t dataOffset() const { return dataOffset_; }
+
+    /**
+     * @brief Returns the keys in file order.
+     */
+    const std::vector<std::string_view> &keys() const { return keys_; }
+
+    /**
+     * @brief Returns the tensor infos in file order.
+     */
+    const std::vector<TensorInfo> &tensors() const { return tensors_; }
+
+    /**
+     * @brief Returns the value of a key, nullptr if the key is missing.
+     */
+    const Value *find(std::string_view key) const;
+
+    /**
+     * @brief Reads an integer or bool scalar.
+     * @return True if the key exists and holds an integer or bool.
+     */
+    bool getInt(std::string_view key, int64_t &value) const;
+
+    /**
+     * @brief Reads a float or integer scalar.
+     * @return True if the key exists and holds a number.
+     */
+    bool getFloat(std::string_view key, double &value) const;
+
+    /**
+     * @brief Reads a string scalar.
+     * @return True if the key exists and holds a string.
+     */
+    bool getString(std::string_view key, std::string_view &value) const;
+
+    /**
+     * @brief Decodes every element of a string array.
+     * @return True if the key exists and holds an array of strings.
+     */
+    bool getStringArray(std::string_view key, std::vector<std::string_view> &values) const;
+
+    /**
+     * @brief Decodes every element of a numeric array, converted to double.
+     * @return True if the key exists and holds an array of numbers or bools.
+     */
+    bool getNumberArray(std::string_view key, std::vector<double> &values) const;
+
+    /**
+     * @brief Formats a value for display, arrays are summarized as "[count x type]".
+     */
+    static std::string toString(const Value &value);
+
+    /**
+     * @brief Returns the name of a value type, e.g. "uint32".
+     */
+    static const char *typeName(ValueType type);
+
+private:
+    bool fail(const std::string &message);
+    bool parse();
+
+    void *mapping_ = nullptr;
+    const uint8_t *base_ = nullptr;
+    uint64_t size_ = 0;
+#ifdef _WIN32
+    void *fileHandle_ = nullptr;
+    void *mappingHandle_ = nullptr;
+#endif
+
+    uint32_t version_ = 0;
+    uint64_t dataOffset_ = 0;
+    std::vector<std::string_view> keys_;
+    std::unordered_map<std::string_view, Value> values_;
+    std::vector<TensorInfo> tensors_;
+    std::string error_;
+};
+
+#endif // GGUFReader_h
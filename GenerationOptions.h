@@ -0,0 +1,98 @@
+#ifndef GenerationOptions_h
+#define GenerationOptions_h
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+ * @brief Reason a response generation ended.
+ */
+typedef enum {
+    FINISH_EOG,            ///< The model produced an end of generation token
+    FINISH_CONTEXT_FULL,   ///< The context window is full
+    FINISH_STOP_SEQUENCE,  ///< A stop string was matched
+    FINISH_MAX_TOKENS,     ///< The max_tokens limit was reached
+    FINISH_DEADLINE,       ///< The timeout_ms deadline passed
+    FINISH_ERROR,          ///< Generation failed
+    FINISH_CANCELLED       ///< The caller ended the generation early
+} FinishReason;
+
+/**
+ * @brief Parameters of a sampler chain.
+ *
+ * The chain applies the repetition penalties, then top-k, top-p and min-p
+ * filtering, then temperature and draws from the remaining distribution.
+ * A temperature of 0 or less selects the most probable token instead.
+ */
+struct SamplerSettings {
+    float temperature = 0.8f;        ///< Randomness of the distribution, 0 or less for greedy decoding.
+    int topK = 40;                   ///< Keep the K most probable tokens, 0 to disable.
+    float topP = 1.0f;               ///< Nucleus probability mass, 1.0 to disable.
+    float minP = 0.05f;              ///< Minimum probability relative to the best token, 0 to disable.
+    float repetitionPenalty = 1.0f;  ///< Penalty of repeated tokens, 1.0 to disable.
+    float frequencyPenalty = 0.0f;   ///< Penalty growing with a token's frequency, 0 to disable.
+    float presencePenalty = 0.0f;    ///< Penalty of any token already present, 0 to disable.
+    int penaltyLastN = 64;           ///< Number of recent tokens the penalties look at, -1 for the whole context.
+    int64_t seed = -1;               ///< Seed of the distribution sampler, -1 for a random seed.
+
+    /**
+     * @brief Sets a parameter by its option name.
+     * @param key One of temperature, top_k, top_p, min_p, repetition_penalty,
+     *            frequency_penalty, presence_penalty, penalty_last_n or seed.
+     * @param value The parameter value.
+     * @return False if the name is not a sampler parameter.
+     */
+    bool set(const std::string &key, double value) {
+        if (key == "temperature")
+            temperature = (float)value;
+        else if (key == "top_k")
+            topK = (int)value;
+        else if (key == "top_p" || key == "top_P")
+            topP = (float)value;
+        else if (key == "min_p")
+            minP = (float)value;
+        else if (key == "repetition_penalty")
+            repetitionPenalty = (float)value;
+        else if (key == "frequency_penalty")
+            frequencyPenalty = (float)value;
+        else if (key == "presence_penalty")
+            presencePenalty = (float)value;
+        else if (key == "penalty_last_n")
+            penaltyLastN = (int)value;
+        else if (key == "seed")
+            seed = (int64_t)value;
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Returns true if the name is a sampler parameter accepted by set.
+     */
+    static bool isParameter(const std::string &key) {
+        SamplerSettings settings;
+        return settings.set(key, 0.0);
+    }
+};
+
+/**
+ * @brief Per request options applied to a single response generation.
+ *
+ * Default constructed options reproduce the behaviour of a plain
+ * generateResponse call.
+ */
+struct GenerationOptions {
+    std::string grammar;              ///< GBNF grammar constraining the output, empty for none.
+    std::string grammarRoot = "root"; ///< Start rule of the grammar.
+    std::string jsonSchema;           ///< JSON schema constraining the output, converted to a grammar.
+    std::vector<std::string> stop;    ///< Stop strings ending the generation, excluded from the response.
+    int maxTokens = 0;                ///< Maximum number of generated tokens, 0 for no limit.
+    int timeoutMs = 0;                ///< Wall clock budget of the request in milliseconds, 0 for no limit.
+    std::string lora;                 ///< LoRA adapter overriding the session's selection, empty to keep it.
+    float loraScale = 1.0f;           ///< Scale of the overriding LoRA adapter.
+    std::vector<std::pair<std::string, double>> sampler; ///< Sampler parameters overriding the session's, applied in order.
+};
+
+#endif // GenerationOptions_h
@@ -0,0 +1,54 @@
+#ifndef GenerationStream_h
+#define GenerationStream_h
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "llama.h"
+
+#include "GenerationOptions.h"
+#include "StopSequenceMatcher.h"
+
+/**
+ * @brief State of a generation that is advanced one token at a time.
+ *
+ * Everything the decode loop keeps between tokens lives here, so a generation can
+ * be suspended after any token and resumed later from another call. The stream
+ * owns its per request samplers and frees them when it is destroyed.
+ */
+struct GenerationStream {
+    llama_sampler *grammar = nullptr;       ///< Per request grammar, owned.
+    llama_sampler *requestChain = nullptr;  ///< Per request sampler chain, owned.
+    llama_sampler *chain = nullptr;         ///< Chain sampling the tokens, the request chain or the session's.
+
+    StopSequenceMatcher stopMatcher;
+    std::chrono::steady_clock::time_point deadline;
+    int maxTokens = 0;
+    int timeoutMs = 0;
+
+    std::vector<llama_token> promptTokens;
+    llama_batch batch = {};                 ///< Next batch to decode, the prompt then each sampled token.
+    llama_token token = 0;
+    long tokenCount = 0;
+    bool finished = false;
+
+    // Set by the pull API, the callback based generation keeps these in locals
+    std::string prompt;                     ///< Templated prompt of the turn, added to the context hash.
+    std::string cacheKey;                   ///< Response cache key, empty if the response is not cached.
+    std::string cached;                     ///< Cached response returned instead of generating.
+    bool fromCache = false;                 ///< The response comes from the cache, nothing is decoded.
+
+    GenerationStream() = default;
+    GenerationStream(const GenerationStream&) = delete;
+    GenerationStream& operator=(const GenerationStream&) = delete;
+
+    ~GenerationStream() {
+        if (grammar)
+            llama_sampler_free(grammar);
+        if (requestChain)
+            llama_sampler_free(requestChain);
+    }
+};
+
+#endif // GenerationStream_h
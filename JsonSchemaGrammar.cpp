@@ -0,0 +1,313 @@
+#include "JsonSchemaGrammar.h"
+#include "JsonValue.h"
+
+#include <cctype>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace {
+
+// Primitive rules, in the JSON grammar shipped with llama.cpp
+struct PrimitiveRule {
+    const char* name;
+    const char* body;
+    std::vector<const char*> dependencies;
+};
+
+const PrimitiveRule primitiveRules[] = {
+    { "space", "| \" \" | \"\\n\" [ \\t]{0,20}", {} },
+    { "char", "[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\bfnrt] | \"u\" [0-9a-fA-F]{4})", {} },
+    { "integral-part", "[0] | [1-9] [0-9]{0,15}", {} },
+    { "string", "\"\\\"\" char* \"\\\"\" space", { "char", "space" } },
+    { "number", "(\"-\"? integral-part) (\".\" [0-9]+)? ([eE] [-+]? [0-9]+)? space", { "integral-part", "space" } },
+    { "integer", "(\"-\"? integral-part) space", { "integral-part", "space" } },
+    { "boolean", "(\"true\" | \"false\") space", { "space" } },
+    { "null", "\"null\" space", { "space" } },
+    { "value", "object | array | string | number | boolean | null", { "object", "array", "string", "number", "boolean", "null" } },
+    { "object", "\"{\" space ( string \":\" space value (\",\" space string \":\" space value)* )? \"}\" space", { "string", "value", "space" } },
+    { "array", "\"[\" space ( value (\",\" space value)* )? \"]\" space", { "value", "space" } },
+};
+
+/**
+ * @brief Walks a schema and accumulates the grammar rules.
+ */
+class SchemaConverter {
+public:
+    explicit SchemaConverter(const JsonValue& root) : rootSchema(root) {}
+
+    std::string error;
+
+    bool convert(std::string& grammar) {
+        std::string root = visit(rootSchema, "root");
+        if (!error.empty())
+            return false;
+
+        if (root != "root")
+            setRule("root", root);
+
+        grammar.clear();
+        for (const auto& name : ruleOrder)
+            grammar += name + " ::= " + rules[name] + "\n";
+        return true;
+    }
+
+private:
+    const JsonValue& rootSchema;
+    std::map<std::string, std::string> rules;
+    std::vector<std::string> ruleOrder;
+    std::map<std::string, std::string> refRules; // $ref path to rule name
+    std::set<std::string> reserved;              // reference rules still being visited
+
+    static std::string literal(const std::string& text) {
+        std::string result = "\"";
+        for (char c : text) {
+            switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:   result += c;
+            }
+        }
+        return result + "\"";
+    }
+
+    static std::string sanitize(const std::string& name) {
+        std::string result;
+        for (char c : name)
+            result += (isalnum((unsigned char)c) || c == '-') ? c : '-';
+        return result.empty() ? "rule" : result;
+    }
+
+    void setRule(const std::string& name, const std::string& body) {
+        if (rules.find(name) == rules.end())
+            ruleOrder.push_back(name);
+        rules[name] = body;
+    }
+
+    // Adds a rule under a unique name derived from `name` and returns the name used
+    std::string addRule(const std::string& name, const std::string& body) {
+        std::string key = sanitize(name);
+
+        // A reference placeholder is replaced by the rule it stands for
+        if (reserved.erase(key)) {
+            setRule(key, body);
+            return key;
+        }
+
+        auto it = rules.find(key);
+        if (it != rules.end() && it->second != body) {
+            int i = 1;
+            while (rules.find(key + "-" + std::to_string(i)) != rules.end())
+                i++;
+            key += "-" + std::to_string(i);
+        }
+        setRule(key, body);
+        return key;
+    }
+
+    std::string primitive(const std::string& name) {
+        for (const auto& rule : primitiveRules) {
+            if (name == rule.name) {
+                if (rules.find(name) == rules.end()) {
+                    setRule(name, rule.body);
+                    for (const char* dependency : rule.dependencies)
+                        primitive(dependency);
+                }
+                return name;
+            }
+        }
+        return "value";
+    }
+
+    std::string alternatives(const std::vector<std::string>& items) {
+        std::string result;
+        for (size_t i = 0; i < items.size(); i++) {
+            if (i > 0)
+                result += " | ";
+            result += items[i];
+        }
+        return result;
+    }
+
+    std::string visitRef(const std::string& ref) {
+        auto it = refRules.find(ref);
+        if (it != refRules.end())
+            return it->second;
+
+        const JsonValue* target = nullptr;
+        std::string definition;
+        for (const char* prefix : { "#/definitions/", "#/$defs/" }) {
+            std::string p(prefix);
+            if (ref.compare(0, p.size(), p) == 0) {
+                definition = ref.substr(p.size());
+                const JsonValue* defs = rootSchema.get(p.substr(2, p.size() - 3));
+                if (defs)
+                    target = defs->get(definition);
+            }
+        }
+
+        if (!target) {
+            error = "Unresolved schema reference: " + ref;
+            return "value";
+        }
+
+        // Register the name first so recursive references terminate
+        std::string name = addRule("ref-" + definition, "value");
+        refRules[ref] = name;
+        reserved.insert(name);
+        primitive("value");
+
+        std::string body = visit(*target, name);
+        if (reserved.erase(name))
+            setRule(name, body);
+        return name;
+    }
+
+    std::string visitObject(const JsonValue& schema, const std::string& name) {
+        const JsonValue* properties = schema.get("properties");
+        if (!properties || !properties->isObject() || properties->objectValue.empty())
+            return primitive("object");
+
+        std::set<std::string> required;
+        if (const JsonValue* list = schema.get("required")) {
+            for (const auto& item : list->arrayValue) {
+                if (item.isString())
+                    required.insert(item.stringValue);
+            }
+        }
+
+        primitive("space");
+
+        std::vector<std::string> requiredMembers;
+        std::vector<std::string> optionalMembers;
+        for (const auto& property : properties->objectValue) {
+            std::string valueRule = visit(property.second, name + "-" + property.first);
+            std::string member = literal(JsonValue::quote(property.first)) + " space \":\" space " + valueRule;
+            if (required.count(property.first))
+                requiredMembers.push_back(member);
+            else
+                optionalMembers.push_back(member);
+        }
+
+        std::string body = "\"{\" space ";
+        if (!requiredMembers.empty()) {
+            // Required members in schema order, optional members may follow each prefixed by a comma
+            for (size_t i = 0; i < requiredMembers.size(); i++)
+                body += (i > 0 ? "\",\" space " : "") + requiredMembers[i] + " ";
+            for (const auto& member : optionalMembers)
+                body += "(\",\" space " + member + ")? ";
+        } else {
+            // Any subset of optional members in schema order, the first one has no comma
+            std::vector<std::string> choices;
+            for (size_t i = 0; i < optionalMembers.size(); i++) {
+                std::string choice = optionalMembers[i];
+                for (size_t j = i + 1; j < optionalMembers.size(); j++)
+                    choice += " (\",\" space " + optionalMembers[j] + ")?";
+                choices.push_back(choice);
+            }
+            body += "( " + alternatives(choices) + " )? ";
+        }
+        body += "\"}\" space";
+
+        return addRule(name, body);
+    }
+
+    std::string visitType(const JsonValue& schema, const std::string& type, const std::string& name) {
+        if (type == "object")
+            return visitObject(schema, name);
+
+        if (type == "array") {
+            const JsonValue* items = schema.get("items");
+            if (!items)
+                return primitive("array");
+
+            std::string item = visit(*items, name + "-item");
+            primitive("space");
+            return addRule(name, "\"[\" space ( " + item + " (\",\" space " + item + ")* )? \"]\" space");
+        }
+
+        if (type == "string" || type == "number" || type == "integer" || type == "boolean" || type == "null")
+            return primitive(type);
+
+        error = "Unsupported schema type: " + type;
+        return "value";
+    }
+
+    std::string visit(const JsonValue& schema, const std::string& name) {
+        if (!error.empty())
+            return "value";
+
+        // true or {} accept any value
+        if (!schema.isObject() || schema.objectValue.empty())
+            return primitive("value");
+
+        if (const JsonValue* ref = schema.get("$ref")) {
+            if (ref->isString())
+                return visitRef(ref->stringValue);
+        }
+
+        if (const JsonValue* constant = schema.get("const")) {
+            primitive("space");
+            return addRule(name, literal(constant->dump()) + " space");
+        }
+
+        if (const JsonValue* values = schema.get("enum")) {
+            std::vector<std::string> items;
+            for (const auto& value : values->arrayValue)
+                items.push_back(literal(value.dump()));
+            primitive("space");
+            return addRule(name, "(" + alternatives(items) + ") space");
+        }
+
+        for (const char* key : { "anyOf", "oneOf" }) {
+            if (const JsonValue* options = schema.get(key)) {
+                std::vector<std::string> items;
+                for (size_t i = 0; i < options->arrayValue.size(); i++)
+                    items.push_back(visit(options->arrayValue[i], name + "-" + std::to_string(i)));
+                return addRule(name, alternatives(items));
+            }
+        }
+
+        if (const JsonValue* type = schema.get("type")) {
+            if (type->isString())
+                return visitType(schema, type->stringValue, name);
+
+            if (type->isArray()) {
+                std::vector<std::string> items;
+                for (const auto& t : type->arrayValue) {
+                    if (t.isString())
+                        items.push_back(visitType(schema, t.stringValue, name + "-" + t.stringValue));
+                }
+                return addRule(name, alternatives(items));
+            }
+        }
+
+        if (schema.get("properties"))
+            return visitObject(schema, name);
+
+        return primitive("value");
+    }
+};
+
+} // namespace
+
+bool JsonSchemaGrammar::convert(const std::string& schema, std::string& grammar, std::string* error) {
+    JsonValue root;
+    std::string parseError;
+    if (!JsonValue::parse(schema, root, &parseError)) {
+        if (error)
+            *error = "Invalid JSON schema: " + parseError;
+        return false;
+    }
+
+    SchemaConverter converter(root);
+    if (!converter.convert(grammar)) {
+        if (error)
+            *error = converter.error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef JsonSchemaGrammar_h
+#define JsonSchemaGrammar_h
+
+#include <string>
+
+/**
+ * @brief Converts a JSON schema into a GBNF grammar for constrained decoding.
+ *
+ * Supports the subset of JSON schema used for structured extraction: object
+ * properties with required members, arrays with items, string, number, integer,
+ * boolean and null types, enum and const values, anyOf/oneOf alternatives and
+ * local $ref references into "definitions" or "$defs". Unsupported keywords such
+ * as string formats or length limits are ignored, the output stays valid JSON.
+ */
+class JsonSchemaGrammar {
+public:
+    /**
+     * @brief Converts a JSON schema to a GBNF grammar with a "root" rule.
+     * @param schema The JSON schema text.
+     * @param grammar Receives the GBNF grammar.
+     * @param error Optional, receives a description of the error on failure.
+     * @return True if the conversion succeeded, false otherwise.
+     */
+    static bool convert(const std::string& schema, std::string& grammar, std::string* error = nullptr);
+};
+
+#endif // JsonSchemaGrammar_h
@@ -0,0 +1,359 @@
+#include "JsonValue.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+JsonValue JsonValue::array() {
+    JsonValue value;
+    value.type = Type::Array;
+    return value;
+}
+
+JsonValue JsonValue::object() {
+    JsonValue value;
+    value.type = Type::Object;
+    return value;
+}
+
+const JsonValue* JsonValue::get(const std::string& key) const {
+    if (type != Type::Object)
+        return nullptr;
+
+    for (const auto& member : objectValue) {
+        if (member.first == key)
+            return &member.second;
+    }
+    return nullptr;
+}
+
+void JsonValue::set(const std::string& key, JsonValue value) {
+    type = Type::Object;
+    for (auto& member : objectValue) {
+        if (member.first == key) {
+            member.second = std::move(value);
+            return;
+        }
+    }
+    objectValue.emplace_back(key, std::move(value));
+}
+
+void JsonValue::append(JsonValue value) {
+    type = Type::Array;
+    arrayValue.push_back(std::move(value));
+}
+
+std::string JsonValue::getString(const std::string& key, const std::string& defaultValue) const {
+    const JsonValue* value = get(key);
+    return (value && value->isString()) ? value->stringValue : defaultValue;
+}
+
+double JsonValue::getNumber(const std::string& key, double defaultValue) const {
+    const JsonValue* value = get(key);
+    return (value && value->isNumber()) ? value->numberValue : defaultValue;
+}
+
+std::string JsonValue::quote(const std::string& text) {
+    std::string result = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\b': result += "\\b"; break;
+        case '\f': result += "\\f"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            } else {
+                result += (char)c;
+            }
+        }
+    }
+    result += "\"";
+    return result;
+}
+
+std::string JsonValue::dump() const {
+    switch (type) {
+    case Type::Null:
+        return "null";
+    case Type::Bool:
+        return boolValue ? "true" : "false";
+    case Type::Number: {
+        if (!std::isfinite(numberValue))
+            return "null";
+
+        char buf[32];
+        // Print integral values without a fraction so ids and counts round trip
+        if (numberValue == std::floor(numberValue) && std::fabs(numberValue) < 1e15)
+            std::snprintf(buf, sizeof(buf), "%.0f", numberValue);
+        else
+            std::snprintf(buf, sizeof(buf), "%.17g", numberValue);
+        return buf;
+    }
+    case Type::String:
+        return quote(stringValue);
+    case Type::Array: {
+        std::string result = "[";
+        for (size_t i = 0; i < arrayValue.size(); i++) {
+            if (i > 0)
+                result += ",";
+            result += arrayValue[i].dump();
+        }
+        return result + "]";
+    }
+    case Type::Object: {
+        std::string result = "{";
+        for (size_t i = 0; i < objectValue.size(); i++) {
+            if (i > 0)
+                result += ",";
+            result += quote(objectValue[i].first) + ":" + objectValue[i].second.dump();
+        }
+        return result + "}";
+    }
+    }
+    return "null";
+}
+
+namespace {
+
+/**
+ * @brief Recursive descent parser over a JSON text.
+ */
+struct JsonParser {
+    const std::string& text;
+    size_t pos = 0;
+    std::string error;
+
+    explicit JsonParser(const std::string& input) : text(input) {}
+
+    bool fail(const std::string& message) {
+        if (error.empty())
+            error = message + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+            pos++;
+    }
+
+    bool consume(const char* literal) {
+        size_t i = 0;
+        while (literal[i]) {
+            if (pos + i >= text.size() || text[pos + i] != literal[i])
+                return false;
+            i++;
+        }
+        pos += i;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned int& value) {
+        if (pos + 4 > text.size())
+            return fail("Truncated unicode escape");
+
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[pos++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return fail("Invalid unicode escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (pos >= text.size() || text[pos] != '"')
+            return fail("Expected string");
+        pos++;
+
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"')
+                return true;
+
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (pos >= text.size())
+                break;
+
+            char e = text[pos++];
+            switch (e) {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                unsigned int cp;
+                if (!parseHex4(cp))
+                    return false;
+
+                // Combine UTF-16 surrogate pairs
+                if (cp >= 0xD800 && cp <= 0xDBFF && consume("\\u")) {
+                    unsigned int low;
+                    if (!parseHex4(low))
+                        return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default:
+                return fail("Invalid escape sequence");
+            }
+        }
+        return fail("Unterminated string");
+    }
+
+    bool parseNumber(JsonValue& value) {
+        size_t start = pos;
+        if (pos < text.size() && text[pos] == '-')
+            pos++;
+        while (pos < text.size() && (isdigit((unsigned char)text[pos]) || text[pos] == '.' || text[pos] == 'e' ||
+                                     text[pos] == 'E' || text[pos] == '+' || text[pos] == '-'))
+            pos++;
+
+        std::string number = text.substr(start, pos - start);
+        char* end = nullptr;
+        double result = std::strtod(number.c_str(), &end);
+        if (number.empty() || !end || *end != '\0')
+            return fail("Invalid number");
+
+        value = JsonValue(result);
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > 256)
+            return fail("Nesting too deep");
+
+        skipWhitespace();
+        if (pos >= text.size())
+            return fail("Unexpected end of input");
+
+        char c = text[pos];
+        if (c == '{') {
+            pos++;
+            value = JsonValue::object();
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skipWhitespace();
+                std::string key;
+                if (!parseString(key))
+                    return false;
+                skipWhitespace();
+                if (!consume(":"))
+                    return fail("Expected ':'");
+                JsonValue member;
+                if (!parseValue(member, depth + 1))
+                    return false;
+                value.objectValue.emplace_back(std::move(key), std::move(member));
+                skipWhitespace();
+                if (consume(","))
+                    continue;
+                if (consume("}"))
+                    return true;
+                return fail("Expected ',' or '}'");
+            }
+        }
+
+        if (c == '[') {
+            pos++;
+            value = JsonValue::array();
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                JsonValue element;
+                if (!parseValue(element, depth + 1))
+                    return false;
+                value.arrayValue.push_back(std::move(element));
+                skipWhitespace();
+                if (consume(","))
+                    continue;
+                if (consume("]"))
+                    return true;
+                return fail("Expected ',' or ']'");
+            }
+        }
+
+        if (c == '"') {
+            std::string str;
+            if (!parseString(str))
+                return false;
+            value = JsonValue(std::move(str));
+            return true;
+        }
+
+        if (consume("true")) {
+            value = JsonValue(true);
+            return true;
+        }
+        if (consume("false")) {
+            value = JsonValue(false);
+            return true;
+        }
+        if (consume("null")) {
+            value = JsonValue();
+            return true;
+        }
+
+        return parseNumber(value);
+    }
+};
+
+} // namespace
+
+bool JsonValue::parse(const std::string& text, JsonValue& value, std::string* error) {
+    JsonParser parser(text);
+    bool success = parser.parseValue(value, 0);
+    if (success) {
+        parser.skipWhitespace();
+        if (parser.pos != text.size())
+            success = parser.fail("Unexpected trailing characters");
+    }
+
+    if (!success && error)
+        *error = parser.error;
+    return success;
+}
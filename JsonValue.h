@@ -0,0 +1,114 @@
+#ifndef JsonValue_h
+#define JsonValue_h
+
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @brief Minimal JSON document value used by the engine.
+ *
+ * Supports parsing and serialising the JSON needed by LlamaEngine (schemas,
+ * JSONL batch files, index files). Object members keep their document order,
+ * which matters when a JSON schema is turned into a grammar.
+ */
+class JsonValue {
+public:
+    /**
+     * @brief Type of a JSON value.
+     */
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    JsonValue() = default;
+    JsonValue(bool value) : type(Type::Bool), boolValue(value) {}
+    JsonValue(double value) : type(Type::Number), numberValue(value) {}
+    JsonValue(int value) : type(Type::Number), numberValue(value) {}
+    JsonValue(long long value) : type(Type::Number), numberValue((double)value) {}
+    JsonValue(const char* value) : type(Type::String), stringValue(value) {}
+    JsonValue(std::string value) : type(Type::String), stringValue(std::move(value)) {}
+
+    /**
+     * @brief Creates an empty JSON array.
+     */
+    static JsonValue array();
+
+    /**
+     * @brief Creates an empty JSON object.
+     */
+    static JsonValue object();
+
+    Type type = Type::Null; ///< Type of the value.
+    bool boolValue = false; ///< Value when type is Bool.
+    double numberValue = 0.0; ///< Value when type is Number.
+    std::string stringValue; ///< Value when type is String.
+    std::vector<JsonValue> arrayValue; ///< Elements when type is Array.
+    std::vector<std::pair<std::string, JsonValue>> objectValue; ///< Members in document order when type is Object.
+
+    bool isNull() const { return type == Type::Null; }
+    bool isBool() const { return type == Type::Bool; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    /**
+     * @brief Looks up an object member.
+     * @param key The member name.
+     * @return Pointer to the member value, nullptr if absent or not an object.
+     */
+    const JsonValue* get(const std::string& key) const;
+
+    /**
+     * @brief Sets an object member, replacing an existing member with the same name.
+     * @param key The member name.
+     * @param value The member value.
+     */
+    void set(const std::string& key, JsonValue value);
+
+    /**
+     * @brief Appends an element to an array.
+     * @param value The element to append.
+     */
+    void append(JsonValue value);
+
+    /**
+     * @brief Returns a string member or a default value.
+     */
+    std::string getString(const std::string& key, const std::string& defaultValue = std::string()) const;
+
+    /**
+     * @brief Returns a number member or a default value.
+     */
+    double getNumber(const std::string& key, double defaultValue = 0.0) const;
+
+    /**
+     * @brief Serialises the value as compact JSON.
+     * @return The JSON text.
+     */
+    std::string dump() const;
+
+    /**
+     * @brief Parses JSON text.
+     * @param text The JSON text.
+     * @param value Receives the parsed value.
+     * @param error Optional, receives a description of the parse error.
+     * @return True if the text was parsed successfully, false otherwise.
+     */
+    static bool parse(const std::string& text, JsonValue& value, std::string* error = nullptr);
+
+    /**
+     * @brief Quotes and escapes a string as a JSON string literal.
+     * @param text The raw string.
+     * @return The JSON string literal including the surrounding quotes.
+     */
+    static std::string quote(const std::string& text);
+};
+
+#endif // JsonValue_h
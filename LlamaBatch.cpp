@@ -0,0 +1,102 @@
+/**
+ * @file LlamaBatch.cpp
+ * @brief Command line tool running a JSONL file of prompts through LlamaEngine in batch mode.
+ *
+ * Usage: LlamaBatch <model.gguf> <input.jsonl> <output.jsonl> [options]
+ *
+ * Options:
+ *   --slots N          Number of prompts decoded together (default 8)
+ *   --max-tokens N     Token limit of records without max_tokens (default 512)
+ *   --context-size N   KV cells shared by all slots (default 4096)
+ *   --gpu-layers N     Number of layers offloaded to the GPU (default 99)
+ *   --no-resume        Overwrite the output instead of resuming from it
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "LlamaEngine.h"
+
+static void printUsage() {
+    std::cerr << "Usage: LlamaBatch <model.gguf> <input.jsonl> <output.jsonl> [options]\n"
+              << "  --slots N          Number of prompts decoded together (default 8)\n"
+              << "  --max-tokens N     Token limit of records without max_tokens (default 512)\n"
+              << "  --context-size N   KV cells shared by all slots (default 4096)\n"
+              << "  --gpu-layers N     Number of layers offloaded to the GPU (default 99)\n"
+              << "  --no-resume        Overwrite the output instead of resuming from it\n";
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        printUsage();
+        return 1;
+    }
+
+    const char *modelPath = argv[1];
+    const char *inputPath = argv[2];
+    const char *outputPath = argv[3];
+
+    int slots = 8;
+    int maxTokens = 512;
+    int contextSize = 4096;
+    int gpuLayers = 99;
+    int resume = 1;
+
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--slots" && hasValue)
+            slots = std::atoi(argv[++i]);
+        else if (arg == "--max-tokens" && hasValue)
+            maxTokens = std::atoi(argv[++i]);
+        else if (arg == "--context-size" && hasValue)
+            contextSize = std::atoi(argv[++i]);
+        else if (arg == "--gpu-layers" && hasValue)
+            gpuLayers = std::atoi(argv[++i]);
+        else if (arg == "--no-resume")
+            resume = 0;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // The batch context is separate from the session contexts, keep the default session small
+    int sessionContext = 512;
+    std::vector<ModelParameter> loadParams = {
+        { "context_size", PARAM_INT, &sessionContext },
+        { "n_gpu_layers", PARAM_INT, &gpuLayers },
+    };
+
+    if (!loadModel(modelPath, loadParams.data(), loadParams.size(), [](const char *message) {
+            std::cerr << message << std::endl;
+        })) {
+        std::cerr << "Failed to load model: " << modelPath << std::endl;
+        return 1;
+    }
+
+    std::vector<ModelParameter> batchParams = {
+        { "slots", PARAM_INT, &slots },
+        { "max_tokens", PARAM_INT, &maxTokens },
+        { "context_size", PARAM_INT, &contextSize },
+        { "resume", PARAM_INT, &resume },
+    };
+
+    long written = processBatchFile(inputPath, outputPath, batchParams.data(), batchParams.size(),
+        [](size_t completed, void *) {
+            if (completed % 100 == 0)
+                std::cerr << "Completed " << completed << " records" << std::endl;
+        }, nullptr);
+
+    if (written < 0) {
+        std::cerr << "Batch failed" << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Wrote " << written << " records to " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,40 @@
+# -------------------------------------------------
+# LlamaBatch.pro - QMake Project File for the LlamaBatch command line tool
+# -------------------------------------------------
+
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+QT -= gui qt core QtCore
+
+isEmpty(BACKEND){
+    BACKEND = CUDA
+    mac {
+    BACKEND = Metal
+    }
+}
+
+TARGET = LlamaBatch
+
+# Built next to the engine library it links against
+DESTDIR = bin/$${BACKEND}
+
+SOURCES += LlamaBatch.cpp
+HEADERS += LlamaEngine.h GGUFMetadata.h GenerationOptions.h
+
+INCLUDEPATH += $$PWD
+
+LIBS += -L$$PWD/bin/$${BACKEND}
+
+win32: {
+    CONFIG(debug, debug|release) {
+        LIBS += -lLlamaEngined
+    } else {
+        LIBS += -lLlamaEngine
+    }
+}
+
+mac {
+    LIBS += -lLlamaEngine
+    QMAKE_RPATHDIR += @executable_path
+}
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <sys/stat.h>
 #include <filesystem>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -152,9 +153,33 @@ void LlamaClient::LoadLibrary(const std::string& dllPath)
 
         // Load function pointers
         loadModelFunc = (LoadModelFunc)GetProcAddress(hDll, "loadModel");
+        loadModelWithProgressFunc = (LoadModelWithProgressFunc)GetProcAddress(hDll, "loadModelWithProgress");
+        cancelLoadModelFunc = (CancelLoadModelFunc)GetProcAddress(hDll, "cancelLoadModel");
         generateResponseFunc = (GenerateResponseFunc)GetProcAddress(hDll, "generateResponse");
+        generateResponseWithOptionsFunc = (GenerateResponseWithOptionsFunc)GetProcAddress(hDll, "generateResponseWithOptions");
+        generateResponsesFunc = (GenerateResponsesFunc)GetProcAddress(hDll, "generateResponses");
+        startGenerationFunc = (StartGenerationFunc)GetProcAddress(hDll, "startGeneration");
+        nextChunkFunc = (NextChunkFunc)GetProcAddress(hDll, "nextChunk");
+        finishGenerationFunc = (FinishGenerationFunc)GetProcAddress(hDll, "finishGeneration");
+        cancelGenerationFunc = (CancelGenerationFunc)GetProcAddress(hDll, "cancelGeneration");
+        completeInfillFunc = (CompleteInfillFunc)GetProcAddress(hDll, "completeInfill");
+        loadLoraAdapterFunc = (LoadLoraAdapterFunc)GetProcAddress(hDll, "loadLoraAdapter");
+        unloadLoraAdapterFunc = (UnloadLoraAdapterFunc)GetProcAddress(hDll, "unloadLoraAdapter");
+        setSessionLoraAdapterFunc = (SetSessionLoraAdapterFunc)GetProcAddress(hDll, "setSessionLoraAdapter");
+        setRequestQueueLimitsFunc = (SetRequestQueueLimitsFunc)GetProcAddress(hDll, "setRequestQueueLimits");
+        setResponseCacheLimitsFunc = (SetResponseCacheLimitsFunc)GetProcAddress(hDll, "setResponseCacheLimits");
+        setSessionSamplerFunc = (SetSessionSamplerFunc)GetProcAddress(hDll, "setSessionSampler");
         parseGGUFFunc = (ParseGGUFFunc)GetProcAddress(hDll, "parseGGUF");
         getContextInfoFunc = (GetContextInfoFunc)GetProcAddress(hDll, "getContextInfo");
+        embedTextsFunc = (EmbedTextsFunc)GetProcAddress(hDll, "embedTexts");
+        getEmbeddingSizeFunc = (GetEmbeddingSizeFunc)GetProcAddress(hDll, "getEmbeddingSize");
+        tokenizeFunc = (TokenizeFunc)GetProcAddress(hDll, "tokenize");
+        detokenizeFunc = (DetokenizeFunc)GetProcAddress(hDll, "detokenize");
+        tokenizeBatchFunc = (TokenizeBatchFunc)GetProcAddress(hDll, "tokenizeBatch");
+        scoreContinuationsFunc = (ScoreContinuationsFunc)GetProcAddress(hDll, "scoreContinuations");
+        scanModelDirectoryFunc = (ScanModelDirectoryFunc)GetProcAddress(hDll, "scanModelDirectory");
+        estimateModelMemoryFunc = (EstimateModelMemoryFunc)GetProcAddress(hDll, "estimateModelMemory");
+        verifyModelFileFunc = (VerifyModelFileFunc)GetProcAddress(hDll, "verifyModelFile");
 
         createSessionFunc = (CreateSessionFunc)GetProcAddress(hDll, "createSession");
         clearSessionFunc = (ClearSessionFunc)GetProcAddress(hDll, "clearSession");
@@ -183,9 +208,33 @@ void LlamaClient::LoadLibrary(const std::string& dllPath)
     }
 
     loadModelFunc = (LoadModelFunc)dlsym(hDll, "loadModel");
+    loadModelWithProgressFunc = (LoadModelWithProgressFunc)dlsym(hDll, "loadModelWithProgress");
+    cancelLoadModelFunc = (CancelLoadModelFunc)dlsym(hDll, "cancelLoadModel");
     generateResponseFunc = (GenerateResponseFunc)dlsym(hDll, "generateResponse");
+    generateResponseWithOptionsFunc = (GenerateResponseWithOptionsFunc)dlsym(hDll, "generateResponseWithOptions");
+    generateResponsesFunc = (GenerateResponsesFunc)dlsym(hDll, "generateResponses");
+    startGenerationFunc = (StartGenerationFunc)dlsym(hDll, "startGeneration");
+    nextChunkFunc = (NextChunkFunc)dlsym(hDll, "nextChunk");
+    finishGenerationFunc = (FinishGenerationFunc)dlsym(hDll, "finishGeneration");
+    cancelGenerationFunc = (CancelGenerationFunc)dlsym(hDll, "cancelGeneration");
+    completeInfillFunc = (CompleteInfillFunc)dlsym(hDll, "completeInfill");
+    loadLoraAdapterFunc = (LoadLoraAdapterFunc)dlsym(hDll, "loadLoraAdapter");
+    unloadLoraAdapterFunc = (UnloadLoraAdapterFunc)dlsym(hDll, "unloadLoraAdapter");
+    setSessionLoraAdapterFunc = (SetSessionLoraAdapterFunc)dlsym(hDll, "setSessionLoraAdapter");
+    setRequestQueueLimitsFunc = (SetRequestQueueLimitsFunc)dlsym(hDll, "setRequestQueueLimits");
+    setResponseCacheLimitsFunc = (SetResponseCacheLimitsFunc)dlsym(hDll, "setResponseCacheLimits");
+    setSessionSamplerFunc = (SetSessionSamplerFunc)dlsym(hDll, "setSessionSampler");
     parseGGUFFunc = (ParseGGUFFunc)dlsym(hDll, "parseGGUF");
     getContextInfoFunc = (GetContextInfoFunc)dlsym(hDll, "getContextInfo");
+    embedTextsFunc = (EmbedTextsFunc)dlsym(hDll, "embedTexts");
+    getEmbeddingSizeFunc = (GetEmbeddingSizeFunc)dlsym(hDll, "getEmbeddingSize");
+    tokenizeFunc = (TokenizeFunc)dlsym(hDll, "tokenize");
+    detokenizeFunc = (DetokenizeFunc)dlsym(hDll, "detokenize");
+    tokenizeBatchFunc = (TokenizeBatchFunc)dlsym(hDll, "tokenizeBatch");
+    scoreContinuationsFunc = (ScoreContinuationsFunc)dlsym(hDll, "scoreContinuations");
+    scanModelDirectoryFunc = (ScanModelDirectoryFunc)dlsym(hDll, "scanModelDirectory");
+    estimateModelMemoryFunc = (EstimateModelMemoryFunc)dlsym(hDll, "estimateModelMemory");
+    verifyModelFileFunc = (VerifyModelFileFunc)dlsym(hDll, "verifyModelFile");
 
     createSessionFunc = (CreateSessionFunc)dlsym(hDll, "createSession");
     clearSessionFunc = (ClearSessionFunc)dlsym(hDll, "clearSession");
@@ -260,6 +309,38 @@ bool LlamaClient::loadModel(const std::string& modelFile, struct ModelParameter*
     return modelLoaded;
 }
 
+/**
+ * @brief Loads the model while reporting progress.
+ * @param Model path and file name.
+ * @param params Model parameters.
+ * @param paramCount Number of parameters.
+ * @param callback Callback function.
+ * @param progressCallback Load progress callback, returning false cancels the load.
+ * @param userData User data pointer passed to the progress callback.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaClient::loadModel(const std::string& modelFile, struct ModelParameter* params, size_t paramCount,
+                            void (*callback)(const char*),
+                            LoadProgressCallback progressCallback, void *userData) {
+
+    // Older engine libraries do not export the progress variant
+    if (!loadModelWithProgressFunc) {
+        return loadModel(modelFile, params, paramCount, callback);
+    }
+
+    modelLoaded = loadModelWithProgressFunc(modelFile.c_str(), params, paramCount, callback, progressCallback, userData);
+    modelPathFile = modelFile;
+    return modelLoaded;
+}
+
+/**
+ * @brief Requests cancellation of a model load running on another thread.
+ */
+void LlamaClient::cancelLoadModel() {
+    if (cancelLoadModelFunc)
+        cancelLoadModelFunc();
+}
+
 /**
  * @brief Generates a response from the model.
  * @param prompt The input prompt.
@@ -295,6 +376,283 @@ bool LlamaClient::generateResponse(int sessionId,
     return generateResponseFunc(sessionId, prompt.c_str(), streamCallback, finishedCallback, userData);
 }
 
+/**
+ * @brief Generates a response from the model with per request options.
+ * @param sessionId The unique identifier for the session.
+ * @param prompt The input prompt.
+ * @param options Generation options.
+ * @param streamCallback Streaming callback.
+ * @param finishedCallback Finished response callback, receives the finish reason.
+ * @param userData User data pointer.
+ * @return True if the response was generated successfully, false otherwise.
+ */
+bool LlamaClient::generateResponse(int sessionId,
+                                   const std::string& prompt,
+                                   std::vector<ModelParameter>& options,
+                                   void (*streamCallback)(const char* msg, void* user_data),
+                                   void (*finishedCallback)(const char* msg, FinishReason reason, void* user_data),
+                                   void *userData)
+{
+    if (!generateResponseWithOptionsFunc)
+        return false;
+
+    return generateResponseWithOptionsFunc(sessionId, prompt.c_str(), options.data(), options.size(),
+                                           streamCallback, finishedCallback, userData);
+}
+
+/**
+ * @brief Starts a generation pulled chunk by chunk.
+ * @param sessionId The unique identifier for the session.
+ * @param prompt The input text prompt.
+ * @param options Generation options.
+ * @return True if the generation was started, false otherwise.
+ */
+bool LlamaClient::startGeneration(int sessionId, const std::string& prompt, std::vector<ModelParameter>& options)
+{
+    if (!startGenerationFunc)
+        return false;
+
+    return startGenerationFunc(sessionId, prompt.c_str(), options.data(), options.size());
+}
+
+/**
+ * @brief Generates the next chunk of a pull generation.
+ * @param sessionId The unique identifier for the session.
+ * @param chunk Receives the chunk text.
+ * @param reason Optional, receives the finish reason when the generation has ended.
+ * @return 1 if a chunk was generated, 0 if the generation has ended, -1 on error,
+ *         -2 if the request queue rejected the call, the generation is kept.
+ */
+int LlamaClient::nextChunk(int sessionId, std::string& chunk, FinishReason* reason)
+{
+    chunk.clear();
+    if (!nextChunkFunc)
+        return -1;
+
+    const char* text = nullptr;
+    int ret = nextChunkFunc(sessionId, &text, reason);
+    if (ret == 1 && text)
+        chunk = text;
+    return ret;
+}
+
+/**
+ * @brief Ends a pull generation early.
+ * @param sessionId The unique identifier for the session.
+ * @return True if a generation was ended, false otherwise.
+ */
+bool LlamaClient::finishGeneration(int sessionId)
+{
+    if (!finishGenerationFunc)
+        return false;
+
+    return finishGenerationFunc(sessionId);
+}
+
+/**
+ * @brief Stops a generation running on another thread.
+ * @param sessionId The unique identifier for the session.
+ * @return True if the session exists, false otherwise.
+ */
+bool LlamaClient::cancelGeneration(int sessionId)
+{
+    if (!cancelGenerationFunc)
+        return false;
+
+    return cancelGenerationFunc(sessionId);
+}
+
+#if defined(__cpp_impl_coroutine)
+/**
+ * @brief Starts a generation and returns a generator over its chunks.
+ * @param sessionId The unique identifier for the session.
+ * @param prompt The input text prompt.
+ * @param options Generation options, read before this call returns.
+ * @return The chunk generator, empty if the generation could not be started.
+ */
+ChunkGenerator LlamaClient::generate(int sessionId, const std::string& prompt, std::vector<ModelParameter>& options)
+{
+    // Started eagerly, the coroutine only sees the session once the options may be gone
+    const bool started = startGeneration(sessionId, prompt, options);
+    ChunkGenerator generator = pullChunks(sessionId, started);
+
+    // The body only runs once iterated, a generator dropped before its last chunk,
+    // or before its first, ends the generation from its destructor
+    if (started)
+        generator.onAbandoned([this, sessionId]() { finishGeneration(sessionId); });
+    return generator;
+}
+
+ChunkGenerator LlamaClient::pullChunks(int sessionId, bool started)
+{
+    if (!started)
+        co_return;
+
+    std::string chunk;
+    int ret;
+    while ((ret = nextChunk(sessionId, chunk)) == 1)
+        co_yield chunk;
+
+    // Only a generation that ran to its end is closed by the engine, after an
+    // error or a rejected call finishGeneration releases the session
+    if (ret != 0)
+        finishGeneration(sessionId);
+}
+#endif
+
+/**
+ * @brief Generates several alternative responses to one prompt.
+ * @param sessionId The unique identifier for the session.
+ * @param prompt The input prompt.
+ * @param n Number of completions.
+ * @param options Generation options.
+ * @param responses Receives the completions.
+ * @param reasons Optional, receives the finish reasons.
+ * @return True if the responses were generated successfully, false otherwise.
+ */
+bool LlamaClient::generateResponses(int sessionId, const std::string& prompt, int n,
+                                    std::vector<ModelParameter>& options,
+                                    std::vector<std::string>& responses,
+                                    std::vector<FinishReason>* reasons)
+{
+    if (!generateResponsesFunc || n < 1)
+        return false;
+
+    struct Results {
+        std::vector<std::string> responses;
+        std::vector<FinishReason> reasons;
+    } results;
+    results.responses.resize(n);
+    results.reasons.resize(n, FINISH_ERROR);
+
+    bool ret = generateResponsesFunc(sessionId, prompt.c_str(), n, options.data(), options.size(),
+        [](int index, const char* response, FinishReason reason, void* userData) {
+            auto* results = static_cast<Results*>(userData);
+            if (index >= 0 && index < (int)results->responses.size()) {
+                results->responses[index] = response;
+                results->reasons[index] = reason;
+            }
+        }, &results);
+
+    responses = std::move(results.responses);
+    if (reasons)
+        *reasons = std::move(results.reasons);
+    return ret;
+}
+
+/**
+ * @brief Completes the text between a prefix and a suffix.
+ * @param prefix Text before the cursor.
+ * @param suffix Text after the cursor.
+ * @param options Generation options.
+ * @param completion Receives the completion.
+ * @param streamCallback Streaming callback.
+ * @param userData User data pointer.
+ * @return True if the completion succeeded, false otherwise.
+ */
+bool LlamaClient::completeInfill(const std::string& prefix, const std::string& suffix,
+                                 std::vector<ModelParameter>& options,
+                                 std::string& completion,
+                                 void (*streamCallback)(const char* msg, void* user_data),
+                                 void *userData)
+{
+    completion.clear();
+    if (!completeInfillFunc)
+        return false;
+
+    // The stream callback keeps the caller's user data, the final text is collected through a static trampoline
+    struct Context {
+        std::string* completion;
+        void (*streamCallback)(const char*, void*);
+        void* userData;
+    } context { &completion, streamCallback, userData };
+
+    return completeInfillFunc(prefix.c_str(), suffix.c_str(), options.data(), options.size(),
+        [](const char* chunk, void* data) {
+            auto* context = static_cast<Context*>(data);
+            if (context->streamCallback)
+                context->streamCallback(chunk, context->userData);
+        },
+        [](const char* text, FinishReason, void* data) {
+            *static_cast<Context*>(data)->completion = text;
+        }, &context);
+}
+
+/**
+ * @brief Loads a LoRA adapter.
+ * @param name Name of the adapter.
+ * @param path Path to the adapter file.
+ * @return True if the adapter was loaded, false otherwise.
+ */
+bool LlamaClient::loadLoraAdapter(const std::string& name, const std::string& path) {
+    if (!loadLoraAdapterFunc)
+        return false;
+    return loadLoraAdapterFunc(name.c_str(), path.c_str());
+}
+
+/**
+ * @brief Unloads a LoRA adapter.
+ * @param name Name of the adapter.
+ * @return True if the adapter was unloaded, false otherwise.
+ */
+bool LlamaClient::unloadLoraAdapter(const std::string& name) {
+    if (!unloadLoraAdapterFunc)
+        return false;
+    return unloadLoraAdapterFunc(name.c_str());
+}
+
+/**
+ * @brief Selects the LoRA adapter of a session.
+ * @param sessionId The session identifier.
+ * @param name Name of the adapter, empty for the base model.
+ * @param scale Adapter scale.
+ * @return True on success, false otherwise.
+ */
+bool LlamaClient::setSessionLoraAdapter(int sessionId, const std::string& name, float scale) {
+    if (!setSessionLoraAdapterFunc)
+        return false;
+    return setSessionLoraAdapterFunc(sessionId, name.c_str(), scale);
+}
+
+/**
+ * @brief Sets the admission limits of the request queue.
+ * @param maxQueueDepth Maximum number of waiting requests.
+ * @param maxWaitMs Maximum expected wait in milliseconds.
+ * @return True if the engine supports the request queue, false otherwise.
+ */
+bool LlamaClient::setRequestQueueLimits(size_t maxQueueDepth, int maxWaitMs) {
+    if (!setRequestQueueLimitsFunc)
+        return false;
+    setRequestQueueLimitsFunc(maxQueueDepth, maxWaitMs);
+    return true;
+}
+
+/**
+ * @brief Sets the bounds of the response cache.
+ * @param maxEntries Maximum number of cached responses.
+ * @param maxBytes Maximum size in bytes.
+ * @param ttlSeconds Lifetime of an entry in seconds.
+ * @return True if the engine supports the response cache, false otherwise.
+ */
+bool LlamaClient::setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds) {
+    if (!setResponseCacheLimitsFunc)
+        return false;
+    setResponseCacheLimitsFunc(maxEntries, maxBytes, ttlSeconds);
+    return true;
+}
+
+/**
+ * @brief Sets the sampler parameters of a session.
+ * @param sessionId The session identifier.
+ * @param params Sampler parameters.
+ * @return True on success, false otherwise.
+ */
+bool LlamaClient::setSessionSampler(int sessionId, std::vector<ModelParameter>& params) {
+    if (!setSessionSamplerFunc)
+        return false;
+    return setSessionSamplerFunc(sessionId, params.data(), params.size());
+}
+
 /**
  * @brief Parses a GGUF file and extracts metadata.
  * @param filepath Path to the GGUF file.
@@ -331,6 +689,20 @@ GGUFMetadata LlamaClient::parseGGUF(const std::string& filepath, void (*callback
               metadataPtr->entries[key] = GGUFMetadataEntry(*static_cast<uint32_t*>(data));
           } else if (type == TYPE_STRING) {
               metadataPtr->entries[key] = GGUFMetadataEntry(static_cast<const char*>(data));
+          } else if (type == TYPE_ARRAY) {
+              GGUFMetadataEntry entry(static_cast<const char*>(data));
+              entry.type = TYPE_ARRAY;
+              metadataPtr->entries[key] = entry;
+          } else if (type == TYPE_INT64 || type == TYPE_BOOL) {
+              GGUFMetadataEntry entry;
+              entry.type = type;
+              entry.lvalue = type == TYPE_BOOL ? *static_cast<bool*>(data) : *static_cast<int64_t*>(data);
+              metadataPtr->entries[key] = entry;
+          } else if (type == TYPE_FLOAT64) {
+              GGUFMetadataEntry entry;
+              entry.type = TYPE_FLOAT64;
+              entry.fvalue = *static_cast<double*>(data);
+              metadataPtr->entries[key] = entry;
           } else {
               metadataPtr->entries[key] = GGUFMetadataEntry("[Unknown Type]");
           }
@@ -386,6 +758,150 @@ std::string LlamaClient::getContextInfo(){
 }
 
 
+/**
+ * @brief Computes pooled embeddings for a list of texts.
+ * @param texts The texts to embed.
+ * @param pooling Pooling applied over the token embeddings.
+ * @param normalize L2 normalize each vector.
+ * @param embeddings Receives the vectors, one row per text.
+ * @return The embedding size on success, -1 on failure.
+ */
+int LlamaClient::embed(const std::vector<std::string>& texts, EmbeddingPooling pooling, bool normalize, std::vector<float>& embeddings) {
+    if (!embedTextsFunc || !getEmbeddingSizeFunc)
+        return -1;
+
+    int size = getEmbeddingSizeFunc();
+    if (size <= 0)
+        return -1;
+
+    std::vector<const char*> inputs;
+    inputs.reserve(texts.size());
+    for (const auto& text : texts)
+        inputs.push_back(text.c_str());
+
+    embeddings.resize(texts.size() * size);
+    return embedTextsFunc(inputs.data(), inputs.size(), pooling, normalize, embeddings.data(), embeddings.size());
+}
+
+/**
+ * @brief Tokenizes a text.
+ * @param text The text.
+ * @param tokens Receives the tokens.
+ * @param addSpecial Add BOS/EOS tokens.
+ * @param parseSpecial Parse special token text.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaClient::tokenize(const std::string& text, std::vector<int32_t>& tokens, bool addSpecial, bool parseSpecial) {
+    tokens.clear();
+    if (!tokenizeFunc)
+        return false;
+
+    // Every token covers at least one byte, so the text length plus BOS/EOS is enough
+    tokens.resize(text.size() + 2);
+    int count = tokenizeFunc(text.c_str(), addSpecial, parseSpecial, tokens.data(), tokens.size());
+    if (count < 0) {
+        tokens.clear();
+        return false;
+    }
+
+    if ((size_t)count > tokens.size()) {
+        tokens.resize(count);
+        count = tokenizeFunc(text.c_str(), addSpecial, parseSpecial, tokens.data(), tokens.size());
+    }
+    tokens.resize(std::max(count, 0));
+    return count >= 0;
+}
+
+/**
+ * @brief Converts tokens to text.
+ * @param tokens The tokens.
+ * @param text Receives the text.
+ * @param removeSpecial Drop BOS/EOS tokens.
+ * @param unparseSpecial Render special tokens as text.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaClient::detokenize(const std::vector<int32_t>& tokens, std::string& text, bool removeSpecial, bool unparseSpecial) {
+    text.clear();
+    if (!detokenizeFunc)
+        return false;
+
+    std::vector<char> buffer(tokens.size() * 8 + 16);
+    int length = detokenizeFunc(tokens.data(), tokens.size(), removeSpecial, unparseSpecial, buffer.data(), buffer.size());
+    if (length >= (int)buffer.size()) {
+        buffer.resize(length + 1);
+        length = detokenizeFunc(tokens.data(), tokens.size(), removeSpecial, unparseSpecial, buffer.data(), buffer.size());
+    }
+    if (length < 0)
+        return false;
+
+    text.assign(buffer.data(), length);
+    return true;
+}
+
+/**
+ * @brief Tokenizes many texts in parallel.
+ * @param texts The texts.
+ * @param tokens Receives the tokens of all texts.
+ * @param offsets Receives texts.size() + 1 offsets into tokens.
+ * @param addSpecial Add BOS/EOS tokens.
+ * @param parseSpecial Parse special token text.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaClient::tokenizeBatch(const std::vector<std::string>& texts, std::vector<int32_t>& tokens, std::vector<size_t>& offsets,
+                                bool addSpecial, bool parseSpecial) {
+    tokens.clear();
+    offsets.clear();
+    if (!tokenizeBatchFunc)
+        return false;
+
+    std::vector<const char*> inputs;
+    inputs.reserve(texts.size());
+    for (const auto& text : texts)
+        inputs.push_back(text.c_str());
+
+    struct Result {
+        std::vector<int32_t>* tokens;
+        std::vector<size_t>* offsets;
+    } result = { &tokens, &offsets };
+
+    return tokenizeBatchFunc(inputs.data(), inputs.size(), addSpecial, parseSpecial,
+        [](const int32_t* batchTokens, const size_t* batchOffsets, size_t textCount, void* userData) {
+            Result* result = static_cast<Result*>(userData);
+            result->tokens->assign(batchTokens, batchTokens + batchOffsets[textCount]);
+            result->offsets->assign(batchOffsets, batchOffsets + textCount + 1);
+        }, &result);
+}
+
+/**
+ * @brief Scores candidate continuations of a shared prefix.
+ * @param prefix The shared prefix text.
+ * @param candidates The candidate continuations.
+ * @param totals Receives the summed log-probability of each candidate.
+ * @param tokenLogprobs Optional per token log-probabilities of each candidate.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaClient::scoreContinuations(const std::string& prefix, const std::vector<std::string>& candidates,
+                                     std::vector<float>& totals,
+                                     std::vector<std::vector<float>>* tokenLogprobs) {
+    if (!scoreContinuationsFunc)
+        return false;
+
+    std::vector<const char*> inputs;
+    inputs.reserve(candidates.size());
+    for (const auto& candidate : candidates)
+        inputs.push_back(candidate.c_str());
+
+    if (tokenLogprobs)
+        tokenLogprobs->assign(candidates.size(), std::vector<float>());
+
+    totals.resize(candidates.size());
+    return scoreContinuationsFunc(prefix.c_str(), inputs.data(), inputs.size(), totals.data(),
+        [](size_t candidateIndex, const char* /*token*/, float logprob, void* userData) {
+            auto* logprobs = static_cast<std::vector<std::vector<float>>*>(userData);
+            if (logprobs)
+                (*logprobs)[candidateIndex].push_back(logprob);
+        }, tokenLogprobs);
+}
 
 bool LlamaClient::isModelLoaded() {
     return modelLoaded;
@@ -406,3 +922,88 @@ bool LlamaClient::clearSession(int sessionId) {
 bool LlamaClient::deleteSession(int sessionId) {
     return deleteSessionFunc(sessionId);
 }
+
+/**
+ * @brief Lists the GGUF models of a directory.
+ * @param directory The models directory.
+ * @param models Receives the models.
+ * @param indexPath Path of the index file, empty for the default.
+ * @return True if the directory was scanned, false otherwise.
+ */
+bool LlamaClient::scanModels(const std::string& directory, std::vector<ModelInfo>& models, const std::string& indexPath)
+{
+    models.clear();
+    if (!scanModelDirectoryFunc)
+        return false;
+
+    int count = scanModelDirectoryFunc(directory.c_str(), indexPath.empty() ? nullptr : indexPath.c_str(),
+        [](const ModelCatalogEntry* entry, void* userData) {
+            ModelInfo info;
+            info.path = entry->path;
+            info.size = entry->size;
+            info.valid = entry->valid;
+            info.error = entry->error;
+            info.name = entry->name;
+            info.architecture = entry->architecture;
+            info.fileType = entry->fileType;
+            info.contextLength = entry->contextLength;
+            info.embeddingLength = entry->embeddingLength;
+            info.blockCount = entry->blockCount;
+            info.vocabularySize = entry->vocabularySize;
+            info.tensorCount = entry->tensorCount;
+            info.parameterCount = entry->parameterCount;
+            static_cast<std::vector<ModelInfo>*>(userData)->push_back(std::move(info));
+        }, &models);
+
+    return count >= 0;
+}
+
+/**
+ * @brief Predicts the memory a model needs without loading it.
+ * @param modelPath Path to the GGUF file.
+ * @param contextSize Context size of each session, 0 to pick the largest that fits.
+ * @param sessionCount Number of sessions, 0 to pick the largest that fits.
+ * @param memoryBudgetMb Memory available in MB, 0 for the physical memory.
+ * @param estimate Receives the estimate.
+ * @return True if the configuration fits the budget, false otherwise.
+ */
+bool LlamaClient::estimateMemory(const std::string& modelPath, int contextSize, int sessionCount, int memoryBudgetMb,
+                                 ModelMemoryEstimate& estimate)
+{
+    estimate = ModelMemoryEstimate();
+    if (!estimateModelMemoryFunc)
+        return false;
+
+    return estimateModelMemoryFunc(modelPath.c_str(), contextSize, sessionCount, memoryBudgetMb, &estimate);
+}
+
+/**
+ * @brief Checks that a model file is complete and intact.
+ * @param modelPath Path to the GGUF file.
+ * @param digestType The digest to compute.
+ * @param expectedDigest Hex digest the file must match, empty to only compute it.
+ * @param checkTensors Run the tensor bounds check before hashing.
+ * @param digest Receives the hex digest.
+ * @param error Receives why the verification failed.
+ * @param progressCallback Optional callback receiving the fraction hashed, return false to cancel.
+ * @param userData Custom user data pointer passed to the progress callback.
+ * @return True if every requested check passed.
+ */
+bool LlamaClient::verifyModel(const std::string& modelPath, DigestType digestType, const std::string& expectedDigest,
+                              bool checkTensors, std::string& digest, std::string& error,
+                              LoadProgressCallback progressCallback, void* userData)
+{
+    digest.clear();
+    error.clear();
+    if (!verifyModelFileFunc) {
+        error = "verifyModelFile is not available";
+        return false;
+    }
+
+    ModelVerification result;
+    bool verified = verifyModelFileFunc(modelPath.c_str(), digestType, expectedDigest.empty() ? nullptr : expectedDigest.c_str(),
+                                        checkTensors, progressCallback, userData, &result);
+    digest = result.digest;
+    error = result.error;
+    return verified;
+}
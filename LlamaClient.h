@@ -13,6 +13,7 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <atomic>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -22,6 +23,7 @@
 
 #include "LlamaEngine.h"
 #include "GGUFMetadata.h"
+#include "ChunkGenerator.h"
 
 /**
  * @class LlamaClient
@@ -29,6 +31,25 @@
  */
 class LlamaClient {
 public:
+    /**
+     * @brief Metadata of a model file, see scanModels.
+     */
+    struct ModelInfo {
+        std::string path;            ///< Absolute path of the file.
+        uint64_t size = 0;           ///< File size in bytes.
+        bool valid = false;          ///< False if the GGUF header could not be read.
+        std::string error;           ///< Why the header could not be read.
+        std::string name;            ///< general.name, or the file name.
+        std::string architecture;    ///< general.architecture
+        int64_t fileType = -1;       ///< Quantization of the weights, -1 if unknown.
+        int64_t contextLength = 0;   ///< Training context length.
+        int64_t embeddingLength = 0; ///< Width of the hidden state.
+        int64_t blockCount = 0;      ///< Number of transformer blocks.
+        uint64_t vocabularySize = 0; ///< Number of tokens.
+        uint64_t tensorCount = 0;    ///< Number of tensors.
+        uint64_t parameterCount = 0; ///< Total number of weights.
+    };
+
     /**
      * @brief Constructor for LlamaClient.
      * @param backend The backend to use (e.g., "CUDA", "CPU").
@@ -81,6 +102,25 @@ public:
      */
     bool loadModel(const std::string& modelName, struct ModelParameter* params, size_t paramCount, void (*callback)(const char*) = nullptr);
 
+    /**
+     * @brief Loads an LLM model while reporting progress, can be called from a background thread.
+     * @param modelName Name of the model.
+     * @param params Pointer to model parameters.
+     * @param paramCount Number of parameters.
+     * @param callback Optional callback function for status updates.
+     * @param progressCallback Receives the load progress in [0, 1], returning false cancels the load.
+     * @param userData User-defined data passed to the progress callback.
+     * @return True if the model loads successfully, false if it failed or was cancelled.
+     */
+    bool loadModel(const std::string& modelName, struct ModelParameter* params, size_t paramCount,
+                   void (*callback)(const char*),
+                   LoadProgressCallback progressCallback, void *userData);
+
+    /**
+     * @brief Requests cancellation of a model load running on another thread.
+     */
+    void cancelLoadModel();
+
     bool isModelLoaded();
 
     std::string getModelFile();
@@ -118,8 +158,211 @@ public:
                           void (*streamCallback)(const char* msg, void* user_data),
                           void (*finishedCallback)(const char* msg, void* user_data), void *userData);
 
+    /**
+     * @brief Generates a response with per request generation options.
+     *
+     * Options such as `grammar` or `json_schema` constrain the output of this
+     * request only, see generateResponseWithOptions in LlamaEngine.h.
+     *
+     * @param sessionId The unique identifier for the session.
+     * @param prompt The input text prompt to process.
+     * @param options Generation options as key/value parameters.
+     * @param streamCallback Function pointer to handle streamed response tokens.
+     * @param finishedCallback Function pointer to receive the full generated response and finish reason.
+     * @param userData Optional user-defined data passed to both callbacks.
+     * @return True if the response generation was successful, false otherwise.
+     */
+    bool generateResponse(int sessionId, const std::string& prompt,
+                          std::vector<ModelParameter>& options,
+                          void (*streamCallback)(const char* msg, void* user_data),
+                          void (*finishedCallback)(const char* msg, FinishReason reason, void* user_data), void *userData);
+
+    /**
+     * @brief Starts a generation pulled chunk by chunk with nextChunk.
+     * @param sessionId The unique identifier for the session.
+     * @param prompt The input text prompt to process.
+     * @param options Generation options as key/value parameters.
+     * @return True if the generation was started, false otherwise.
+     */
+    bool startGeneration(int sessionId, const std::string& prompt, std::vector<ModelParameter>& options);
+
+    /**
+     * @brief Generates the next chunk of a generation started with startGeneration.
+     * @param sessionId The unique identifier for the session.
+     * @param chunk Receives the chunk text.
+     * @param reason Optional, receives the finish reason when the generation has ended.
+     * @return 1 if a chunk was generated, 0 if the generation has ended, -1 on error,
+     *         -2 if the request queue rejected the call, the generation is kept.
+     */
+    int nextChunk(int sessionId, std::string& chunk, FinishReason* reason = nullptr);
+
+    /**
+     * @brief Ends a generation before nextChunk has returned 0.
+     * @param sessionId The unique identifier for the session.
+     * @return True if a generation was ended, false otherwise.
+     */
+    bool finishGeneration(int sessionId);
+
+    /**
+     * @brief Stops a generation running on another thread, returns without waiting for it.
+     * @param sessionId The unique identifier for the session.
+     * @return True if the session exists, false otherwise.
+     */
+    bool cancelGeneration(int sessionId = 0);
+
+#if defined(__cpp_impl_coroutine)
+    /**
+     * @brief Starts a generation and returns a generator over its chunks.
+     *
+     * Each chunk is generated when the generator is advanced, on the advancing
+     * thread. Destroying the generator early ends the generation, also when no
+     * chunk was pulled. If the
+     * generation cannot be started the generator is empty.
+     *
+     * @param sessionId The unique identifier for the session.
+     * @param prompt The input text prompt to process.
+     * @param options Generation options, only read by this call.
+     * @return The chunk generator.
+     */
+    ChunkGenerator generate(int sessionId, const std::string& prompt, std::vector<ModelParameter>& options);
+#endif
+
+    /**
+     * @brief Generates n alternative responses to one prompt with a single prefill.
+     * @param sessionId The unique identifier for the session.
+     * @param prompt The input text prompt to process.
+     * @param n Number of completions.
+     * @param options Generation options applied to every completion.
+     * @param responses Receives the completions.
+     * @param reasons Optional, receives the finish reason of each completion.
+     * @return True if the responses were generated successfully, false otherwise.
+     */
+    bool generateResponses(int sessionId, const std::string& prompt, int n,
+                           std::vector<ModelParameter>& options,
+                           std::vector<std::string>& responses,
+                           std::vector<FinishReason>* reasons = nullptr);
+
+    /**
+     * @brief Completes the text between a prefix and a suffix with a code model.
+     * @param prefix Text before the cursor.
+     * @param suffix Text after the cursor.
+     * @param options Generation options.
+     * @param completion Receives the completed middle text.
+     * @param streamCallback Optional function pointer to handle streamed chunks.
+     * @param userData Optional user-defined data passed to the stream callback.
+     * @return True if the completion succeeded, false otherwise.
+     */
+    bool completeInfill(const std::string& prefix, const std::string& suffix,
+                        std::vector<ModelParameter>& options,
+                        std::string& completion,
+                        void (*streamCallback)(const char* msg, void* user_data) = nullptr,
+                        void *userData = nullptr);
+
+    /**
+     * @brief Loads a LoRA adapter against the loaded base model.
+     * @param name Name used to select the adapter.
+     * @param path Path to the adapter GGUF file.
+     * @return True if the adapter was loaded, false otherwise.
+     */
+    bool loadLoraAdapter(const std::string& name, const std::string& path);
+
+    /**
+     * @brief Unloads a LoRA adapter.
+     * @param name Name of the adapter.
+     * @return True if the adapter was unloaded, false otherwise.
+     */
+    bool unloadLoraAdapter(const std::string& name);
+
+    /**
+     * @brief Selects the LoRA adapter used by a session.
+     * @param sessionId The unique identifier for the session.
+     * @param name Name of a loaded adapter, empty for the base model.
+     * @param scale Scale applied to the adapter.
+     * @return True on success, false otherwise.
+     */
+    bool setSessionLoraAdapter(int sessionId, const std::string& name, float scale = 1.0f);
+
+    /**
+     * @brief Sets the sampler parameters of a session without recreating its context.
+     * @param sessionId The unique identifier for the session.
+     * @param params Sampler parameters such as temperature, top_k, top_p or seed.
+     * @return True on success, false otherwise.
+     */
+    bool setSessionSampler(int sessionId, std::vector<ModelParameter>& params);
+
+    /**
+     * @brief Sets the admission limits of the engine's request queue.
+     * @param maxQueueDepth Maximum number of waiting requests, 0 for no limit.
+     * @param maxWaitMs Maximum expected wait in milliseconds, 0 for no limit.
+     * @return True if the engine supports the request queue, false otherwise.
+     */
+    bool setRequestQueueLimits(size_t maxQueueDepth, int maxWaitMs);
+
+    /**
+     * @brief Enables and bounds the engine's cache of deterministic responses.
+     * @param maxEntries Maximum number of cached responses, 0 disables the cache.
+     * @param maxBytes Maximum size of the cache in bytes, 0 for no limit.
+     * @param ttlSeconds Lifetime of a cached response in seconds, 0 for no expiry.
+     * @return True if the engine supports the response cache, false otherwise.
+     */
+    bool setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds);
+
     std::string getContextInfo();
 
+    /**
+     * @brief Computes pooled embeddings for a list of texts in batched decodes.
+     * @param texts The texts to embed.
+     * @param pooling Pooling applied over the token embeddings.
+     * @param normalize When true each vector is L2 normalized.
+     * @param embeddings Receives texts.size() rows of embedding size floats.
+     * @return The embedding size on success, -1 on failure.
+     */
+    int embed(const std::vector<std::string>& texts, EmbeddingPooling pooling, bool normalize, std::vector<float>& embeddings);
+
+    /**
+     * @brief Tokenizes a text with the loaded model's vocabulary.
+     * @param text The text to tokenize.
+     * @param tokens Receives the tokens.
+     * @param addSpecial Add the BOS/EOS tokens the model expects.
+     * @param parseSpecial Parse special token text into its token.
+     * @return True if successful, false otherwise.
+     */
+    bool tokenize(const std::string& text, std::vector<int32_t>& tokens, bool addSpecial = true, bool parseSpecial = false);
+
+    /**
+     * @brief Converts tokens back to text.
+     * @param tokens The tokens.
+     * @param text Receives the text.
+     * @param removeSpecial Drop the BOS/EOS tokens.
+     * @param unparseSpecial Render special tokens as their text.
+     * @return True if successful, false otherwise.
+     */
+    bool detokenize(const std::vector<int32_t>& tokens, std::string& text, bool removeSpecial = true, bool unparseSpecial = false);
+
+    /**
+     * @brief Tokenizes many texts in parallel.
+     * @param texts The texts to tokenize.
+     * @param tokens Receives the tokens of all texts, one after the other.
+     * @param offsets Receives texts.size() + 1 offsets, text i spans tokens[offsets[i]] to tokens[offsets[i + 1] - 1].
+     * @param addSpecial Add the BOS/EOS tokens the model expects.
+     * @param parseSpecial Parse special token text into its token.
+     * @return True if successful, false otherwise.
+     */
+    bool tokenizeBatch(const std::vector<std::string>& texts, std::vector<int32_t>& tokens, std::vector<size_t>& offsets,
+                       bool addSpecial = true, bool parseSpecial = false);
+
+    /**
+     * @brief Scores candidate continuations of a shared prefix by log-likelihood.
+     * @param prefix The shared prefix text.
+     * @param candidates The candidate continuations.
+     * @param totals Receives the summed log-probability of each candidate.
+     * @param tokenLogprobs Optional, receives the log-probability of every token of each candidate.
+     * @return True if successful, false otherwise.
+     */
+    bool scoreContinuations(const std::string& prefix, const std::vector<std::string>& candidates,
+                            std::vector<float>& totals,
+                            std::vector<std::vector<float>>* tokenLogprobs = nullptr);
+
     /**
      * @brief Parses GGUF metadata from a file.
      * @param filepath Path to the GGUF file.
@@ -128,6 +371,54 @@ public:
      */
     GGUFMetadata parseGGUF(const std::string& filepath, void (*callback)(const char* message));
 
+    /**
+     * @brief Lists the GGUF models of a directory using the engine's catalogue index.
+     *
+     * Only new or changed model files are read, unchanged ones come from the index.
+     *
+     * @param directory The models directory.
+     * @param models Receives the models sorted by path.
+     * @param indexPath Path of the index file, empty for the default in the directory.
+     * @return True if the directory was scanned, false otherwise.
+     */
+    bool scanModels(const std::string& directory, std::vector<ModelInfo>& models, const std::string& indexPath = std::string());
+
+    /**
+     * @brief Predicts the weight, KV cache and compute memory of a model from its GGUF header.
+     *
+     * Pass 0 as the context size or the session count to get the largest value fitting the budget.
+     *
+     * @param modelPath Path to the GGUF file.
+     * @param contextSize Context size of each session, 0 for automatic.
+     * @param sessionCount Number of sessions, 0 for automatic.
+     * @param memoryBudgetMb Memory available in MB, 0 for the physical memory.
+     * @param estimate Receives the estimate.
+     * @return True if the configuration fits the budget, false if it does not or the file cannot be read.
+     */
+    bool estimateMemory(const std::string& modelPath, int contextSize, int sessionCount, int memoryBudgetMb,
+                        ModelMemoryEstimate& estimate);
+
+    /**
+     * @brief Checks that a model file is complete and intact, see verifyModelFile.
+     *
+     * The tensor check catches truncated files from the header alone. DIGEST_SHA256 matches
+     * published checksums, DIGEST_CHUNKED_SHA256 is computed in parallel but only matches
+     * chunked digests recorded earlier.
+     *
+     * @param modelPath Path to the GGUF file.
+     * @param digestType The digest to compute, DIGEST_NONE for the tensor check only.
+     * @param expectedDigest Hex digest the file must match, empty to only compute it.
+     * @param checkTensors Run the tensor bounds check before hashing.
+     * @param digest Receives the hex digest.
+     * @param error Receives why the verification failed.
+     * @param progressCallback Optional callback receiving the fraction hashed, return false to cancel.
+     * @param userData Custom user data pointer passed to the progress callback.
+     * @return True if every requested check passed.
+     */
+    bool verifyModel(const std::string& modelPath, DigestType digestType, const std::string& expectedDigest,
+                     bool checkTensors, std::string& digest, std::string& error,
+                     LoadProgressCallback progressCallback = nullptr, void* userData = nullptr);
+
 
 
 private:
@@ -139,20 +430,73 @@ private:
 
     void LoadLibrary(const std::string& dllPath);
 
+#if defined(__cpp_impl_coroutine)
+    ChunkGenerator pullChunks(int sessionId, bool started);
+#endif
+
     /** Function pointers for dynamic linking **/
     typedef bool (*LoadModelFunc)(const char*, struct ModelParameter* params, size_t paramCount, void (*)(const char*));
+    typedef bool (*LoadModelWithProgressFunc)(const char*, struct ModelParameter* params, size_t paramCount, void (*)(const char*), LoadProgressCallback, void *userData);
+    typedef void (*CancelLoadModelFunc)();
     typedef bool (*GenerateResponseFunc)(int sessionId, const char*, void (*)(const char* token, void* user_data), void (*)(const char* completeResponse, void* user_data), void *userData);
+    typedef bool (*GenerateResponseWithOptionsFunc)(int sessionId, const char*, struct ModelParameter* options, size_t optionCount, void (*)(const char* token, void* user_data), void (*)(const char* completeResponse, FinishReason reason, void* user_data), void *userData);
+    typedef bool (*StartGenerationFunc)(int sessionId, const char* prompt, struct ModelParameter* options, size_t optionCount);
+    typedef int (*NextChunkFunc)(int sessionId, const char** chunk, FinishReason* reason);
+    typedef bool (*FinishGenerationFunc)(int sessionId);
+    typedef bool (*CancelGenerationFunc)(int sessionId);
+    typedef bool (*GenerateResponsesFunc)(int sessionId, const char*, int n, struct ModelParameter* options, size_t optionCount, CompletionCallback finalCallback, void *userData);
+    typedef bool (*CompleteInfillFunc)(const char* prefix, const char* suffix, struct ModelParameter* options, size_t optionCount, void (*)(const char* token, void* user_data), void (*)(const char* completion, FinishReason reason, void* user_data), void *userData);
+    typedef bool (*LoadLoraAdapterFunc)(const char* name, const char* path);
+    typedef bool (*UnloadLoraAdapterFunc)(const char* name);
+    typedef bool (*SetSessionLoraAdapterFunc)(int sessionId, const char* name, float scale);
+    typedef void (*SetRequestQueueLimitsFunc)(size_t maxQueueDepth, int maxWaitMs);
+    typedef void (*SetResponseCacheLimitsFunc)(size_t maxEntries, size_t maxBytes, int ttlSeconds);
+    typedef bool (*SetSessionSamplerFunc)(int sessionId, struct ModelParameter* params, size_t paramCount);
     typedef const char* (*ParseGGUFFunc)(const char*, void (*)(const char* key, GGUFType type, void* data, void *userData), void (*callback)(const char* message), void *userData);
     typedef void (*GetContextInfoFunc)(void (*callback)(const char* info, void *), void*);
+    typedef int (*EmbedTextsFunc)(const char** texts, size_t textCount, EmbeddingPooling pooling, bool normalize, float* output, size_t outputCapacity);
+    typedef int (*GetEmbeddingSizeFunc)();
+    typedef int (*TokenizeFunc)(const char* text, bool addSpecial, bool parseSpecial, int32_t* tokens, size_t capacity);
+    typedef int (*DetokenizeFunc)(const int32_t* tokens, size_t tokenCount, bool removeSpecial, bool unparseSpecial, char* text, size_t capacity);
+    typedef bool (*TokenizeBatchFunc)(const char** texts, size_t textCount, bool addSpecial, bool parseSpecial, TokenBatchCallback callback, void* userData);
+    typedef bool (*ScoreContinuationsFunc)(const char* prefix, const char** candidates, size_t candidateCount, float* totalLogprobs, TokenScoreCallback tokenCallback, void* userData);
+
+    typedef int (*ScanModelDirectoryFunc)(const char* directory, const char* indexPath, ModelCatalogCallback callback, void* userData);
+    typedef bool (*EstimateModelMemoryFunc)(const char* modelPath, int contextSize, int sessionCount, int memoryBudgetMb, ModelMemoryEstimate* estimate);
+    typedef bool (*VerifyModelFileFunc)(const char* modelPath, DigestType digestType, const char* expectedDigest, bool checkTensors, LoadProgressCallback progressCallback, void* userData, ModelVerification* result);
 
     typedef bool (*CreateSessionFunc)(int session_id);
     typedef bool (*ClearSessionFunc)(int session_id);
     typedef bool (*DeleteSessionFunc)(int session_id);
 
     LoadModelFunc loadModelFunc; ///< Function pointer for loading models
+    LoadModelWithProgressFunc loadModelWithProgressFunc; ///< Function pointer for loading models with progress
+    CancelLoadModelFunc cancelLoadModelFunc; ///< Function pointer for cancelling a model load
     GenerateResponseFunc generateResponseFunc; ///< Function pointer for generating responses
+    GenerateResponseWithOptionsFunc generateResponseWithOptionsFunc; ///< Function pointer for generating responses with options
+    StartGenerationFunc startGenerationFunc; ///< Function pointer for starting a pull generation
+    NextChunkFunc nextChunkFunc; ///< Function pointer for pulling the next chunk
+    FinishGenerationFunc finishGenerationFunc; ///< Function pointer for ending a pull generation
+    CancelGenerationFunc cancelGenerationFunc; ///< Function pointer for stopping a generation from another thread
+    GenerateResponsesFunc generateResponsesFunc; ///< Function pointer for generating several responses
+    CompleteInfillFunc completeInfillFunc; ///< Function pointer for fill-in-the-middle completion
+    LoadLoraAdapterFunc loadLoraAdapterFunc;
+    UnloadLoraAdapterFunc unloadLoraAdapterFunc;
+    SetSessionLoraAdapterFunc setSessionLoraAdapterFunc;
+    SetRequestQueueLimitsFunc setRequestQueueLimitsFunc;
+    SetResponseCacheLimitsFunc setResponseCacheLimitsFunc;
+    SetSessionSamplerFunc setSessionSamplerFunc;
     ParseGGUFFunc parseGGUFFunc; ///< Function pointer for parsing GGUF metadata
     GetContextInfoFunc getContextInfoFunc;
+    EmbedTextsFunc embedTextsFunc;
+    GetEmbeddingSizeFunc getEmbeddingSizeFunc;
+    TokenizeFunc tokenizeFunc;
+    DetokenizeFunc detokenizeFunc;
+    TokenizeBatchFunc tokenizeBatchFunc;
+    ScoreContinuationsFunc scoreContinuationsFunc;
+    ScanModelDirectoryFunc scanModelDirectoryFunc;
+    EstimateModelMemoryFunc estimateModelMemoryFunc;
+    VerifyModelFileFunc verifyModelFileFunc;
 
     CreateSessionFunc createSessionFunc;
     ClearSessionFunc clearSessionFunc;
@@ -174,7 +518,7 @@ private:
     std::string backend; ///< Backend type (CPU, CUDA, Vulkan)
     std::string library; ///< Path to the dynamic library
 
-    bool modelLoaded = false; // Track if the model is successfully loaded
+    std::atomic<bool> modelLoaded{false}; // Track if the model is successfully loaded, set from the loading thread
     std::string modelPathFile; // Path file name for current model
 
 };
@@ -2,28 +2,161 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <unordered_map>
 
 #include "llama.h"
 #include "LlamaRuntime.h"
+#include "BatchProcessor.h"
+#include "RequestQueue.h"
+#include "ModelCatalog.h"
+#include "MemoryEstimator.h"
+#include "ModelVerifier.h"
 
-// Global pointer to the runtime context
-static LlamaRuntime *runtimeContext = nullptr;
+/**
+ * Runtime pointer of an engine. The loading thread publishes it once the model
+ * is ready while API calls on other threads read it, so it is held atomically.
+ */
+class RuntimePointer {
+public:
+    RuntimePointer &operator=(LlamaRuntime *runtime) {
+        pointer.store(runtime, std::memory_order_release);
+        return *this;
+    }
+
+    operator LlamaRuntime*() const { return pointer.load(std::memory_order_acquire); }
+    LlamaRuntime *operator->() const { return *this; }
+
+private:
+    std::atomic<LlamaRuntime*> pointer{nullptr};
+};
+
+/**
+ * An independent engine: its own model, sessions and request queue.
+ */
+struct LlamaEngineInstance {
+    RuntimePointer runtime;
+
+    // Runtime currently being loaded, published to runtime once loading succeeds
+    LlamaRuntime *loading = nullptr;
+    std::mutex loadingMutex;  // Guards loading against concurrent cancellation
+    std::mutex loadMutex;     // Serialises model loads
+
+    // Response cache limits, kept so limits set before a model is loaded apply to its runtime
+    std::mutex cacheLimitsMutex;  // Also held while the runtime is published
+    bool hasCacheLimits = false;
+    size_t cacheMaxEntries = 0;
+    size_t cacheMaxBytes = 0;
+    int cacheTtlSeconds = 0;
+
+    // Serialises requests on the runtime by priority, rejects them when overloaded
+    RequestQueue requestQueue;
+
+    // Pull generations in progress: the priority each chunk queues with, and the last chunk of each session
+    std::mutex streamMutex;
+    std::unordered_map<int, RequestPriority> streamPriorities;
+    std::unordered_map<int, std::string> streamChunks;  // Only used inside the request queue
+
+    ~LlamaEngineInstance() {
+        delete runtime;
+    }
+};
+
+/**
+ * Returns the instance behind the handle-less functions. It is created on first
+ * use and never destroyed, like the single global runtime it replaces.
+ */
+static LlamaEngineInstance *defaultEngine() {
+    static LlamaEngineInstance *instance = new LlamaEngineInstance();
+    return instance;
+}
+
+/**
+ * Reports a request rejected by the request queue.
+ *
+ * @param engine The engine that rejected the request.
+ * @param scope The rejected queue scope.
+ */
+static void logRejected(LlamaEngineHandle engine, const RequestQueue::Scope &scope) {
+    if (engine->runtime)
+        engine->runtime->logWarning(scope.getError());
+}
+
+/**
+ * Creates an engine instance without a model.
+ *
+ * @return The new engine, destroy it with engineDestroy.
+ */
+LlamaEngine_API LlamaEngineHandle engineCreate() {
+    return new LlamaEngineInstance();
+}
+
+/**
+ * Destroys an engine instance with its model and sessions. No call may be in
+ * progress on the engine.
+ *
+ * @param engine The engine to destroy, the default engine is ignored.
+ */
+LlamaEngine_API void engineDestroy(LlamaEngineHandle engine) {
+    if (engine != defaultEngine())
+        delete engine;
+}
+
+/**
+ * Returns the engine used by the functions that take no engine handle.
+ */
+LlamaEngine_API LlamaEngineHandle engineDefault() {
+    return defaultEngine();
+}
 
 /**
  * Loads a machine learning model with specified parameters.
  *
+ * @param engine The engine handling the call.
  * @param modelPath Path to the model file.
  * @param params Array of model parameters.
  * @param paramCount Number of parameters.
  * @param callback Function pointer for logging messages.
  * @return True if the model is successfully loaded, false otherwise.
  */
-LlamaEngine_API bool loadModel(const char* modelPath,
+LlamaEngine_API bool engineLoadModel(LlamaEngineHandle engine, const char* modelPath,
     struct ModelParameter* params, size_t paramCount,
     void (*callback)(const char*)) {
+    return engineLoadModelWithProgress(engine, modelPath, params, paramCount, callback, nullptr, nullptr);
+}
+
+/**
+ * Loads a model while reporting fractional progress, the load can be cancelled
+ * from another thread with cancelLoadModel.
+ *
+ * @param engine The engine handling the call.
+ * @param modelPath Path to the model file.
+ * @param params Array of model parameters.
+ * @param paramCount Number of parameters.
+ * @param callback Function pointer for logging messages.
+ * @param progressCallback Receives the load progress in [0, 1], returning false cancels the load.
+ * @param userData Custom user data passed to the progress callback.
+ * @return True if the model is successfully loaded, false otherwise.
+ */
+LlamaEngine_API bool engineLoadModelWithProgress(LlamaEngineHandle engine, const char* modelPath,
+    struct ModelParameter* params, size_t paramCount,
+    void (*callback)(const char*),
+    LoadProgressCallback progressCallback,
+    void* userData) {
+
+    std::unique_lock<std::mutex> loadLock(engine->loadMutex, std::try_to_lock);
+    if (!loadLock.owns_lock()) {
+        if (callback)
+            callback("Error: A model load is already in progress\n");
+        return false;
+    }
 
     // Check if a model is already loaded
-    if(runtimeContext){
+    if(engine->runtime){
         std::string message = "Loading model already loaded\n";
         if (callback)
             callback(message.c_str());
@@ -35,8 +168,8 @@ LlamaEngine_API bool loadModel(const char* modelPath,
         callback(message.c_str());
 
     // Initialize runtime context
-    runtimeContext = new LlamaRuntime;
-    runtimeContext->setModelPath(modelPath);
+    LlamaRuntime *runtime = new LlamaRuntime;
+    runtime->setModelPath(modelPath);
 
     // Process parameters
     for (size_t i = 0; i < paramCount; ++i) {
@@ -49,15 +182,7 @@ LlamaEngine_API bool loadModel(const char* modelPath,
                 callback(paramMessage.c_str());
 
              // Set runtime parameters based on recognized names
-            if(paramName == "temperature")
-                runtimeContext->setTemperature(fval);
-            else if(paramName == "repetition_penalty")
-                runtimeContext->setRepetitionPenalty(fval);
-            else if(paramName == "top_P")
-                runtimeContext->setTopP(fval);
-            else if(paramName == "top_k")
-                runtimeContext->setTopK(fval);
-            else if (callback)
+            if (!runtime->setSamplerParameter(paramName, fval) && callback)
                 callback(("Unused parameter: " + paramName).c_str());
         }
         else if (params[i].type == PARAM_INT) {
@@ -68,8 +193,24 @@ LlamaEngine_API bool loadModel(const char* modelPath,
                 callback(paramMessage.c_str());
 
             if(paramName == "context_size")
-                runtimeContext->setContextSize(ival);
-            else if (callback)
+                runtime->setContextSize(ival);
+            else if(paramName == "n_gpu_layers")
+                runtime->setGpuLayers(ival);
+            else if(paramName == "use_mmap")
+                runtime->setUseMmap(ival != 0);
+            else if(paramName == "use_mlock")
+                runtime->setUseMlock(ival != 0);
+            else if(paramName == "readahead")
+                runtime->setReadahead(ival != 0);
+            else if(paramName == "warmup")
+                runtime->setWarmup(ival != 0);
+            else if(paramName == "max_sequences")
+                runtime->setMaxSequences(ival);
+            else if(paramName == "memory_budget_mb")
+                runtime->setMemoryBudget(ival);
+            else if(paramName == "expected_sessions")
+                runtime->setExpectedSessions(ival);
+            else if (!runtime->setSamplerParameter(paramName, ival) && callback)
                 callback((paramName + ": Unknown Type").c_str());
         }
         else if (params[i].type == PARAM_STRING) {
@@ -81,47 +222,105 @@ LlamaEngine_API bool loadModel(const char* modelPath,
     }
 
     // Set logging callback
-    runtimeContext->setLogCallback([callback](const std::string& msg) {
+    runtime->setLogCallback([callback](const std::string& msg) {
         if (callback)
             callback(msg.c_str());
     });
 
+    // Forward load progress
+    if (progressCallback) {
+        runtime->setLoadProgressCallback([progressCallback, userData](float progress) {
+            return progressCallback(progress, userData);
+        });
+    }
+
+    // Expose the runtime to cancelLoadModel while it loads
+    {
+        std::lock_guard<std::mutex> lock(engine->loadingMutex);
+        engine->loading = runtime;
+    }
+
+    bool loaded = runtime->loadModel();
+
+    {
+        std::lock_guard<std::mutex> lock(engine->loadingMutex);
+        engine->loading = nullptr;
+    }
+
     // Load the model and check success
-    if(!runtimeContext->loadModel()){
-        delete runtimeContext;
-        runtimeContext = nullptr;
+    if(!loaded){
+        delete runtime;
         return false;
     }
+
+    std::lock_guard<std::mutex> lock(engine->cacheLimitsMutex);
+    if (engine->hasCacheLimits)
+        runtime->setResponseCacheLimits(engine->cacheMaxEntries, engine->cacheMaxBytes, engine->cacheTtlSeconds);
+    engine->runtime = runtime;
     return true;
 }
 
+/**
+ * Requests cancellation of a model load running on another thread.
+ *
+ * @param engine The engine handling the call.
+ */
+LlamaEngine_API void engineCancelLoadModel(LlamaEngineHandle engine) {
+    std::lock_guard<std::mutex> lock(engine->loadingMutex);
+    if (engine->loading)
+        engine->loading->cancelLoad();
+}
+
 /**
  * @brief Creates a new session and returns a session UUID.
  *
+ * @param engine The engine handling the call.
  * @return A dynamically allocated UUID string. Caller must free the memory.
  */
-LlamaEngine_API bool createSession(int sessionId) {
-    return runtimeContext->createSession(sessionId);
+LlamaEngine_API bool engineCreateSession(LlamaEngineHandle engine, int sessionId) {
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    return engine->runtime->createSession(sessionId);
 }
 
 /**
  * @brief Clears the context history for a specific session.
  *
+ * @param engine The engine handling the call.
  * @param sessionUuid The UUID of the session to clear.
  * @return True if successful, false if session does not exist.
  */
-LlamaEngine_API bool clearSession(int sessionId) {
-    return runtimeContext->clearSession(sessionId);
+LlamaEngine_API bool engineClearSession(LlamaEngineHandle engine, int sessionId) {
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    return engine->runtime->clearSession(sessionId);
 }
 
 /**
  * @brief Deletes a session and frees associated resources.
  *
+ * @param engine The engine handling the call.
  * @param sessionUuid The UUID of the session to delete.
  * @return True if the session was successfully deleted, false otherwise.
  */
-LlamaEngine_API bool deleteSession(int sessionId) {
-    return runtimeContext->deleteSession(sessionId);
+LlamaEngine_API bool engineDeleteSession(LlamaEngineHandle engine, int sessionId) {
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    engine->streamChunks.erase(sessionId);
+    {
+        std::lock_guard<std::mutex> lock(engine->streamMutex);
+        engine->streamPriorities.erase(sessionId);
+    }
+    return engine->runtime->deleteSession(sessionId);
 }
 
 
@@ -133,6 +332,7 @@ LlamaEngine_API bool deleteSession(int sessionId) {
  * is streamed through `streamCallback` in chunks and, if successful, the
  * complete response is passed to `finalCallback`.
  *
+ * @param engine The engine handling the call.
  * @param sessionID The ID of the session to use for generating the response.
  * @param prompt Input prompt string.
  * @param streamCallback Function pointer to receive the response in token chunks.
@@ -143,43 +343,895 @@ LlamaEngine_API bool deleteSession(int sessionId) {
  * @note If the specified session does not exist, the function may return false.
  *       Ensure a valid session is created before calling this function.
  */
-LlamaEngine_API bool generateResponse(int sessionID,
-                                      const char* prompt,
-                                      void (*streamCallback)(const char*, void* userData),
-                                      void (*finalCallback)(const char*, void* userData),
-                                      void* userData) {
-    if (!runtimeContext) {
+LlamaEngine_API bool engineGenerateResponse(LlamaEngineHandle engine, int sessionID,
+                                            const char* prompt,
+                                            void (*streamCallback)(const char*, void* userData),
+                                            void (*finalCallback)(const char*, void* userData),
+                                            void* userData) {
+    if (!engine->runtime) {
         if (streamCallback)
             streamCallback("Error: Runtime context is not initialized.", userData);
         return false;
     }
-    bool ret = runtimeContext->generateResponse(sessionID, prompt, streamCallback, userData);
+
+    // Cleared before waiting for a turn, a stop pressed while the request is queued still applies
+    engine->runtime->clearCancelRequest(sessionID);
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        if (streamCallback)
+            streamCallback(scope.getError().c_str(), userData);
+        return false;
+    }
+
+    bool ret = engine->runtime->generateResponse(sessionID, prompt, streamCallback, userData);
     if(ret && finalCallback)
-        finalCallback(runtimeContext->getResponse(sessionID).c_str(), userData);
+        finalCallback(engine->runtime->getResponse(sessionID).c_str(), userData);
+
+    return ret;
+}
+
+/**
+ * Sets the admission limits of the request queue.
+ *
+ * @param engine The engine handling the call.
+ * @param maxQueueDepth Maximum number of waiting requests, 0 for no limit.
+ * @param maxWaitMs Maximum expected wait in milliseconds, 0 for no limit.
+ */
+LlamaEngine_API void engineSetRequestQueueLimits(LlamaEngineHandle engine, size_t maxQueueDepth, int maxWaitMs) {
+    engine->requestQueue.setLimits(maxQueueDepth, maxWaitMs);
+}
+
+/**
+ * Sets the bounds of the response cache. Limits set before a model is loaded
+ * apply to it once loaded.
+ *
+ * @param engine The engine handling the call.
+ * @param maxEntries Maximum number of cached responses, 0 disables the cache.
+ * @param maxBytes Maximum size in bytes, 0 for no limit.
+ * @param ttlSeconds Lifetime of an entry in seconds, 0 for no expiry.
+ */
+LlamaEngine_API void engineSetResponseCacheLimits(LlamaEngineHandle engine, size_t maxEntries, size_t maxBytes, int ttlSeconds) {
+    std::lock_guard<std::mutex> lock(engine->cacheLimitsMutex);
+    engine->hasCacheLimits = true;
+    engine->cacheMaxEntries = maxEntries;
+    engine->cacheMaxBytes = maxBytes;
+    engine->cacheTtlSeconds = ttlSeconds;
+
+    if (engine->runtime)
+        engine->runtime->setResponseCacheLimits(maxEntries, maxBytes, ttlSeconds);
+}
+
+/**
+ * Loads a LoRA adapter against the loaded model.
+ *
+ * @param engine The engine handling the call.
+ * @param name Name of the adapter.
+ * @param path Path to the adapter file.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineLoadLoraAdapter(LlamaEngineHandle engine, const char* name, const char* path) {
+    if (!engine->runtime || !name || !path)
+        return false;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    return engine->runtime->loadLoraAdapter(name, path);
+}
+
+/**
+ * Unloads a LoRA adapter.
+ *
+ * @param engine The engine handling the call.
+ * @param name Name of the adapter.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineUnloadLoraAdapter(LlamaEngineHandle engine, const char* name) {
+    if (!engine->runtime || !name)
+        return false;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    return engine->runtime->unloadLoraAdapter(name);
+}
+
+/**
+ * Selects the LoRA adapter of a session.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionId The session identifier.
+ * @param name Name of the adapter, null or empty for the base model.
+ * @param scale Adapter scale.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineSetSessionLoraAdapter(LlamaEngineHandle engine, int sessionId, const char* name, float scale) {
+    if (!engine->runtime)
+        return false;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+    return engine->runtime->setSessionLoraAdapter(sessionId, name ? name : "", scale);
+}
+
+/**
+ * Sets the sampler parameters of a session.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionId The session identifier.
+ * @param params Array of sampler parameters.
+ * @param paramCount Number of parameters.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineSetSessionSampler(LlamaEngineHandle engine, int sessionId, struct ModelParameter* params, size_t paramCount) {
+    if (!engine->runtime)
+        return false;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    SamplerSettings settings;
+    if (!engine->runtime->getSessionSampler(sessionId, settings))
+        return false;
+
+    for (size_t i = 0; i < paramCount; ++i) {
+        std::string paramName(params[i].key);
+        bool known = false;
+
+        if (params[i].type == PARAM_FLOAT && params[i].value)
+            known = settings.set(paramName, *(float*)params[i].value);
+        else if (params[i].type == PARAM_INT && params[i].value)
+            known = settings.set(paramName, *(int*)params[i].value);
+
+        if (!known)
+            engine->runtime->logWarning("Unused sampler parameter: " + paramName);
+    }
+
+    return engine->runtime->setSessionSampler(sessionId, settings);
+}
+
+/**
+ * Reads per request generation options from key/value parameters.
+ *
+ * @param engine The engine reporting unknown options.
+ * @param options Array of generation options.
+ * @param optionCount Number of options.
+ * @param generationOptions Receives the recognised options.
+ * @param priority Receives the request priority, left unchanged if not set.
+ */
+static void parseGenerationOptions(LlamaEngineHandle engine, struct ModelParameter* options, size_t optionCount,
+                                   GenerationOptions &generationOptions, RequestPriority &priority) {
+    for (size_t i = 0; i < optionCount; ++i) {
+        std::string optionName(options[i].key);
+
+        if (options[i].type == PARAM_STRING && options[i].value) {
+            const char* sval = (const char*)options[i].value;
+
+            if (optionName == "grammar")
+                generationOptions.grammar = sval;
+            else if (optionName == "grammar_root")
+                generationOptions.grammarRoot = sval;
+            else if (optionName == "json_schema")
+                generationOptions.jsonSchema = sval;
+            else if (optionName == "stop")
+                generationOptions.stop.push_back(sval);
+            else if (optionName == "lora")
+                generationOptions.lora = sval;
+            else if (optionName == "priority") {
+                std::string value(sval);
+                if (value == "interactive")
+                    priority = RequestPriority::Interactive;
+                else if (value == "normal")
+                    priority = RequestPriority::Normal;
+                else if (value == "background")
+                    priority = RequestPriority::Background;
+                else
+                    engine->runtime->logWarning("Unknown request priority: " + value);
+            }
+            else
+                engine->runtime->logWarning("Unused generation option: " + optionName);
+        }
+        else if (options[i].type == PARAM_FLOAT && options[i].value) {
+            float fval = *(float*)options[i].value;
+
+            if (optionName == "lora_scale")
+                generationOptions.loraScale = fval;
+            else if (SamplerSettings::isParameter(optionName))
+                generationOptions.sampler.emplace_back(optionName, fval);
+            else
+                engine->runtime->logWarning("Unused generation option: " + optionName);
+        }
+        else if (options[i].type == PARAM_INT && options[i].value) {
+            int ival = *(int*)options[i].value;
+
+            if (optionName == "max_tokens")
+                generationOptions.maxTokens = std::max(ival, 0);
+            else if (optionName == "timeout_ms")
+                generationOptions.timeoutMs = std::max(ival, 0);
+            else if (SamplerSettings::isParameter(optionName))
+                generationOptions.sampler.emplace_back(optionName, ival);
+            else
+                engine->runtime->logWarning("Unused generation option: " + optionName);
+        }
+        else
+            engine->runtime->logWarning("Unused generation option: " + optionName);
+    }
+}
+
+/**
+ * Generates a response with per request generation options.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @param prompt The input text prompt.
+ * @param options Array of generation options.
+ * @param optionCount Number of options.
+ * @param streamCallback Function to handle streamed response chunks.
+ * @param finalCallback Function to handle the final response and finish reason.
+ * @param userData Custom user data for the callbacks.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineGenerateResponseWithOptions(LlamaEngineHandle engine, int sessionID,
+                                                       const char* prompt,
+                                                       struct ModelParameter* options, size_t optionCount,
+                                                       void (*streamCallback)(const char*, void* userData),
+                                                       void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                                       void* userData) {
+    if (!engine->runtime) {
+        if (streamCallback)
+            streamCallback("Error: Runtime context is not initialized.", userData);
+        return false;
+    }
+
+    GenerationOptions generationOptions;
+    RequestPriority priority = RequestPriority::Interactive;
+    parseGenerationOptions(engine, options, optionCount, generationOptions, priority);
+
+    engine->runtime->clearCancelRequest(sessionID);
+
+    RequestQueue::Scope scope(engine->requestQueue, priority);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        if (streamCallback)
+            streamCallback(scope.getError().c_str(), userData);
+        return false;
+    }
+
+    bool ret = engine->runtime->generateResponse(sessionID, prompt, generationOptions, streamCallback, userData);
+    if(ret && finalCallback)
+        finalCallback(engine->runtime->getResponse(sessionID).c_str(), engine->runtime->getFinishReason(sessionID), userData);
+
+    return ret;
+}
+
+/**
+ * Starts a generation that the caller advances chunk by chunk with nextChunk.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @param prompt The input text prompt.
+ * @param options Array of generation options.
+ * @param optionCount Number of options.
+ * @return True if the generation was started, false otherwise.
+ */
+LlamaEngine_API bool engineStartGeneration(LlamaEngineHandle engine, int sessionID,
+                                           const char* prompt,
+                                           struct ModelParameter* options, size_t optionCount) {
+    if (!engine->runtime)
+        return false;
+
+    GenerationOptions generationOptions;
+    RequestPriority priority = RequestPriority::Interactive;
+    parseGenerationOptions(engine, options, optionCount, generationOptions, priority);
+
+    engine->runtime->clearCancelRequest(sessionID);
+
+    RequestQueue::Scope scope(engine->requestQueue, priority);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    if (!engine->runtime->startGeneration(sessionID, prompt, generationOptions))
+        return false;
+
+    // Every chunk of the stream queues again with the priority of the request
+    std::lock_guard<std::mutex> lock(engine->streamMutex);
+    engine->streamPriorities[sessionID] = priority;
+    return true;
+}
+
+/**
+ * Generates the next chunk of a generation started with startGeneration.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @param chunk Receives the chunk text, valid until the next call for the session.
+ * @param reason Optional, receives the finish reason once the generation has ended.
+ * @return 1 if a chunk was generated, 0 if the generation has ended, -1 on error,
+ *         -2 if the request queue rejected the call and the generation is kept.
+ */
+LlamaEngine_API int engineNextChunk(LlamaEngineHandle engine, int sessionID, const char** chunk, FinishReason* reason) {
+    if (!engine->runtime || !chunk)
+        return -1;
+
+    RequestPriority priority = RequestPriority::Interactive;
+    {
+        std::lock_guard<std::mutex> lock(engine->streamMutex);
+        auto found = engine->streamPriorities.find(sessionID);
+        if (found != engine->streamPriorities.end())
+            priority = found->second;
+    }
+
+    // Turned away before reaching the runtime, the stream is intact and the call can be retried
+    RequestQueue::Scope scope(engine->requestQueue, priority);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return -2;
+    }
+
+    std::string &text = engine->streamChunks[sessionID];
+    int ret = engine->runtime->nextChunk(sessionID, text);
+    *chunk = text.c_str();
+
+    if (ret <= 0) {
+        std::lock_guard<std::mutex> lock(engine->streamMutex);
+        engine->streamPriorities.erase(sessionID);
+    }
+    if (ret == 0 && reason)
+        *reason = engine->runtime->getFinishReason(sessionID);
+
+    return ret;
+}
+
+/**
+ * Ends a generation started with startGeneration before it is complete.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @return True if a generation was ended, false if none was in progress.
+ */
+LlamaEngine_API bool engineFinishGeneration(LlamaEngineHandle engine, int sessionID) {
+    if (!engine->runtime)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(engine->streamMutex);
+        engine->streamPriorities.erase(sessionID);
+    }
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Interactive);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    return engine->runtime->finishGeneration(sessionID);
+}
+
+/**
+ * Stops the generation running on a session from another thread.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @return True if the session exists, false otherwise.
+ */
+LlamaEngine_API bool engineCancelGeneration(LlamaEngineHandle engine, int sessionID) {
+    if (!engine->runtime)
+        return false;
+
+    // Not queued, the generation to stop holds the engine
+    return engine->runtime->cancelGeneration(sessionID);
+}
+
+/**
+ * Generates n alternative responses sharing one prefilled prompt.
+ *
+ * @param engine The engine handling the call.
+ * @param sessionID The session identifier.
+ * @param prompt The input text prompt.
+ * @param n Number of completions.
+ * @param options Array of generation options.
+ * @param optionCount Number of options.
+ * @param finalCallback Function receiving each completion.
+ * @param userData Custom user data for the callback.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineGenerateResponses(LlamaEngineHandle engine, int sessionID,
+                                             const char* prompt,
+                                             int n,
+                                             struct ModelParameter* options, size_t optionCount,
+                                             CompletionCallback finalCallback,
+                                             void* userData) {
+    if (!engine->runtime)
+        return false;
+
+    GenerationOptions generationOptions;
+    RequestPriority priority = RequestPriority::Interactive;
+    parseGenerationOptions(engine, options, optionCount, generationOptions, priority);
+
+    engine->runtime->clearCancelRequest(sessionID);
+
+    RequestQueue::Scope scope(engine->requestQueue, priority);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    std::vector<std::string> responses;
+    std::vector<FinishReason> reasons;
+    if (!engine->runtime->generateResponses(sessionID, prompt, n, generationOptions, responses, reasons))
+        return false;
+
+    if (finalCallback) {
+        for (size_t i = 0; i < responses.size(); i++)
+            finalCallback((int)i, responses[i].c_str(), reasons[i], userData);
+    }
+    return true;
+}
+
+/**
+ * Completes the text between a prefix and a suffix.
+ *
+ * @param engine The engine handling the call.
+ * @param prefix Text before the cursor.
+ * @param suffix Text after the cursor.
+ * @param options Array of generation options.
+ * @param optionCount Number of options.
+ * @param streamCallback Function to handle streamed completion chunks.
+ * @param finalCallback Function to handle the final completion.
+ * @param userData Custom user data for the callbacks.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineCompleteInfill(LlamaEngineHandle engine, const char* prefix,
+                                          const char* suffix,
+                                          struct ModelParameter* options, size_t optionCount,
+                                          void (*streamCallback)(const char*, void* userData),
+                                          void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                          void* userData) {
+    if (!engine->runtime)
+        return false;
+
+    GenerationOptions generationOptions;
+    RequestPriority priority = RequestPriority::Interactive;
+    parseGenerationOptions(engine, options, optionCount, generationOptions, priority);
+
+    RequestQueue::Scope scope(engine->requestQueue, priority);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    std::string completion;
+    FinishReason reason;
+    bool ret = engine->runtime->completeInfill(prefix ? prefix : "", suffix ? suffix : "", generationOptions,
+                                              streamCallback, userData, completion, reason);
+    if (ret && finalCallback)
+        finalCallback(completion.c_str(), reason, userData);
+
+    return ret;
+}
+
+/**
+ * Processes a JSONL file of prompts in batch mode.
+ *
+ * @param engine The engine handling the call.
+ * @param inputPath Path of the input JSONL file.
+ * @param outputPath Path of the output JSONL file.
+ * @param options Array of batch options.
+ * @param optionCount Number of options.
+ * @param progressCallback Function receiving the number of records written.
+ * @param userData Custom user data for the callback.
+ * @return Number of records written, -1 on failure.
+ */
+LlamaEngine_API long engineProcessBatchFile(LlamaEngineHandle engine, const char* inputPath,
+                                            const char* outputPath,
+                                            struct ModelParameter* options, size_t optionCount,
+                                            void (*progressCallback)(size_t completed, void* userData),
+                                            void* userData) {
+    if (!engine->runtime || !inputPath || !outputPath)
+        return -1;
+
+    BatchOptions batchOptions;
+    for (size_t i = 0; i < optionCount; ++i) {
+        std::string optionName(options[i].key);
+
+        if (options[i].type == PARAM_INT && options[i].value) {
+            int ival = *(int*)options[i].value;
+
+            if (optionName == "slots")
+                batchOptions.slots = ival;
+            else if (optionName == "max_tokens")
+                batchOptions.maxTokens = ival;
+            else if (optionName == "context_size")
+                batchOptions.contextSize = ival;
+            else if (optionName == "resume")
+                batchOptions.resume = ival != 0;
+            else
+                engine->runtime->logWarning("Unused batch option: " + optionName);
+        }
+        else
+            engine->runtime->logWarning("Unused batch option: " + optionName);
+    }
+
+    // Batch jobs run in the background and let interactive requests in between decode steps
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Background);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return -1;
+    }
+
+    BatchProcessor processor(*engine->runtime, batchOptions);
+    processor.setYieldCallback([&scope]() {
+        scope.yield();
+    });
+    return processor.process(inputPath, outputPath, [progressCallback, userData](size_t completed) {
+        if (progressCallback)
+            progressCallback(completed, userData);
+    });
+}
+
+/**
+ * Computes pooled embeddings for a list of texts.
+ *
+ * @param engine The engine handling the call.
+ * @param texts Array of input texts.
+ * @param textCount Number of texts.
+ * @param pooling Pooling applied over the token embeddings.
+ * @param normalize L2 normalize each vector.
+ * @param output Buffer receiving textCount * embedding size floats.
+ * @param outputCapacity Number of floats available in output.
+ * @return The embedding size on success, -1 on failure.
+ */
+LlamaEngine_API int engineEmbedTexts(LlamaEngineHandle engine, const char** texts, size_t textCount,
+                                     EmbeddingPooling pooling, bool normalize,
+                                     float* output, size_t outputCapacity) {
+    if (!engine->runtime)
+        return -1;
+
+    enum llama_pooling_type poolingType = LLAMA_POOLING_TYPE_MEAN;
+    if (pooling == POOLING_CLS)
+        poolingType = LLAMA_POOLING_TYPE_CLS;
+    else if (pooling == POOLING_LAST)
+        poolingType = LLAMA_POOLING_TYPE_LAST;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Normal);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return -1;
+    }
+
+    std::vector<std::string> inputs(texts, texts + textCount);
+    return engine->runtime->embed(inputs, poolingType, normalize, output, outputCapacity);
+}
+
+/**
+ * Tokenizes a text.
+ *
+ * @param engine The engine handling the call.
+ * @param text The text.
+ * @param addSpecial Add BOS/EOS tokens.
+ * @param parseSpecial Parse special token text.
+ * @param tokens Buffer receiving the tokens.
+ * @param capacity Number of tokens available in the buffer.
+ * @return The token count of the text, -1 on failure.
+ */
+LlamaEngine_API int engineTokenize(LlamaEngineHandle engine, const char* text, bool addSpecial, bool parseSpecial, int32_t* tokens, size_t capacity) {
+    if (!engine->runtime || !text)
+        return -1;
+
+    std::vector<llama_token> result;
+    if (!engine->runtime->tokenize(text, addSpecial, parseSpecial, result))
+        return -1;
+
+    if (tokens)
+        std::copy_n(result.begin(), std::min(result.size(), capacity), tokens);
+    return (int)result.size();
+}
+
+/**
+ * Converts tokens to text.
+ *
+ * @param engine The engine handling the call.
+ * @param tokens The tokens.
+ * @param tokenCount Number of tokens.
+ * @param removeSpecial Drop BOS/EOS tokens.
+ * @param unparseSpecial Render special tokens as text.
+ * @param text Buffer receiving the text.
+ * @param capacity Number of bytes available in the buffer.
+ * @return The length of the text, -1 on failure.
+ */
+LlamaEngine_API int engineDetokenize(LlamaEngineHandle engine, const int32_t* tokens, size_t tokenCount, bool removeSpecial, bool unparseSpecial,
+                                     char* text, size_t capacity) {
+    if (!engine->runtime || (!tokens && tokenCount > 0))
+        return -1;
+
+    std::string result;
+    if (!engine->runtime->detokenize(tokens, tokenCount, removeSpecial, unparseSpecial, result))
+        return -1;
+
+    if (text && capacity > 0) {
+        const size_t length = std::min(result.size(), capacity - 1);
+        std::memcpy(text, result.data(), length);
+        text[length] = '\0';
+    }
+    return (int)result.size();
+}
+
+/**
+ * Tokenizes many texts in parallel.
+ *
+ * @param engine The engine handling the call.
+ * @param texts Array of texts.
+ * @param textCount Number of texts.
+ * @param addSpecial Add BOS/EOS tokens.
+ * @param parseSpecial Parse special token text.
+ * @param callback Function receiving the tokens and offsets.
+ * @param userData Custom user data for the callback.
+ * @return True if successful, false otherwise.
+ */
+LlamaEngine_API bool engineTokenizeBatch(LlamaEngineHandle engine, const char** texts, size_t textCount, bool addSpecial, bool parseSpecial,
+                                         TokenBatchCallback callback, void* userData) {
+    if (!engine->runtime)
+        return false;
+
+    std::vector<std::string> inputs;
+    inputs.reserve(textCount);
+    for (size_t i = 0; i < textCount; i++)
+        inputs.emplace_back(texts[i] ? texts[i] : "");
+
+    std::vector<llama_token> tokens;
+    std::vector<size_t> offsets;
+    if (!engine->runtime->tokenizeBatch(inputs, addSpecial, parseSpecial, tokens, offsets))
+        return false;
+
+    if (callback)
+        callback(tokens.data(), offsets.data(), textCount, userData);
+    return true;
+}
+
+/**
+ * Get the embedding size of the loaded model.
+ * @param engine The engine handling the call.
+ * @return The embedding size, or -1 if no model is loaded.
+ */
+LlamaEngine_API int engineGetEmbeddingSize(LlamaEngineHandle engine) {
+    if (!engine->runtime)
+        return -1;
+    return engine->runtime->getEmbeddingSize();
+}
+
+/**
+ * Scores candidate continuations of a shared prefix.
+ *
+ * @param engine The engine handling the call.
+ * @param prefix Shared prefix text.
+ * @param candidates Array of candidate continuations.
+ * @param candidateCount Number of candidates.
+ * @param totalLogprobs Receives the summed log-probability of each candidate.
+ * @param tokenCallback Optional per token log-probability callback.
+ * @param userData Custom user data for the callback.
+ * @return True if scoring succeeded, false otherwise.
+ */
+LlamaEngine_API bool engineScoreContinuations(LlamaEngineHandle engine, const char* prefix,
+                                              const char** candidates, size_t candidateCount,
+                                              float* totalLogprobs,
+                                              TokenScoreCallback tokenCallback,
+                                              void* userData) {
+    if (!engine->runtime)
+        return false;
+
+    RequestQueue::Scope scope(engine->requestQueue, RequestPriority::Normal);
+    if (!scope.isAdmitted()) {
+        logRejected(engine, scope);
+        return false;
+    }
+
+    std::vector<std::string> inputs(candidates, candidates + candidateCount);
+    std::vector<float> totals;
+
+    bool ret = engine->runtime->scoreContinuations(prefix, inputs, totals,
+        [tokenCallback, userData](size_t candidate, const std::string& piece, float logprob) {
+            if (tokenCallback)
+                tokenCallback(candidate, piece.c_str(), logprob, userData);
+        });
+
+    if (ret && totalLogprobs)
+        std::copy(totals.begin(), totals.end(), totalLogprobs);
 
     return ret;
 }
 
 /**
  * Get the latest complete response.
+ * @param engine The engine handling the call.
  * @return Returns the complete latest generated response.
  */
-LlamaEngine_API const char* getLastResponse() {
+LlamaEngine_API const char* engineGetLastResponse(LlamaEngineHandle engine) {
     const int defaultSession = 0;
-    return runtimeContext->getResponse(defaultSession).c_str();
+    return engine->runtime->getResponse(defaultSession).c_str();
 }
 
-LlamaEngine_API void getContextInfo(void (*callback)(const char*info, void*userData), void* userData){
-    if (!runtimeContext) {
+LlamaEngine_API void engineGetContextInfo(LlamaEngineHandle engine, void (*callback)(const char* info, void* userData), void* userData){
+    if (!engine->runtime) {
         if (callback)
             callback("Error: Runtime context is not initialized.", userData);
         return;
     }
 
-    std::string result = runtimeContext->getContextInfo();
+    std::string result = engine->runtime->getContextInfo();
     callback(result.c_str(), userData);
 }
 
+// Functions without an engine handle run on the default engine
+
+LlamaEngine_API bool loadModel(const char* modelPath,
+    struct ModelParameter* params, size_t paramCount,
+    void (*callback)(const char*)) {
+    return engineLoadModel(defaultEngine(), modelPath, params, paramCount, callback);
+}
+
+LlamaEngine_API bool loadModelWithProgress(const char* modelPath,
+    struct ModelParameter* params, size_t paramCount,
+    void (*callback)(const char*),
+    LoadProgressCallback progressCallback,
+    void* userData) {
+    return engineLoadModelWithProgress(defaultEngine(), modelPath, params, paramCount, callback, progressCallback, userData);
+}
+
+LlamaEngine_API void cancelLoadModel() {
+    engineCancelLoadModel(defaultEngine());
+}
+
+LlamaEngine_API bool createSession(int sessionId) {
+    return engineCreateSession(defaultEngine(), sessionId);
+}
+
+LlamaEngine_API bool clearSession(int sessionId) {
+    return engineClearSession(defaultEngine(), sessionId);
+}
+
+LlamaEngine_API bool deleteSession(int sessionId) {
+    return engineDeleteSession(defaultEngine(), sessionId);
+}
+
+LlamaEngine_API bool generateResponse(int sessionID,
+                                      const char* prompt,
+                                      void (*streamCallback)(const char*, void* userData),
+                                      void (*finalCallback)(const char*, void* userData),
+                                      void* userData) {
+    return engineGenerateResponse(defaultEngine(), sessionID, prompt, streamCallback, finalCallback, userData);
+}
+
+LlamaEngine_API void setRequestQueueLimits(size_t maxQueueDepth, int maxWaitMs) {
+    engineSetRequestQueueLimits(defaultEngine(), maxQueueDepth, maxWaitMs);
+}
+
+LlamaEngine_API void setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds) {
+    engineSetResponseCacheLimits(defaultEngine(), maxEntries, maxBytes, ttlSeconds);
+}
+
+LlamaEngine_API bool loadLoraAdapter(const char* name, const char* path) {
+    return engineLoadLoraAdapter(defaultEngine(), name, path);
+}
+
+LlamaEngine_API bool unloadLoraAdapter(const char* name) {
+    return engineUnloadLoraAdapter(defaultEngine(), name);
+}
+
+LlamaEngine_API bool setSessionLoraAdapter(int sessionId, const char* name, float scale) {
+    return engineSetSessionLoraAdapter(defaultEngine(), sessionId, name, scale);
+}
+
+LlamaEngine_API bool setSessionSampler(int sessionId, struct ModelParameter* params, size_t paramCount) {
+    return engineSetSessionSampler(defaultEngine(), sessionId, params, paramCount);
+}
+
+LlamaEngine_API bool generateResponseWithOptions(int sessionID,
+                                                 const char* prompt,
+                                                 struct ModelParameter* options, size_t optionCount,
+                                                 void (*streamCallback)(const char*, void* userData),
+                                                 void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                                 void* userData) {
+    return engineGenerateResponseWithOptions(defaultEngine(), sessionID, prompt, options, optionCount, streamCallback, finalCallback, userData);
+}
+
+LlamaEngine_API bool startGeneration(int sessionID,
+                                     const char* prompt,
+                                     struct ModelParameter* options, size_t optionCount) {
+    return engineStartGeneration(defaultEngine(), sessionID, prompt, options, optionCount);
+}
+
+LlamaEngine_API int nextChunk(int sessionID, const char** chunk, FinishReason* reason) {
+    return engineNextChunk(defaultEngine(), sessionID, chunk, reason);
+}
+
+LlamaEngine_API bool finishGeneration(int sessionID) {
+    return engineFinishGeneration(defaultEngine(), sessionID);
+}
+
+LlamaEngine_API bool cancelGeneration(int sessionID) {
+    return engineCancelGeneration(defaultEngine(), sessionID);
+}
+
+LlamaEngine_API bool generateResponses(int sessionID,
+                                       const char* prompt,
+                                       int n,
+                                       struct ModelParameter* options, size_t optionCount,
+                                       CompletionCallback finalCallback,
+                                       void* userData) {
+    return engineGenerateResponses(defaultEngine(), sessionID, prompt, n, options, optionCount, finalCallback, userData);
+}
+
+LlamaEngine_API bool completeInfill(const char* prefix,
+                                    const char* suffix,
+                                    struct ModelParameter* options, size_t optionCount,
+                                    void (*streamCallback)(const char*, void* userData),
+                                    void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                    void* userData) {
+    return engineCompleteInfill(defaultEngine(), prefix, suffix, options, optionCount, streamCallback, finalCallback, userData);
+}
+
+LlamaEngine_API long processBatchFile(const char* inputPath,
+                                      const char* outputPath,
+                                      struct ModelParameter* options, size_t optionCount,
+                                      void (*progressCallback)(size_t completed, void* userData),
+                                      void* userData) {
+    return engineProcessBatchFile(defaultEngine(), inputPath, outputPath, options, optionCount, progressCallback, userData);
+}
+
+LlamaEngine_API int embedTexts(const char** texts, size_t textCount,
+                               EmbeddingPooling pooling, bool normalize,
+                               float* output, size_t outputCapacity) {
+    return engineEmbedTexts(defaultEngine(), texts, textCount, pooling, normalize, output, outputCapacity);
+}
+
+LlamaEngine_API int tokenize(const char* text, bool addSpecial, bool parseSpecial, int32_t* tokens, size_t capacity) {
+    return engineTokenize(defaultEngine(), text, addSpecial, parseSpecial, tokens, capacity);
+}
+
+LlamaEngine_API int detokenize(const int32_t* tokens, size_t tokenCount, bool removeSpecial, bool unparseSpecial,
+                               char* text, size_t capacity) {
+    return engineDetokenize(defaultEngine(), tokens, tokenCount, removeSpecial, unparseSpecial, text, capacity);
+}
+
+LlamaEngine_API bool tokenizeBatch(const char** texts, size_t textCount, bool addSpecial, bool parseSpecial,
+                                   TokenBatchCallback callback, void* userData) {
+    return engineTokenizeBatch(defaultEngine(), texts, textCount, addSpecial, parseSpecial, callback, userData);
+}
+
+LlamaEngine_API int getEmbeddingSize() {
+    return engineGetEmbeddingSize(defaultEngine());
+}
+
+LlamaEngine_API bool scoreContinuations(const char* prefix,
+                                        const char** candidates, size_t candidateCount,
+                                        float* totalLogprobs,
+                                        TokenScoreCallback tokenCallback,
+                                        void* userData) {
+    return engineScoreContinuations(defaultEngine(), prefix, candidates, candidateCount, totalLogprobs, tokenCallback, userData);
+}
+
+LlamaEngine_API const char* getLastResponse() {
+    return engineGetLastResponse(defaultEngine());
+}
+
+LlamaEngine_API void getContextInfo(void (*callback)(const char*info, void*userData), void* userData) {
+    engineGetContextInfo(defaultEngine(), callback, userData);
+}
+
 /**
  * Parses GGUF metadata from a model file.
  *
@@ -190,18 +1242,18 @@ LlamaEngine_API void getContextInfo(void (*callback)(const char*info, void*userD
  * @return Pointer to the model name as a C-style string.
  */
 LlamaEngine_API char* parseGGUF(const char* filepath, GGUFAttributeCallback callback, void (*messageCallback)(const char* message), void *user_data) {
-    // Parse GGUF metadata using runtimeContext
+    // Parse GGUF metadata, no runtime is needed
     GGUFMetadata guffMetadata = LlamaRuntime::parseGGUF(filepath, messageCallback);
 
-    // Initialize LlmMetadata structure to hold the parsed data
-    // Todo, use a context or system to make this concurent/thread safe
-    static LlmMetadata metadata; // Static so it persists after the function returns
-    metadata = LlmMetadata(); // clear metadata
+    // Per thread so concurrent parses, e.g. from several engines, do not overwrite each other
+    thread_local std::string modelName;
 
     // Extract model name or use default
     auto nameEntry = guffMetadata.entries.find("model_name");
-    metadata.name = (nameEntry != guffMetadata.entries.end() && nameEntry->second.type == TYPE_STRING)
-        ? nameEntry->second.svalue.c_str()
+    if (nameEntry == guffMetadata.entries.end())
+        nameEntry = guffMetadata.entries.find("general.name");
+    modelName = (nameEntry != guffMetadata.entries.end() && nameEntry->second.type == TYPE_STRING)
+        ? nameEntry->second.svalue
         : "UnknownModel";  // Default fallback
 
     // Process extracted metadata attributes and invoke the callback if provided
@@ -211,13 +1263,156 @@ LlamaEngine_API char* parseGGUF(const char* filepath, GGUFAttributeCallback call
             if (entry.second.type == TYPE_UINT32) {
                 callback(entry.first.c_str(), entry.second.type, const_cast<void*>(static_cast<const void*>(&entry.second.ivalue)), user_data);
             }
-            else if (entry.second.type == TYPE_STRING) {
+            else if (entry.second.type == TYPE_STRING || entry.second.type == TYPE_ARRAY) {
                 callback(entry.first.c_str(), entry.second.type, const_cast<void*>(static_cast<const void*>(entry.second.svalue.c_str())), user_data);
             }
+            else if (entry.second.type == TYPE_INT64) {
+                callback(entry.first.c_str(), entry.second.type, const_cast<void*>(static_cast<const void*>(&entry.second.lvalue)), user_data);
+            }
+            else if (entry.second.type == TYPE_FLOAT64) {
+                callback(entry.first.c_str(), entry.second.type, const_cast<void*>(static_cast<const void*>(&entry.second.fvalue)), user_data);
+            }
+            else if (entry.second.type == TYPE_BOOL) {
+                bool value = entry.second.lvalue != 0;
+                callback(entry.first.c_str(), entry.second.type, &value, user_data);
+            }
             // Handle additional and future types here
         }
     }
 
     // Return the model name as a char*
-    return const_cast<char*>(metadata.name);
+    return const_cast<char*>(modelName.c_str());
+}
+
+/**
+ * Lists the GGUF models of a directory, reading only new or changed files.
+ *
+ * @param directory The models directory.
+ * @param indexPath Path of the index file, null for ".catalog.json" in the directory.
+ * @param callback Called once per model.
+ * @param userData Custom user data for the callback.
+ * @return The number of models, -1 if the directory cannot be listed.
+ */
+LlamaEngine_API int scanModelDirectory(const char* directory, const char* indexPath,
+                                       ModelCatalogCallback callback, void* userData) {
+    if (!directory)
+        return -1;
+
+    // Scans of the same index would race on its file
+    static std::mutex catalogMutex;
+    std::lock_guard<std::mutex> lock(catalogMutex);
+
+    const std::string index = indexPath ? std::string(indexPath) : std::string(directory) + "/.catalog.json";
+
+    ModelCatalog catalog;
+    catalog.load(index);
+    const size_t indexed = catalog.entries().size();
+
+    // The index is only rewritten when a model was added, changed or removed
+    int read = catalog.scan(directory);
+    if (read < 0)
+        return -1;
+    if (read > 0 || catalog.entries().size() != indexed)
+        catalog.save(index);
+
+    for (const ModelCatalog::Entry &model : catalog.entries()) {
+        if (!callback)
+            break;
+
+        ModelCatalogEntry entry = {
+            model.path.c_str(), model.size, model.valid, model.error.c_str(),
+            model.name.c_str(), model.architecture.c_str(),
+            model.fileType, model.contextLength, model.embeddingLength, model.blockCount,
+            model.vocabularySize, model.tensorCount, model.parameterCount
+        };
+        callback(&entry, userData);
+    }
+
+    return (int)catalog.entries().size();
+}
+
+/**
+ * Predicts the memory a model needs from its GGUF header, without loading it.
+ *
+ * @param modelPath Path to the GGUF file.
+ * @param contextSize Context size of each session, 0 to pick the largest that fits the budget.
+ * @param sessionCount Number of sessions, 0 to pick the largest that fits the budget.
+ *                     With an automatic context size a count of 0 means one session.
+ * @param memoryBudgetMb Memory available in MB, 0 for the physical memory of the machine.
+ * @param estimate Receives the weight, KV cache and compute sizes with the context size and
+ *                 session count they were computed for. Filled whenever the file can be read,
+ *                 also when the configuration does not fit.
+ * @return True if the configuration fits the budget, false if it does not, nothing fits or
+ *         the file cannot be read.
+ */
+LlamaEngine_API bool estimateModelMemory(const char* modelPath, int contextSize, int sessionCount,
+                                         int memoryBudgetMb, ModelMemoryEstimate* estimate) {
+    if (!modelPath || !estimate)
+        return false;
+
+    *estimate = ModelMemoryEstimate();
+
+    MemoryEstimator estimator;
+    if (!estimator.open(modelPath))
+        return false;
+
+    const uint64_t budget = memoryBudgetMb > 0 ? (uint64_t)memoryBudgetMb * 1024 * 1024 : MemoryEstimator::physicalMemory();
+
+    // At most one of the two is picked, a session count of 0 with an automatic context means one session
+    if (contextSize <= 0) {
+        sessionCount = std::max(sessionCount, 1);
+        contextSize = estimator.fitContextSize(budget, sessionCount);
+    }
+    else if (sessionCount <= 0) {
+        sessionCount = estimator.fitSessionCount(budget, contextSize);
+    }
+
+    estimate->trainedContextLength = estimator.trainedContextLength();
+    if (contextSize <= 0 || sessionCount <= 0)
+        return false;
+
+    MemoryEstimator::Estimate result = estimator.estimate(contextSize, sessionCount);
+    estimate->weightBytes = result.weightBytes;
+    estimate->kvCacheBytes = result.kvCacheBytes;
+    estimate->computeBytes = result.computeBytes;
+    estimate->totalBytes = result.totalBytes;
+    estimate->contextSize = result.contextSize;
+    estimate->sessionCount = result.sessionCount;
+    return result.totalBytes <= budget;
+}
+
+/**
+ * Checks that a model file is complete and intact, optionally against a known digest.
+ *
+ * @param modelPath Path to the GGUF file.
+ * @param digestType The digest to compute, DIGEST_NONE to skip hashing.
+ * @param expectedDigest Hex digest the file must match, case and whitespace ignored,
+ *                       null or empty to only compute it.
+ * @param checkTensors Run the header based tensor check before hashing.
+ * @param progressCallback Optional, receives the fraction of the file hashed from the
+ *                         hashing threads, one call at a time; return false to cancel.
+ * @param userData Custom user data passed to the progress callback.
+ * @param result Optional, receives the hex digest and the reason of a failure.
+ * @return True if every requested check passed, false on a failed check, a digest
+ *         mismatch, a read error or a cancellation.
+ */
+LlamaEngine_API bool verifyModelFile(const char* modelPath, DigestType digestType, const char* expectedDigest,
+                                     bool checkTensors, LoadProgressCallback progressCallback, void* userData,
+                                     ModelVerification* result) {
+    ModelVerifier verifier;
+    if (progressCallback) {
+        verifier.setProgressCallback([progressCallback, userData](float progress) {
+            return progressCallback(progress, userData);
+        });
+    }
+
+    const bool verified = modelPath &&
+        verifier.verify(modelPath, (ModelVerifier::DigestType)digestType, expectedDigest ? expectedDigest : "", checkTensors);
+
+    if (result) {
+        const std::string error = modelPath ? verifier.error() : "No model path";
+        snprintf(result->digest, sizeof(result->digest), "%s", verifier.digest().c_str());
+        snprintf(result->error, sizeof(result->error), "%s", error.c_str());
+    }
+    return verified;
 }
@@ -2,6 +2,7 @@
 #define LlamaEngine_h
 
 #include "GGUFMetadata.h"
+#include "GenerationOptions.h"
 
 // -------------------------------------------------------------------------------------
 // Define export/import macros for different platforms
@@ -46,6 +47,15 @@ typedef enum {
     PARAM_UNKNOWN  ///< Unknown or uninitialized parameter type
 } ParamType;
 
+/**
+ * @brief Pooling applied over token embeddings to produce one vector per text.
+ */
+typedef enum {
+    POOLING_MEAN,  ///< Average of all token embeddings
+    POOLING_CLS,   ///< Embedding of the first token
+    POOLING_LAST   ///< Embedding of the last token
+} EmbeddingPooling;
+
 /**
  * @brief Represents a single model parameter, used when configuring the model.
  */
@@ -74,6 +84,43 @@ LlamaEngine_API bool loadModel(const char* backendType,
                                struct ModelParameter* params, size_t paramCount,
                                void (*callback)(const char*) = nullptr);
 
+/**
+ * @brief Callback receiving model load progress.
+ *
+ * @param progress Load progress in the range [0, 1].
+ * @param userData Custom user data pointer.
+ * @return True to continue loading, false to cancel the load.
+ */
+typedef bool (*LoadProgressCallback)(float progress, void* userData);
+
+/**
+ * @brief Loads a model while reporting fractional progress.
+ *
+ * Behaves like loadModel but forwards the llama load progress to `progressCallback`.
+ * It is safe to call from a background thread; the load can be cancelled either by
+ * returning false from the progress callback or by calling cancelLoadModel.
+ *
+ * @param modelPath Path to the model file.
+ * @param params Pointer to an array of model parameters.
+ * @param paramCount Number of parameters in the array.
+ * @param callback Optional callback function for logging messages.
+ * @param progressCallback Optional callback receiving the load progress.
+ * @param userData Custom user data pointer passed to the progress callback.
+ * @return True if the model is successfully loaded, false if it failed or was cancelled.
+ */
+LlamaEngine_API bool loadModelWithProgress(const char* modelPath,
+                                           struct ModelParameter* params, size_t paramCount,
+                                           void (*callback)(const char*),
+                                           LoadProgressCallback progressCallback,
+                                           void* userData);
+
+/**
+ * @brief Requests cancellation of a model load running on another thread.
+ *
+ * Does nothing if no load is in progress.
+ */
+LlamaEngine_API void cancelLoadModel();
+
 /**
  * @brief Creates a new session and returns a session UUID.
  *
@@ -97,6 +144,98 @@ LlamaEngine_API bool clearSession(int sessionId);
  */
 LlamaEngine_API bool deleteSession(int sessionId);
 
+/**
+ * @brief Sets the admission limits of the engine's request queue.
+ *
+ * Requests are served one at a time by priority: interactive, then normal, then
+ * background. A request is rejected immediately, with an error message, when the
+ * queue already holds `maxQueueDepth` waiting requests or when its expected wait
+ * exceeds `maxWaitMs`. The expected wait is estimated from recent service times.
+ * Generation requests are interactive unless the `priority` option says otherwise.
+ * Embeddings and scoring are normal priority, batch jobs run in the background and
+ * pause between decode steps while higher priority requests are waiting.
+ *
+ * @param maxQueueDepth Maximum number of waiting requests, 0 for no limit. Defaults to 64.
+ * @param maxWaitMs Maximum expected wait in milliseconds, 0 for no limit. Defaults to 0.
+ */
+LlamaEngine_API void setRequestQueueLimits(size_t maxQueueDepth, int maxWaitMs);
+
+/**
+ * @brief Enables and bounds the cache of complete responses.
+ *
+ * Deterministic requests are answered from the cache when an identical request
+ * was served before. A request is deterministic when it samples greedily
+ * (`temperature` 0) without repetition penalties. Identical means the same model,
+ * generation options, session history and prompt. A cached response is passed to
+ * the stream callback in one piece, no token is decoded. Responses cut short by
+ * `timeout_ms` or an error are not cached. The cache is disabled by default and
+ * belongs to the loaded model. Limits set before loadModel are kept and apply
+ * once the model is loaded.
+ *
+ * @param maxEntries Maximum number of cached responses, 0 disables the cache.
+ * @param maxBytes Maximum size of the cache in bytes, 0 for no limit.
+ * @param ttlSeconds Lifetime of a cached response in seconds, 0 for no expiry.
+ */
+LlamaEngine_API void setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds);
+
+/**
+ * @brief Loads a LoRA adapter against the loaded base model.
+ *
+ * The base weights are shared, an adapter only adds its own tensors. Loaded
+ * adapters are selected per session with setSessionLoraAdapter or per request
+ * with the `lora` and `lora_scale` generation options.
+ *
+ * @param name Name used to select the adapter, replaces an adapter with the same name.
+ *             Sessions selecting that name keep their scale and use the new adapter.
+ * @param path Path to the adapter GGUF file.
+ * @return True if the adapter was loaded, false otherwise.
+ */
+LlamaEngine_API bool loadLoraAdapter(const char* name, const char* path);
+
+/**
+ * @brief Unloads a LoRA adapter, sessions using it fall back to the base model.
+ * @param name Name of the adapter.
+ * @return True if the adapter was unloaded, false otherwise.
+ */
+LlamaEngine_API bool unloadLoraAdapter(const char* name);
+
+/**
+ * @brief Selects the LoRA adapter used by a session.
+ *
+ * Switching adapters clears the session's KV cache, the history is decoded
+ * again with the new weights on the next request.
+ *
+ * @param sessionId The ID of the session.
+ * @param name Name of a loaded adapter, null or empty for the base model.
+ * @param scale Scale applied to the adapter, 1.0 for full strength.
+ * @return True on success, false if the session or adapter is unknown.
+ */
+LlamaEngine_API bool setSessionLoraAdapter(int sessionId, const char* name, float scale);
+
+/**
+ * @brief Sets the sampler parameters of a session.
+ *
+ * Parameters not passed keep their current value. Only the session's sampler
+ * chain is rebuilt, the context and its KV cache are kept. New sessions start
+ * with the parameters passed to loadModel. Supported parameters, PARAM_FLOAT
+ * or PARAM_INT:
+ * - `temperature`: Randomness of sampling, 0 or less for greedy decoding. Defaults to 0.8.
+ * - `top_k`: Keep the K most probable tokens, 0 to disable. Defaults to 40.
+ * - `top_p`: Nucleus probability mass, 1.0 to disable. Defaults to 1.0.
+ * - `min_p`: Minimum probability relative to the best token, 0 to disable. Defaults to 0.05.
+ * - `repetition_penalty`: Penalty of repeated tokens, 1.0 to disable. Defaults to 1.0.
+ * - `frequency_penalty`: Penalty growing with a token's count, 0 to disable. Defaults to 0.
+ * - `presence_penalty`: Penalty of tokens already present, 0 to disable. Defaults to 0.
+ * - `penalty_last_n`: Number of recent tokens the penalties consider, -1 for the whole context. Defaults to 64.
+ * - `seed`: Seed of the sampler, -1 for a random seed. Defaults to -1.
+ *
+ * @param sessionId The ID of the session.
+ * @param params Array of sampler parameters.
+ * @param paramCount Number of parameters.
+ * @return True on success, false if the session is unknown.
+ */
+LlamaEngine_API bool setSessionSampler(int sessionId, struct ModelParameter* params, size_t paramCount);
+
 /**
  * @brief Generates a response from the model for a given session and prompt.
  *
@@ -121,6 +260,312 @@ LlamaEngine_API bool generateResponse(int sessionId,
                                       void (*finalCallback)(const char*, void* userData),
                                       void* userData);
 
+/**
+ * @brief Generates a response with per request generation options.
+ *
+ * Same as generateResponse, options are passed as key/value parameters and only
+ * apply to this request. Supported options:
+ * - `grammar` (PARAM_STRING): GBNF grammar the output must match.
+ * - `grammar_root` (PARAM_STRING): Start rule of the grammar, defaults to "root".
+ * - `json_schema` (PARAM_STRING): JSON schema the output must match, takes precedence over `grammar`.
+ * - `stop` (PARAM_STRING): Stop string ending the generation, may be repeated. The stop
+ *   string and anything after it is neither streamed nor part of the final response.
+ * - `max_tokens` (PARAM_INT): Maximum number of generated tokens, 0 for no limit.
+ * - `timeout_ms` (PARAM_INT): Wall clock budget of the request in milliseconds, 0 for no limit.
+ * - `lora` (PARAM_STRING): Loaded LoRA adapter used for this request instead of the session's.
+ * - `lora_scale` (PARAM_FLOAT): Scale of the `lora` adapter, defaults to 1.0.
+ * - `priority` (PARAM_STRING): "interactive" (default), "normal" or "background", see setRequestQueueLimits.
+ * - Sampler parameters, see setSessionSampler. They override the session's parameters
+ *   for this request only.
+ *
+ * The final callback receives the response together with the reason generation ended.
+ *
+ * @param sessionId The ID of the session to use for generating the response.
+ * @param prompt Input text for the model to generate a response.
+ * @param options Array of generation options, may be null.
+ * @param optionCount Number of options.
+ * @param streamCallback Function to handle generated response data as it streams.
+ * @param finalCallback Function to handle the final generated response and finish reason.
+ * @param userData Custom user data pointer passed to both callbacks.
+ * @return True if the response was successfully generated, false otherwise,
+ *         including when the grammar or schema is invalid.
+ */
+LlamaEngine_API bool generateResponseWithOptions(int sessionId,
+                                                 const char* prompt,
+                                                 struct ModelParameter* options, size_t optionCount,
+                                                 void (*streamCallback)(const char*, void* userData),
+                                                 void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                                 void* userData);
+
+/**
+ * @brief Starts a generation that the caller pulls chunk by chunk.
+ *
+ * Instead of running to completion inside one call, the generation advances one
+ * chunk per nextChunk call, so a single thread can interleave many generations
+ * with other work. The options are those of generateResponseWithOptions. Each
+ * chunk takes a turn in the request queue with the request's priority, and no
+ * other generation can run on the session until this one has ended.
+ *
+ * @param sessionId The ID of the session to use for generating the response.
+ * @param prompt Input text for the model to generate a response.
+ * @param options Array of generation options, may be null.
+ * @param optionCount Number of options.
+ * @return True if the generation was started, false otherwise.
+ */
+LlamaEngine_API bool startGeneration(int sessionId,
+                                     const char* prompt,
+                                     struct ModelParameter* options, size_t optionCount);
+
+/**
+ * @brief Generates the next chunk of a generation started with startGeneration.
+ *
+ * A chunk is the text released by the next token, usually one token; tokens
+ * withheld as a possible stop string are decoded within the same call. When 0
+ * is returned the response has been added to the session's history. When -2 is
+ * returned the request queue turned the call away, the generation is kept and
+ * the call can be retried or the generation ended with finishGeneration.
+ *
+ * @param sessionId The ID of the session.
+ * @param chunk Receives the chunk text, valid until the next call for the session.
+ * @param reason Optional, receives the finish reason when 0 is returned.
+ * @return 1 if a chunk was generated, 0 if the generation has ended, -1 on error,
+ *         -2 if the request queue rejected the call.
+ */
+LlamaEngine_API int nextChunk(int sessionId, const char** chunk, FinishReason* reason);
+
+/**
+ * @brief Ends a generation before nextChunk has returned 0.
+ *
+ * The text generated so far becomes the session's response with FINISH_CANCELLED.
+ *
+ * @param sessionId The ID of the session.
+ * @return True if a generation was ended, false if none was in progress.
+ */
+LlamaEngine_API bool finishGeneration(int sessionId);
+
+/**
+ * @brief Stops the generation running on a session from another thread.
+ *
+ * Meant for a UI stop button while generateResponse runs on a worker thread.
+ * The call returns at once without waiting for the engine, the generation ends
+ * before its next token and the text generated so far becomes the session's
+ * response with FINISH_CANCELLED. A stop pressed while the request still waits
+ * in the queue applies as soon as it starts. It stops generateResponse, pull
+ * generations and generateResponses; completeInfill runs on no session and is
+ * not affected.
+ *
+ * @param sessionId The ID of the session.
+ * @return True if the session exists, false otherwise.
+ */
+LlamaEngine_API bool cancelGeneration(int sessionId);
+
+/**
+ * @brief Callback receiving one of several completions.
+ * @param index Index of the completion, from 0 to n - 1.
+ * @param response The completion text.
+ * @param reason Reason the completion ended.
+ * @param userData Custom user data pointer.
+ */
+typedef void (*CompletionCallback)(int index, const char* response, FinishReason reason, void* userData);
+
+/**
+ * @brief Generates n alternative responses to one prompt.
+ *
+ * The prompt is prefilled once and forked into n sequences that are decoded
+ * together, which costs about one prefill plus a slightly wider decode instead
+ * of n full generations. Options are the same as for generateResponseWithOptions
+ * and apply to every completion. The first completion is kept as the session's
+ * response and history.
+ *
+ * @param sessionId The ID of the session to use for generating the responses.
+ * @param prompt Input text for the model to generate responses.
+ * @param n Number of completions, at most the `max_sequences` load parameter.
+ * @param options Array of generation options, may be null.
+ * @param optionCount Number of options.
+ * @param finalCallback Called once per completion, in index order.
+ * @param userData Custom user data pointer passed to the callback.
+ * @return True if the responses were successfully generated, false otherwise.
+ */
+LlamaEngine_API bool generateResponses(int sessionId,
+                                       const char* prompt,
+                                       int n,
+                                       struct ModelParameter* options, size_t optionCount,
+                                       CompletionCallback finalCallback,
+                                       void* userData);
+
+/**
+ * @brief Completes the code between a prefix and a suffix (fill-in-the-middle).
+ *
+ * Requires a code model with FIM special tokens, such as Qwen2.5 Coder. The engine
+ * keeps the KV cache of the previous infill request and only decodes the part of
+ * the prompt that changed, so successive requests while typing in the same file
+ * reuse the unchanged beginning of the file. Supports the `max_tokens`,
+ * `timeout_ms`, `stop`, `grammar` and `json_schema` options.
+ *
+ * @param prefix Text before the cursor.
+ * @param suffix Text after the cursor.
+ * @param options Array of generation options, may be null.
+ * @param optionCount Number of options.
+ * @param streamCallback Function to handle the completion as it streams.
+ * @param finalCallback Function to handle the final completion and finish reason.
+ * @param userData Custom user data pointer passed to both callbacks.
+ * @return True if the completion succeeded, false otherwise.
+ */
+LlamaEngine_API bool completeInfill(const char* prefix,
+                                    const char* suffix,
+                                    struct ModelParameter* options, size_t optionCount,
+                                    void (*streamCallback)(const char*, void* userData),
+                                    void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                    void* userData);
+
+/**
+ * @brief Runs a JSONL file of prompts through the loaded model in batch mode.
+ *
+ * Each input line is a JSON object with a `prompt` and optional `id`, `system`,
+ * `max_tokens` and `stop` members. Many prompts are decoded together with
+ * continuous batching and each result is appended to the output JSONL file as
+ * soon as it finishes. The output file doubles as the checkpoint: running the
+ * same job again skips the ids it already contains. Supported options:
+ * - `slots` (PARAM_INT): Number of prompts decoded together, defaults to 8.
+ * - `max_tokens` (PARAM_INT): Token limit of records without `max_tokens`, defaults to 512.
+ * - `context_size` (PARAM_INT): KV cells shared by all slots, defaults to the model context size.
+ * - `resume` (PARAM_INT): 0 to overwrite the output instead of resuming, defaults to 1.
+ *
+ * @param inputPath Path of the input JSONL file.
+ * @param outputPath Path of the output JSONL file.
+ * @param options Array of batch options, may be null.
+ * @param optionCount Number of options.
+ * @param progressCallback Optional, called with the number of records written so far.
+ * @param userData Custom user data pointer passed to the callback.
+ * @return Number of records written by this run, -1 on failure.
+ */
+LlamaEngine_API long processBatchFile(const char* inputPath,
+                                      const char* outputPath,
+                                      struct ModelParameter* options, size_t optionCount,
+                                      void (*progressCallback)(size_t completed, void* userData),
+                                      void* userData);
+
+/**
+ * @brief Computes pooled embeddings for a list of texts with the loaded model.
+ *
+ * All texts are packed as parallel sequences into as few decode batches as possible,
+ * which is much faster than embedding them one at a time. Vectors are written row by
+ * row, text `i` occupies `output[i * size, (i + 1) * size)` where `size` is the value
+ * returned by getEmbeddingSize.
+ *
+ * @param texts Array of input texts.
+ * @param textCount Number of texts in the array.
+ * @param pooling Pooling applied over the token embeddings.
+ * @param normalize When true each vector is L2 normalized.
+ * @param output Caller provided buffer receiving textCount * embedding size floats.
+ * @param outputCapacity Number of floats available in `output`.
+ * @return The embedding size on success, -1 on failure, also when a text produces
+ *         no tokens; the error names the index of that text.
+ */
+LlamaEngine_API int embedTexts(const char** texts, size_t textCount,
+                               EmbeddingPooling pooling, bool normalize,
+                               float* output, size_t outputCapacity);
+
+/**
+ * @brief Tokenizes a text with the loaded model's vocabulary.
+ *
+ * Tokenization only reads the vocabulary, it does not wait for running requests.
+ *
+ * @param text The text to tokenize.
+ * @param addSpecial Add the BOS/EOS tokens the model expects around a text.
+ * @param parseSpecial Parse special token text such as "<|im_start|>" into its token.
+ * @param tokens Buffer receiving at most `capacity` tokens, may be null to count.
+ * @param capacity Number of tokens available in `tokens`.
+ * @return The number of tokens of the text, -1 on failure. When it exceeds `capacity`
+ *         only the first `capacity` tokens are written.
+ */
+LlamaEngine_API int tokenize(const char* text, bool addSpecial, bool parseSpecial, int32_t* tokens, size_t capacity);
+
+/**
+ * @brief Converts tokens back to text.
+ *
+ * @param tokens The tokens.
+ * @param tokenCount Number of tokens.
+ * @param removeSpecial Drop the BOS/EOS tokens added by tokenize.
+ * @param unparseSpecial Render special tokens as their text instead of omitting them.
+ * @param text Buffer receiving the text, null terminated when `capacity` exceeds its length.
+ * @param capacity Number of bytes available in `text`.
+ * @return The length of the text in bytes, -1 on failure. When it is not below `capacity`
+ *         the text is truncated.
+ */
+LlamaEngine_API int detokenize(const int32_t* tokens, size_t tokenCount, bool removeSpecial, bool unparseSpecial,
+                               char* text, size_t capacity);
+
+/**
+ * @brief Callback receiving the result of tokenizeBatch.
+ *
+ * The tokens of text i are tokens[offsets[i]] to tokens[offsets[i + 1] - 1], so
+ * offsets[i + 1] - offsets[i] is its token count. Both buffers are only valid
+ * during the callback.
+ *
+ * @param tokens Tokens of all texts, one after the other.
+ * @param offsets textCount + 1 offsets into `tokens`.
+ * @param textCount Number of texts.
+ * @param userData Custom user data pointer.
+ */
+typedef void (*TokenBatchCallback)(const int32_t* tokens, const size_t* offsets, size_t textCount, void* userData);
+
+/**
+ * @brief Tokenizes many texts in parallel.
+ *
+ * The texts are spread over a pool of worker threads, one per hardware thread,
+ * and the result is delivered as one contiguous token buffer with offsets. A
+ * text that fails to tokenize is reported with no tokens.
+ *
+ * @param texts Array of texts.
+ * @param textCount Number of texts.
+ * @param addSpecial Add the BOS/EOS tokens the model expects around each text.
+ * @param parseSpecial Parse special token text into its token.
+ * @param callback Function receiving the tokens and offsets.
+ * @param userData Custom user data pointer passed to the callback.
+ * @return True on success, false if no model is loaded.
+ */
+LlamaEngine_API bool tokenizeBatch(const char** texts, size_t textCount, bool addSpecial, bool parseSpecial,
+                                   TokenBatchCallback callback, void* userData);
+
+/**
+ * @brief Returns the size of the embedding vectors produced by the loaded model.
+ *
+ * @return The embedding size, or -1 if no model is loaded.
+ */
+LlamaEngine_API int getEmbeddingSize();
+
+/**
+ * @brief Callback receiving the log-probability of a scored candidate token.
+ *
+ * @param candidateIndex Index of the candidate the token belongs to.
+ * @param token Text of the token.
+ * @param logprob Natural log-probability of the token given everything before it.
+ * @param userData Custom user data pointer.
+ */
+typedef void (*TokenScoreCallback)(size_t candidateIndex, const char* token, float logprob, void* userData);
+
+/**
+ * @brief Scores candidate continuations of a shared prefix by log-likelihood.
+ *
+ * The prefix is prefilled once and all candidates are then evaluated as parallel
+ * sequences sharing the prefix KV cells, so scoring K candidates costs roughly one
+ * prefill plus one batched decode. Useful for reranking and classification.
+ *
+ * @param prefix The shared prefix text.
+ * @param candidates Array of candidate continuations.
+ * @param candidateCount Number of candidates in the array.
+ * @param totalLogprobs Caller provided array of candidateCount floats receiving the summed log-probabilities.
+ * @param tokenCallback Optional callback receiving the log-probability of every candidate token.
+ * @param userData Custom user data pointer passed to the token callback.
+ * @return True if scoring succeeded, false otherwise.
+ */
+LlamaEngine_API bool scoreContinuations(const char* prefix,
+                                        const char** candidates, size_t candidateCount,
+                                        float* totalLogprobs,
+                                        TokenScoreCallback tokenCallback,
+                                        void* userData);
+
 LlamaEngine_API const char* getLastResponse(); // Retrieve the latest full response
 
 LlamaEngine_API void getContextInfo(void (*callback)(const char* info, void *userData), void* userData = nullptr); // Retrieve context stats and descriptive info
@@ -128,11 +573,15 @@ LlamaEngine_API void getContextInfo(void (*callback)(const char* info, void *use
 /**
  * @brief Parses a GGUF file and retrieves metadata attributes via a callback.
  *
+ * Only the file header is read through a memory mapping. The callback value
+ * points to a uint32_t, int64_t, double, bool or C string depending on the
+ * type, arrays are reported as a summary string without decoding them.
+ *
  * @param filepath Path to the GGUF file.
  * @param callback Function to process key-value attributes from the file.
  * @param messageCallback Function to handle status messages during parsing.
  * @param user_data Optional user data pointer to be passed to callbacks.
- * @return A dynamically allocated string containing parsed metadata (caller must free).
+ * @return The model name, valid on the calling thread until its next call to parseGGUF.
  */
 typedef void (*GGUFAttributeCallback)(const char* key, GGUFType type, void* value, void* user_data);
 
@@ -140,6 +589,258 @@ LlamaEngine_API char* parseGGUF(const char* filepath,
                                 GGUFAttributeCallback callback,
                                 void (*messageCallback)(const char* message),
                                 void* user_data = nullptr);
+
+/**
+ * @brief Metadata of a model file in a catalogue, see scanModelDirectory.
+ *
+ * The strings are only valid during the callback.
+ */
+typedef struct {
+    const char* path;          ///< Absolute path of the file
+    uint64_t size;             ///< File size in bytes
+    bool valid;                ///< False if the GGUF header could not be read
+    const char* error;         ///< Why the header could not be read, empty when valid
+    const char* name;          ///< general.name, or the file name
+    const char* architecture;  ///< general.architecture
+    int64_t fileType;          ///< general.file_type, the quantization of the weights, -1 if absent
+    int64_t contextLength;     ///< Training context length
+    int64_t embeddingLength;   ///< Width of the hidden state
+    int64_t blockCount;        ///< Number of transformer blocks
+    uint64_t vocabularySize;   ///< Number of tokens
+    uint64_t tensorCount;      ///< Number of tensors
+    uint64_t parameterCount;   ///< Total number of weights
+} ModelCatalogEntry;
+
+typedef void (*ModelCatalogCallback)(const ModelCatalogEntry* entry, void* userData);
+
+/**
+ * @brief Lists the GGUF models of a directory with their metadata.
+ *
+ * Metadata is kept in an index file keyed by path, size and modification time.
+ * Only files that are new or changed since the index was written are opened,
+ * their headers are read in parallel, then the index is updated. A directory of
+ * unchanged models is listed without reading any model file.
+ *
+ * @param directory The models directory, not searched recursively.
+ * @param indexPath Path of the index file, null for ".catalog.json" in the directory.
+ * @param callback Called once per model, sorted by path.
+ * @param userData Custom user data passed to the callback.
+ * @return The number of models, -1 if the directory cannot be listed.
+ */
+LlamaEngine_API int scanModelDirectory(const char* directory, const char* indexPath,
+                                       ModelCatalogCallback callback, void* userData);
+
+/**
+ * @brief Predicted memory of a model configuration, see estimateModelMemory.
+ */
+typedef struct {
+    uint64_t weightBytes;      ///< Model weights, shared by all sessions
+    uint64_t kvCacheBytes;     ///< KV cache of all sessions
+    uint64_t computeBytes;     ///< Compute and output buffers of all sessions
+    uint64_t totalBytes;       ///< Sum of the above
+    int contextSize;           ///< Context size of each session
+    int sessionCount;          ///< Number of sessions
+    int trainedContextLength;  ///< Context length the model was trained with, 0 if unknown
+} ModelMemoryEstimate;
+
+/**
+ * @brief Predicts the memory a model needs without loading it.
+ *
+ * Weight, KV cache and compute buffer sizes are derived from the tensor infos
+ * and hyperparameters in the GGUF header for the contexts loadModel creates.
+ * Pass 0 as the context size to get the largest context fitting the budget,
+ * or 0 as the session count to get the largest number of sessions. The same
+ * estimate picks the context size when loadModel gets a context_size of 0.
+ *
+ * @param modelPath Path to the GGUF file.
+ * @param contextSize Context size of each session, 0 to pick the largest that fits.
+ * @param sessionCount Number of sessions, 0 to pick the largest that fits.
+ * @param memoryBudgetMb Memory available in MB, 0 for the physical memory of the machine.
+ * @param estimate Receives the estimate, filled whenever the file can be read, also
+ *                 when the configuration does not fit; zeroed otherwise.
+ * @return True if the configuration fits the budget, false if it does not, nothing fits or
+ *         the file cannot be read.
+ */
+LlamaEngine_API bool estimateModelMemory(const char* modelPath, int contextSize, int sessionCount,
+                                         int memoryBudgetMb, ModelMemoryEstimate* estimate);
+
+/**
+ * @brief Digest computed by verifyModelFile.
+ */
+typedef enum {
+    DIGEST_NONE,           ///< No digest, only the tensor check runs
+    DIGEST_SHA256,         ///< SHA-256 of the whole file, as published on Hugging Face
+    DIGEST_CHUNKED_SHA256  ///< SHA-256 over the SHA-256 of each 64 MB chunk, computed on every core
+} DigestType;
+
+/**
+ * @brief Outcome of verifyModelFile.
+ */
+typedef struct {
+    char digest[65];  ///< Hex digest of the file, empty with DIGEST_NONE
+    char error[256];  ///< Why the verification failed, empty on success
+} ModelVerification;
+
+/**
+ * @brief Checks that a model file is complete and intact.
+ *
+ * The tensor check reads only the GGUF header and verifies that every tensor
+ * has a known type, is aligned and lies inside the file without overlapping
+ * another one, which catches truncated downloads at once. The digest hashes
+ * the whole file. A plain SHA-256 is sequential, reading overlaps hashing;
+ * the chunked digest hashes 64 MB chunks in parallel and is much faster on
+ * many cores, but differs from a plain SHA-256 and can only be compared with
+ * a chunked digest recorded earlier.
+ *
+ * @param modelPath Path to the GGUF file.
+ * @param digestType The digest to compute, DIGEST_NONE to skip hashing.
+ * @param expectedDigest Hex digest the file must match, case and whitespace ignored,
+ *                       null or empty to only compute it.
+ * @param checkTensors Run the tensor check before hashing.
+ * @param progressCallback Optional callback receiving the fraction hashed, called from the
+ *                         hashing threads one call at a time; return false to cancel.
+ * @param userData Custom user data pointer passed to the progress callback.
+ * @param result Receives the hex digest and the reason of a failure, may be null.
+ * @return True if every requested check passed, false on a failed tensor check, a digest
+ *         mismatch, a read error or a cancellation.
+ */
+LlamaEngine_API bool verifyModelFile(const char* modelPath, DigestType digestType, const char* expectedDigest,
+                                     bool checkTensors, LoadProgressCallback progressCallback, void* userData,
+                                     ModelVerification* result);
+
+// -------------------------------------------------------------------------------------
+// Engine instances
+//
+// Every function above runs on a default engine. An engine owns a model, its
+// sessions, its request queue and its response cache, so several models can be
+// served side by side in one process by creating one engine per model. The
+// functions below take the engine as their first argument and otherwise behave
+// exactly like the function of the same name without the engine prefix.
+// -------------------------------------------------------------------------------------
+
+/**
+ * @brief Opaque handle to an engine instance.
+ */
+typedef struct LlamaEngineInstance* LlamaEngineHandle;
+
+/**
+ * @brief Creates an engine instance without a model.
+ *
+ * @return The new engine, destroy it with engineDestroy.
+ */
+LlamaEngine_API LlamaEngineHandle engineCreate();
+
+/**
+ * @brief Destroys an engine with its model and sessions.
+ *
+ * No call may be in progress on the engine. Destroying the default engine is ignored.
+ *
+ * @param engine The engine to destroy.
+ */
+LlamaEngine_API void engineDestroy(LlamaEngineHandle engine);
+
+/**
+ * @brief Returns the engine used by the functions without an engine argument.
+ */
+LlamaEngine_API LlamaEngineHandle engineDefault();
+
+LlamaEngine_API bool engineLoadModel(LlamaEngineHandle engine, const char* modelPath,
+                                     struct ModelParameter* params, size_t paramCount,
+                                     void (*callback)(const char*));
+
+LlamaEngine_API bool engineLoadModelWithProgress(LlamaEngineHandle engine, const char* modelPath,
+                                                 struct ModelParameter* params, size_t paramCount,
+                                                 void (*callback)(const char*),
+                                                 LoadProgressCallback progressCallback,
+                                                 void* userData);
+
+LlamaEngine_API void engineCancelLoadModel(LlamaEngineHandle engine);
+
+LlamaEngine_API bool engineCreateSession(LlamaEngineHandle engine, int sessionId);
+
+LlamaEngine_API bool engineClearSession(LlamaEngineHandle engine, int sessionId);
+
+LlamaEngine_API bool engineDeleteSession(LlamaEngineHandle engine, int sessionId);
+
+LlamaEngine_API bool engineGenerateResponse(LlamaEngineHandle engine, int sessionID,
+                                            const char* prompt,
+                                            void (*streamCallback)(const char*, void* userData),
+                                            void (*finalCallback)(const char*, void* userData),
+                                            void* userData);
+
+LlamaEngine_API void engineSetRequestQueueLimits(LlamaEngineHandle engine, size_t maxQueueDepth, int maxWaitMs);
+
+LlamaEngine_API void engineSetResponseCacheLimits(LlamaEngineHandle engine, size_t maxEntries, size_t maxBytes, int ttlSeconds);
+
+LlamaEngine_API bool engineLoadLoraAdapter(LlamaEngineHandle engine, const char* name, const char* path);
+
+LlamaEngine_API bool engineUnloadLoraAdapter(LlamaEngineHandle engine, const char* name);
+
+LlamaEngine_API bool engineSetSessionLoraAdapter(LlamaEngineHandle engine, int sessionId, const char* name, float scale);
+
+LlamaEngine_API bool engineSetSessionSampler(LlamaEngineHandle engine, int sessionId, struct ModelParameter* params, size_t paramCount);
+
+LlamaEngine_API bool engineGenerateResponseWithOptions(LlamaEngineHandle engine, int sessionID,
+                                                       const char* prompt,
+                                                       struct ModelParameter* options, size_t optionCount,
+                                                       void (*streamCallback)(const char*, void* userData),
+                                                       void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                                       void* userData);
+
+LlamaEngine_API bool engineStartGeneration(LlamaEngineHandle engine, int sessionID,
+                                           const char* prompt,
+                                           struct ModelParameter* options, size_t optionCount);
+
+LlamaEngine_API int engineNextChunk(LlamaEngineHandle engine, int sessionID, const char** chunk, FinishReason* reason);
+
+LlamaEngine_API bool engineFinishGeneration(LlamaEngineHandle engine, int sessionID);
+
+LlamaEngine_API bool engineCancelGeneration(LlamaEngineHandle engine, int sessionID);
+
+LlamaEngine_API bool engineGenerateResponses(LlamaEngineHandle engine, int sessionID,
+                                             const char* prompt,
+                                             int n,
+                                             struct ModelParameter* options, size_t optionCount,
+                                             CompletionCallback finalCallback,
+                                             void* userData);
+
+LlamaEngine_API bool engineCompleteInfill(LlamaEngineHandle engine, const char* prefix,
+                                          const char* suffix,
+                                          struct ModelParameter* options, size_t optionCount,
+                                          void (*streamCallback)(const char*, void* userData),
+                                          void (*finalCallback)(const char*, FinishReason reason, void* userData),
+                                          void* userData);
+
+LlamaEngine_API long engineProcessBatchFile(LlamaEngineHandle engine, const char* inputPath,
+                                            const char* outputPath,
+                                            struct ModelParameter* options, size_t optionCount,
+                                            void (*progressCallback)(size_t completed, void* userData),
+                                            void* userData);
+
+LlamaEngine_API int engineEmbedTexts(LlamaEngineHandle engine, const char** texts, size_t textCount,
+                                     EmbeddingPooling pooling, bool normalize,
+                                     float* output, size_t outputCapacity);
+
+LlamaEngine_API int engineTokenize(LlamaEngineHandle engine, const char* text, bool addSpecial, bool parseSpecial, int32_t* tokens, size_t capacity);
+
+LlamaEngine_API int engineDetokenize(LlamaEngineHandle engine, const int32_t* tokens, size_t tokenCount, bool removeSpecial, bool unparseSpecial,
+                                     char* text, size_t capacity);
+
+LlamaEngine_API bool engineTokenizeBatch(LlamaEngineHandle engine, const char** texts, size_t textCount, bool addSpecial, bool parseSpecial,
+                                         TokenBatchCallback callback, void* userData);
+
+LlamaEngine_API int engineGetEmbeddingSize(LlamaEngineHandle engine);
+
+LlamaEngine_API bool engineScoreContinuations(LlamaEngineHandle engine, const char* prefix,
+                                              const char** candidates, size_t candidateCount,
+                                              float* totalLogprobs,
+                                              TokenScoreCallback tokenCallback,
+                                              void* userData);
+
+LlamaEngine_API const char* engineGetLastResponse(LlamaEngineHandle engine);
+
+LlamaEngine_API void engineGetContextInfo(LlamaEngineHandle engine, void (*callback)(const char* info, void* userData), void* userData = nullptr);
+
 }
 
 #endif // LlamaEngine_h
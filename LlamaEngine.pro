@@ -42,6 +42,9 @@ SOURCES += LlamaEngine.cpp LlamaRuntime.cpp
 HEADERS += LlamaEngine.h LlamaRuntime.h
 HEADERS += LlamaSession.h PromptResponse.h
 
+SOURCES += JsonValue.cpp JsonSchemaGrammar.cpp BatchProcessor.cpp RequestQueue.cpp SamplerKernels.cpp ResponseCache.cpp GGUFReader.cpp ModelCatalog.cpp MemoryEstimator.cpp Sha256.cpp ModelVerifier.cpp
+HEADERS += JsonValue.h JsonSchemaGrammar.h GenerationOptions.h StopSequenceMatcher.h BatchProcessor.h RequestQueue.h SamplerKernels.h ThreadPool.h ResponseCache.h GenerationStream.h GGUFReader.h ModelCatalog.h MemoryEstimator.h Sha256.h ModelVerifier.h
+
 # macOS-specific settings
 mac {
 
@@ -1,19 +1,89 @@
 #include "LlamaRuntime.h"
 #include "LlamaSession.h"
+#include "JsonSchemaGrammar.h"
+#include "StopSequenceMatcher.h"
+#include "SamplerKernels.h"
+#include "ThreadPool.h"
+#include "MemoryEstimator.h"
+#include "GenerationStream.h"
+#include "GGUFReader.h"
 
 #include <sstream>
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 // define windows stubs
 #ifdef WIN32
 #define strdup _strdup
 #endif
 
+// llama.cpp has a single process wide log callback. Runtimes that loaded a model
+// are kept here so the callback never reaches a destroyed one, messages go to the
+// runtime loading on the calling thread, otherwise to the latest loaded runtime.
+static std::mutex liveRuntimesMutex;
+static std::vector<LlamaRuntime*> liveRuntimes;
+static thread_local LlamaRuntime *loadingRuntime = nullptr;
+static std::once_flag backendOnce;
+
+static void forwardLlamaLog(enum ggml_log_level level, const char *text, void *) {
+    {
+        std::lock_guard<std::mutex> lock(liveRuntimesMutex);
+        LlamaRuntime *target = loadingRuntime;
+        if (!target && !liveRuntimes.empty())
+            target = liveRuntimes.back();
+        if (target)
+            target->logMessage(text);
+    }
+
+    if (level >= GGML_LOG_LEVEL_ERROR) {
+        fprintf(stderr, "%s", text);
+    }
+}
+
 // Constructor initializes pointers to null
 LlamaRuntime::LlamaRuntime() : model(nullptr) {}
 
 // Destructor ensures proper resource cleanup
 LlamaRuntime::~LlamaRuntime() {
+    {
+        std::lock_guard<std::mutex> lock(liveRuntimesMutex);
+        liveRuntimes.erase(std::remove(liveRuntimes.begin(), liveRuntimes.end(), this), liveRuntimes.end());
+    }
+
+    if (embeddingCtx) {
+        llama_free(embeddingCtx);
+        embeddingCtx = nullptr;
+    }
+
+    if (scoringCtx) {
+        llama_free(scoringCtx);
+        scoringCtx = nullptr;
+    }
+
+    if (fimCtx) {
+        llama_free(fimCtx);
+        fimCtx = nullptr;
+    }
 
+    for (auto& [key, grammar] : grammarCache)
+        llama_sampler_free(grammar);
+    grammarCache.clear();
+
+    // Adapters reference the base model and are released first
+    for (auto& [name, adapter] : loraAdapters)
+        llama_adapter_lora_free(adapter);
+    loraAdapters.clear();
 
     if (model) {
         llama_model_free(model);
@@ -25,6 +95,7 @@ LlamaRuntime::~LlamaRuntime() {
         free(const_cast<char *>(msg.content));
     }
 */
+    std::lock_guard<std::mutex> lock(sessionsMutex);
     for (auto& [sessionId, session] : sessions) {
         delete session;
     }
@@ -40,6 +111,7 @@ bool LlamaRuntime::createSession(int session_id) {
     llama_context_params ctx_params = llama_context_default_params();
     ctx_params.n_ctx = context_size;
     ctx_params.n_batch = context_size;
+    ctx_params.n_seq_max = maxSequences;
 
     LlamaSession* new_session = new LlamaSession(std::to_string(session_id), nullptr, nullptr);
     new_session->ctx = llama_new_context_with_model(model, ctx_params);
@@ -50,12 +122,13 @@ bool LlamaRuntime::createSession(int session_id) {
         return false;
     }
 
-    new_session->smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
-    llama_sampler_chain_add(new_session->smpl, llama_sampler_init_min_p(0.05f, 1));
-    llama_sampler_chain_add(new_session->smpl, llama_sampler_init_temp(temperature));
-    llama_sampler_chain_add(new_session->smpl, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+    new_session->sampler = samplerSettings;
+    new_session->smpl = createSamplerChain(new_session->sampler);
 
-    sessions[session_id] = new_session;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions[session_id] = new_session;
+    }
     logInfo("Created session: " + std::to_string(session_id));
     return true;
 }
@@ -80,6 +153,7 @@ bool LlamaRuntime::deleteSession(int session_id) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(sessionsMutex);
     delete it->second;
     sessions.erase(it);
     logInfo("Deleted session: " + std::to_string(session_id));
@@ -88,41 +162,84 @@ bool LlamaRuntime::deleteSession(int session_id) {
 
 // Public method to load the model with default parameters
 bool LlamaRuntime::loadModel() {
-    return loadModelInternal(modelPath, 99, context_size);
+    return loadModelInternal(modelPath, gpuLayers, context_size);
 }
 
 // Internal method to load the model with custom parameters
 bool LlamaRuntime::loadModelInternal(const std::string &modelPath, int ngl, int n_ctx) {
-    context_size = n_ctx;
     error_.clear();
 
+    // Size the context from the GGUF header before anything is allocated
+    if (!fitMemoryBudget(modelPath, n_ctx))
+        return false;
+    context_size = n_ctx;
+
     logMessage("Loading Model context(" + std::to_string(n_ctx) + "): " + modelPath);
 
-    // Set up logging callback
-    llama_log_set([](enum ggml_log_level level, const char *text, void *thisContext) {
+    // Set up logging callback and load dynamic backends, once for every engine in the process
+    std::call_once(backendOnce, []() {
+        llama_log_set(forwardLlamaLog, nullptr);
+        ggml_backend_load_all();
+    });
 
-        ((LlamaRuntime*)thisContext)->logMessage(text);
+    {
+        std::lock_guard<std::mutex> lock(liveRuntimesMutex);
+        if (std::find(liveRuntimes.begin(), liveRuntimes.end(), this) == liveRuntimes.end())
+            liveRuntimes.push_back(this);
+    }
 
-        if (level >= GGML_LOG_LEVEL_ERROR) {
-            fprintf(stderr, "%s", text);
-        }
-    }, this);
+    // llama.cpp logs of this load go to this runtime even while another engine is loading
+    struct LoadingScope {
+        explicit LoadingScope(LlamaRuntime *runtime) { loadingRuntime = runtime; }
+        ~LoadingScope() { loadingRuntime = nullptr; }
+    } loadingScope(this);
 
-    // Load dynamic backends
-    ggml_backend_load_all();
+    // Pull the model file into the page cache before llama maps it
+    if (readahead && !readaheadFile(modelPath))
+        logWarning("Readahead failed for model file: " + modelPath);
 
     // Initialize the model parameters
     llama_model_params model_params = llama_model_default_params();
     model_params.n_gpu_layers = ngl;
+    model_params.use_mmap = useMmap;
+    model_params.use_mlock = useMlock;
+
+    // Report progress and stop the load as soon as a cancellation is requested
+    model_params.progress_callback = [](float progress, void *thisContext) -> bool {
+        LlamaRuntime *runtime = (LlamaRuntime*)thisContext;
+        if (runtime->loadCancelled)
+            return false;
+        if (runtime->loadProgressCallback && !runtime->loadProgressCallback(progress))
+            runtime->loadCancelled = true;
+        return !runtime->loadCancelled;
+    };
+    model_params.progress_callback_user_data = this;
+
+    logInfo(std::string("Model load options: mmap=") + (useMmap ? "on" : "off") +
+            ", mlock=" + (useMlock ? "on" : "off") +
+            ", gpu layers=" + std::to_string(ngl));
 
     // Load the model
     model = llama_load_model_from_file(modelPath.c_str(), model_params);
     if (!model) {
+        if (loadCancelled) {
+            logInfo("Model load cancelled");
+            error_ = "Model load cancelled";
+            return false;
+        }
         logError("Failed to load model");
         error_ = "Failed to load model file";
         return false;
     }
 
+    if (loadCancelled) {
+        logInfo("Model load cancelled");
+        error_ = "Model load cancelled";
+        llama_model_free(model);
+        model = nullptr;
+        return false;
+    }
+
     // Get the model vocabulary
     vocab = llama_model_get_vocab(model);
 
@@ -130,10 +247,12 @@ bool LlamaRuntime::loadModelInternal(const std::string &modelPath, int ngl, int
     llama_context_params ctx_params = llama_context_default_params();
     ctx_params.n_ctx = n_ctx;
     ctx_params.n_batch = n_ctx;
+    ctx_params.n_seq_max = maxSequences;
 
     // Check if a session already exists, create a default one if there is none
     if(sessions.empty())
     {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
         sessions[0] = new LlamaSession("0", nullptr, nullptr);
 
     }
@@ -146,6 +265,7 @@ bool LlamaRuntime::loadModelInternal(const std::string &modelPath, int ngl, int
         // clear (free) pre existing sampler and context in session
         session->clearSampler();
         session->clearContext();
+        session->appliedLoraAdapter.clear();
 
         // Create new context for the session with the new model
         session->ctx = llama_new_context_with_model(model, ctx_params);
@@ -159,16 +279,129 @@ bool LlamaRuntime::loadModelInternal(const std::string &modelPath, int ngl, int
         logMessage("Maximum context size: " + std::to_string(llama_n_ctx(session->ctx)));
 
         // Initialize the sampler for the new model
-        session->smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
-        llama_sampler_chain_add(session->smpl, llama_sampler_init_min_p(0.05f, 1));
-        llama_sampler_chain_add(session->smpl, llama_sampler_init_temp(temperature));
-        llama_sampler_chain_add(session->smpl, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+        session->smpl = createSamplerChain(session->sampler);
 
         // Resize formatted buffer for context size
         /*session->formatted.resize(n_ctx);*/
     }
 
+    // Weights and backend kernels are shared by all contexts, warming one is enough
+    if (warmup && !warmupContext(sessions.begin()->second->ctx))
+        logWarning("Warmup decode failed");
+
+    return true;
+}
+
+// Pick the context size when it is automatic (0) and refuse settings the budget cannot hold
+bool LlamaRuntime::fitMemoryBudget(const std::string &modelPath, int &n_ctx) {
+    if (n_ctx > 0 && memoryBudgetMb == 0)
+        return true;
+
+    MemoryEstimator estimator;
+    if (!estimator.open(modelPath)) {
+        logError("Cannot estimate model memory: " + estimator.error());
+        error_ = "Failed to read model file header";
+        return false;
+    }
+
+    const uint64_t budget = memoryBudgetMb > 0 ? (uint64_t)memoryBudgetMb * 1024 * 1024 : MemoryEstimator::physicalMemory();
+    const int sessionCount = std::max(expectedSessions, (int)sessions.size());
+    const std::string budgetText = std::to_string(budget / (1024 * 1024)) + " MB";
+
+    if (n_ctx <= 0) {
+        n_ctx = estimator.fitContextSize(budget, sessionCount, maxSequences);
+        if (n_ctx <= 0) {
+            logError("Model does not fit the memory budget of " + budgetText);
+            error_ = "Model does not fit the memory budget";
+            return false;
+        }
+        logInfo("Automatic context size " + std::to_string(n_ctx) + " for " + std::to_string(sessionCount) +
+                " sessions within " + budgetText);
+    }
+
+    MemoryEstimator::Estimate estimate = estimator.estimate(n_ctx, sessionCount, maxSequences);
+    logInfo("Estimated memory: weights " + std::to_string(estimate.weightBytes / (1024 * 1024)) +
+            " MB, KV cache " + std::to_string(estimate.kvCacheBytes / (1024 * 1024)) +
+            " MB, compute " + std::to_string(estimate.computeBytes / (1024 * 1024)) + " MB");
+
+    if (estimate.totalBytes > budget) {
+        logError("Context size " + std::to_string(n_ctx) + " needs " + std::to_string(estimate.totalBytes / (1024 * 1024)) +
+                 " MB, more than the memory budget of " + budgetText);
+        error_ = "Model does not fit the memory budget";
+        return false;
+    }
+    return true;
+}
+
+// Issue a readahead of the whole file so the load does not page fault it in piece by piece
+bool LlamaRuntime::readaheadFile(const std::string &path) {
+#ifdef _WIN32
+    // No portable advisory call, stream the file once with large reads instead
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::vector<char> buffer(8 * 1024 * 1024);
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+    }
     return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    bool success = true;
+#ifdef __APPLE__
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        // F_RDADVISE takes an int count, issue the advice in chunks
+        off_t offset = 0;
+        while (offset < st.st_size) {
+            struct radvisory advice;
+            advice.ra_offset = offset;
+            advice.ra_count = (int)std::min<off_t>(st.st_size - offset, INT_MAX);
+            if (fcntl(fd, F_RDADVISE, &advice) == -1) {
+                success = false;
+                break;
+            }
+            offset += advice.ra_count;
+        }
+    } else {
+        success = false;
+    }
+#elif defined(POSIX_FADV_WILLNEED)
+    success = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+#endif
+    close(fd);
+    return success;
+#endif
+}
+
+// Decode a couple of tokens so weights are faulted in and backend kernels are initialised
+bool LlamaRuntime::warmupContext(llama_context *ctx) {
+    if (!ctx || !vocab)
+        return false;
+
+    logInfo("Warming up model");
+
+    std::vector<llama_token> tokens;
+    llama_token bos = llama_vocab_bos(vocab);
+    llama_token eos = llama_vocab_eos(vocab);
+    if (bos != LLAMA_TOKEN_NULL)
+        tokens.push_back(bos);
+    if (eos != LLAMA_TOKEN_NULL)
+        tokens.push_back(eos);
+    if (tokens.empty())
+        tokens.push_back(0);
+
+    bool success = llama_decode(ctx, llama_batch_get_one(tokens.data(), tokens.size())) == 0;
+
+    // Leave the context as if nothing had been decoded
+    llama_kv_cache_clear(ctx);
+    llama_synchronize(ctx);
+    llama_perf_context_reset(ctx);
+
+    return success;
 }
 
 // Setter for model path
@@ -183,22 +416,80 @@ void LlamaRuntime::setContextSize(int size) {
 
 // Setter for temperature parameter
 void LlamaRuntime::setTemperature(float temp) {
-    temperature = temp;
+    samplerSettings.temperature = temp;
 }
 
 // Setter for top-K sampling
 void LlamaRuntime::setTopK(float k) {
-    topK = k;
+    samplerSettings.topK = (int)k;
 }
 
 // Setter for top-P sampling
 void LlamaRuntime::setTopP(float p) {
-    topP = p;
+    samplerSettings.topP = p;
 }
 
 // Setter for repetition penalty
 void LlamaRuntime::setRepetitionPenalty(float penalty) {
-    repetitionPenalty = penalty;
+    samplerSettings.repetitionPenalty = penalty;
+}
+
+// Setter for any sampler parameter by name
+bool LlamaRuntime::setSamplerParameter(const std::string &key, double value) {
+    return samplerSettings.set(key, value);
+}
+
+// Setter for the number of GPU offloaded layers
+void LlamaRuntime::setGpuLayers(int layers) {
+    gpuLayers = layers;
+}
+
+// Setter for memory mapping the model file
+void LlamaRuntime::setUseMmap(bool enable) {
+    useMmap = enable;
+}
+
+// Setter for locking the model weights in RAM
+void LlamaRuntime::setUseMlock(bool enable) {
+    useMlock = enable;
+}
+
+// Setter for the model file readahead
+void LlamaRuntime::setReadahead(bool enable) {
+    readahead = enable;
+}
+
+// Setter for the warmup decode after loading
+void LlamaRuntime::setWarmup(bool enable) {
+    warmup = enable;
+}
+
+void LlamaRuntime::setMaxSequences(int count) {
+    maxSequences = std::max(count, 1);
+}
+
+// Setter for the memory budget checked before loading
+void LlamaRuntime::setMemoryBudget(int megabytes) {
+    memoryBudgetMb = std::max(megabytes, 0);
+}
+
+// Setter for the session count the automatic context size is sized for
+void LlamaRuntime::setExpectedSessions(int count) {
+    expectedSessions = std::max(count, 1);
+}
+
+// Setter for load progress callback function
+void LlamaRuntime::setLoadProgressCallback(LoadProgressCallback callback) {
+    loadProgressCallback = callback;
+}
+
+// Request cancellation of an ongoing load, safe to call from any thread
+void LlamaRuntime::cancelLoad() {
+    loadCancelled = true;
+}
+
+bool LlamaRuntime::isLoadCancelled() const {
+    return loadCancelled;
 }
 
 // Setter for log callback function
@@ -261,6 +552,19 @@ LlamaSession *LlamaRuntime::getSession(int session_id){
  * @return True if successful, false otherwise.
  */
 bool LlamaRuntime::generateResponse(int session_id, const std::string &input_prompt, void (*callback)(const char*, void *userData), void *userData) {
+    return generateResponse(session_id, input_prompt, GenerationOptions(), callback, userData);
+}
+
+/**
+ * @brief Generates a response using the given session and per request options.
+ * @param session_id The session identifier.
+ * @param input_prompt The input text prompt.
+ * @param options Options applied to this request.
+ * @param callback Function to handle generated response chunks.
+ * @param userData Custom user data for the callback.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaRuntime::generateResponse(int session_id, const std::string &input_prompt, const GenerationOptions &options, void (*callback)(const char*, void *userData), void *userData) {
 
     LlamaSession *session = getSession(session_id);
     if (session == nullptr) {
@@ -288,34 +592,41 @@ bool LlamaRuntime::generateResponse(int session_id, const std::string &input_pro
     // Log current chat history size
     logDebug("Messages in history: " + std::to_string(session->messages.size())+ "\n");
 
-    // add the user input to the message list and format it
-    session->messages.push_back({"user", strdup(input_prompt.c_str())});
+    if (!checkIdle(session))
+        return false;
 
-    int new_len = llama_chat_apply_template(llama_model_chat_template(model, nullptr), session->messages.data(), session->messages.size(), true, session->formatted.data(), session->formatted.size());
-    if (new_len > session->formatted.size()) {
-        session->formatted.resize(new_len);
-        new_len = llama_chat_apply_template(llama_model_chat_template(model, nullptr), session->messages.data(), session->messages.size(), true, session->formatted.data(), session->formatted.size());
-    }
-    if (new_len < 0) {
-        error_ = "Error: failed to apply the chat template";
-        logError(error_);
+    if (!applySessionLoraAdapter(session, options))
         return false;
-    }
 
-    // remove previous messages to obtain the prompt to generate the response
-    std::string prompt(session->formatted.begin(), session->formatted.begin() + new_len);
+    std::string prompt;
+    if (!applyChatTemplate(session, input_prompt, prompt))
+        return false;
 
     // Log tokenized prompt
     logDebug("Tokenized prompt: " + prompt+ "\n");
 
-    // generate a response
-    if (!generate(session, prompt, callback, userData))
-    {
-        return false;
+    const std::string cacheKey = responseCacheKey(session, options, prompt);
+    if (!cacheKey.empty() && responseCache.lookup(cacheKey, session->response, session->finishReason)) {
+        logDebug("Response cache hit\n");
+        if (callback && !session->response.empty())
+            callback(session->response.c_str(), userData);
+
+        // Decoded ahead of the next prompt so the KV cache catches up with the history
+        session->pendingPrefill += prompt + session->response;
     }
+    else {
+        const std::string pending = std::move(session->pendingPrefill);
+        session->pendingPrefill.clear();
 
-    // add the response to the messages, this is the history context used to provide llm with context in future prompts
-    session->messages.push_back({"assistant", strdup(session->response.c_str())});
+        // generate a response
+        if (!generate(session, pending + prompt, options, callback, userData))
+        {
+            return false;
+        }
+
+        storeResponse(session, cacheKey);
+    }
+    addResponseToHistory(session, prompt);
 
     /*
     int prev_len = llama_chat_apply_template(llama_model_chat_template(model, nullptr), messages.data(), messages.size(), false, nullptr, 0);
@@ -329,229 +640,1617 @@ bool LlamaRuntime::generateResponse(int session_id, const std::string &input_pro
     return true;
 }
 
-bool isValidUtf8(const std::string& str) {
-    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str.c_str());
-    int num = 0;
-    for (size_t i = 0; i < str.size(); i++) {
-        if (num == 0) {
-            if ((bytes[i] & 0x80) == 0) continue;  // ASCII (0xxxxxxx)
-            else if ((bytes[i] & 0xE0) == 0xC0) num = 1; // 2-byte (110xxxxx)
-            else if ((bytes[i] & 0xF0) == 0xE0) num = 2; // 3-byte (1110xxxx)
-            else if ((bytes[i] & 0xF8) == 0xF0) num = 3; // 4-byte (11110xxx)
-            else return false;  // Invalid first byte
-        } else {
-            if ((bytes[i] & 0xC0) != 0x80) return false; // Not a valid continuation byte
-            num--;
-        }
-    }
-    return num == 0;
+void LlamaRuntime::storeResponse(LlamaSession *session, const std::string &cacheKey) {
+    // Deadlines, cancellations and errors depend on more than the key
+    FinishReason reason = session->finishReason;
+    if (!cacheKey.empty() && (reason == FINISH_EOG || reason == FINISH_STOP_SEQUENCE || reason == FINISH_MAX_TOKENS))
+        responseCache.store(cacheKey, session->response, reason);
 }
 
-/**
- * This function executes the actual text generation using a given llama_context
- * and sampler. The response is processed and streamed via the callback.
- *
- * @param session The session for which the response is to be generated.
- * @param prompt The prompt string to generate a response for.
- * @param options Additional options for the generation process.
- * @param callback A callback function to be invoked for each generated token.
- * @param userData User data to be passed to the callback function.
- * @return True if the generation is successful, otherwise false.
- *
- * Implementation Details:
- * - The function uses a loop to generate tokens until the context is full or the generation is complete.
- * - It checks the context size and breaks the loop if the context is exceeded.
- * - Each generated token is processed and added to the session's response.
- * - The function uses a callback to stream the generated tokens.
- * - The `token_count` variable is used to prevent infinite looping.
- */
-bool LlamaRuntime::generate(LlamaSession *session, const std::string &prompt, void (*callback)(const char*, void *), void *userData) {
+void LlamaRuntime::addResponseToHistory(LlamaSession *session, const std::string &prompt) {
+    session->contextHash = ResponseCache::hash(prompt + session->response, session->contextHash);
 
-    if(!session) {
-        error_ = "Error: Generate, session is null";
+    // add the response to the messages, this is the history context used to provide llm with context in future prompts
+    session->messages.push_back({"assistant", strdup(session->response.c_str())});
+}
+
+bool LlamaRuntime::startGeneration(int session_id, const std::string &input_prompt, const GenerationOptions &options) {
+
+    LlamaSession *session = getSession(session_id);
+    if (session == nullptr) {
+        error_ = "Error: Session is invalid.";
         logError(error_);
         return false;
     }
 
-    session->response.clear(); // TODO move to LlamaSession
-    llama_context* ctx = session->ctx;
-    llama_sampler *smpl = session->smpl;
-
-    const bool is_first = llama_get_kv_cache_used_cells(ctx) == 0;
-
-    std::vector<llama_token> prompt_tokens = tokenizePrompt(prompt, is_first);
-    if (prompt_tokens.empty()) {
-        error_ = "Error: Failed to tokenize the prompt";
+    if (!session->ctx || !model || !vocab) {
+        error_ = "Error: Model not loaded.";
         logError(error_);
         return false;
     }
 
-    logDebug("Total tokens in prompt: " + std::to_string(prompt_tokens.size())+ "\n");
+    if (!checkIdle(session))
+        return false;
 
-    llama_batch batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
-    llama_token new_token_id;
+    if (!applySessionLoraAdapter(session, options))
+        return false;
 
-    long token_count = 0;
-    while (true) {
-        int n_ctx_total = llama_n_ctx(ctx);
-        int n_ctx_used = llama_get_kv_cache_used_cells(ctx);
+    std::string prompt;
+    if (!applyChatTemplate(session, input_prompt, prompt))
+        return false;
 
-        //logDebug("KV Cache before decoding: " + std::to_string(n_ctx_used) + " / " + std::to_string(n_ctx_total)+ "\n");
+    auto stream = std::make_unique<GenerationStream>();
+    stream->cacheKey = responseCacheKey(session, options, prompt);
 
-        if (n_ctx_used + batch.n_tokens > n_ctx_total) {
-            logError("Context size exceeded! Used: " + std::to_string(n_ctx_used) + ", Limit: " + std::to_string(n_ctx_total)+ "\n");
-            break;
-            //return false;
-        }
+    FinishReason reason;
+    if (!stream->cacheKey.empty() && responseCache.lookup(stream->cacheKey, stream->cached, reason)) {
+        logDebug("Response cache hit\n");
+        stream->fromCache = true;
+        session->response = stream->cached;
+        session->finishReason = reason;
+    }
+    else {
+        const std::string pending = std::move(session->pendingPrefill);
+        session->pendingPrefill.clear();
 
-        if (llama_decode(ctx, batch)) {
-            error_ = "Error: failed to decode";
-            logError(error_);
+        if (!beginGeneration(session, pending + prompt, options, *stream))
             return false;
-        }
+    }
 
-        new_token_id = llama_sampler_sample(smpl, ctx, -1);
+    stream->prompt = std::move(prompt);
+    session->stream = std::move(stream);
+    return true;
+}
 
-        if (llama_vocab_is_eog(vocab, new_token_id)) {
-            break;
-        }
+int LlamaRuntime::nextChunk(int session_id, std::string &chunk) {
+    chunk.clear();
 
-        char buf[256] = {0};  // Ensures all bytes are initialized to '\0'
+    LlamaSession *session = getSession(session_id);
+    if (session == nullptr || !session->stream) {
+        error_ = "Error: No generation in progress on session " + std::to_string(session_id);
+        logError(error_);
+        return -1;
+    }
 
-        int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
-        if (n < 0) {
-            error_ = "Error: failed to convert token to piece";
-            logError(error_);
-            return false;
-        }
+    GenerationStream &stream = *session->stream;
 
-        //std::string piece(buf, n);
-        std::string piece;
-        piece.assign(buf, n);  // More robust than std::string(buf, n)
+    // A cached response is returned as a single chunk
+    if (stream.fromCache) {
+        chunk = std::move(stream.cached);
+        stream.cached.clear();
+        stream.finished = true;
+    }
 
-        if (!isValidUtf8(piece)) {  // Validate UTF-8 (function provided below)
-            logDebug("Warning: Token ID " + std::to_string(new_token_id) + " produced invalid UTF-8, skipping.");
+    // Tokens withheld by the stop matcher produce no text, keep decoding until some is released
+    while (chunk.empty() && !stream.finished) {
+        if (!stepGeneration(session, stream, chunk)) {
+            session->stream.reset();
+            return -1;
         }
-        else
-        {
-            /*** ultra debug
-            if(n > 0)
-                logDebug("Sampled Token ID: " + std::to_string(new_token_id) + " n(" + std::to_string(n)  + ") -> \"" + piece + "\"\n");
-            else
-                logDebug("Sampled Token ID with N=0: " + std::to_string(new_token_id) + "\n");
-            logDebug("KV Cache after decoding: " + std::to_string(llama_get_kv_cache_used_cells(ctx)) + " / " + std::to_string(n_ctx_total)+ "\n");
-            */
-            if (callback)
-                callback(piece.c_str(), userData);
+    }
 
-            session->response += piece;
-        }
+    if (!chunk.empty())
+        return 1;
+
+    endStream(session);
+    return 0;
+}
 
+bool LlamaRuntime::finishGeneration(int session_id) {
+    LlamaSession *session = getSession(session_id);
+    if (session == nullptr || !session->stream)
+        return false;
 
-        batch = llama_batch_get_one(&new_token_id, 1);
-        token_count++; // Prevent infinite looping
+    if (!session->stream->finished && !session->stream->fromCache) {
+        // The text generated so far stays in the KV cache and becomes the turn's response
+        std::string rest;
+        session->finishReason = FINISH_CANCELLED;
+        endGeneration(session, *session->stream, rest);
     }
 
+    endStream(session);
     return true;
 }
 
-const std::string LlamaRuntime::getResponse(int session_id) {
-    LlamaSession *session = getSession(session_id);
-    if (session)
-        return session->response;
+bool LlamaRuntime::cancelGeneration(int session_id) {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    auto it = sessions.find(session_id);
+    if (it == sessions.end())
+        return false;
 
-    return std::string();
+    it->second->cancelRequested = true;
+    return true;
 }
 
-std::vector<llama_token> LlamaRuntime::tokenizePrompt(const std::string &prompt, bool is_first) {
-    // Determine the number of tokens required for the given prompt
-    const int n_prompt_tokens = -llama_tokenize(vocab, prompt.c_str(), prompt.size(), nullptr, 0, is_first, true);
+void LlamaRuntime::clearCancelRequest(int session_id) {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    auto it = sessions.find(session_id);
+    if (it != sessions.end())
+        it->second->cancelRequested = false;
+}
 
-    // If tokenization fails, return an empty vector
-    if (n_prompt_tokens < 0) {
-        return {};
-    }
+bool LlamaRuntime::checkIdle(LlamaSession *session) {
+    if (!session->stream)
+        return true;
 
-    // Allocate a vector to store the tokens
-    std::vector<llama_token> prompt_tokens(n_prompt_tokens);
+    error_ = "Error: A generation is in progress on the session, finish it first.";
+    logError(error_);
+    return false;
+}
 
-    // Perform actual tokenization and store the result in the vector
-    if (llama_tokenize(vocab, prompt.c_str(), prompt.size(), prompt_tokens.data(), prompt_tokens.size(), is_first, true) < 0) {
-        return {}; // Return an empty vector on failure
+bool LlamaRuntime::checkLoraAdapterIdle(const std::string &name) {
+    for (auto& [sessionId, session] : sessions) {
+        if (session->stream && session->appliedLoraAdapter == name) {
+            error_ = "Error: A generation using LoRA adapter '" + name + "' is in progress on session " +
+                     std::to_string(sessionId) + ", finish it first.";
+            logError(error_);
+            return false;
+        }
     }
-
-    return prompt_tokens;
+    return true;
 }
 
-GGUFMetadata LlamaRuntime::parseGGUF(const std::string& filepath, void (*messageCallback)(const char* message)) {
-    GGUFMetadata metadata;
-    struct gguf_init_params params = { true };
+void LlamaRuntime::endStream(LlamaSession *session) {
+    std::unique_ptr<GenerationStream> stream = std::move(session->stream);
 
-    // Initialize GGUF context from file
-    struct gguf_context *ctx = gguf_init_from_file(filepath.c_str(), params);
-    if (!ctx) {
+    if (stream->fromCache) {
+        // Served from the cache, decoded ahead of the next prompt so the KV cache catches up with the history
+        session->pendingPrefill += stream->prompt + session->response;
+    }
+    else {
+        storeResponse(session, stream->cacheKey);
+    }
+    addResponseToHistory(session, stream->prompt);
+}
 
-        std::string error = "[ERROR]: Failed to load GGUF file: " + filepath+"\n";
-        if (messageCallback)
-            messageCallback(error.c_str());
-        return metadata; // Return empty metadata on failure
+bool LlamaRuntime::loadLoraAdapter(const std::string &name, const std::string &path) {
+    if (!model) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return false;
     }
 
-    // Retrieve the number of metadata keys
-    uint32_t key_count = gguf_get_n_kv(ctx);
-    //logMessage("GGUF Metadata Keys: "+std::to_string(key_count)+"\n");
-    std::string message = "GGUF Metadata Keys: " + std::to_string(key_count) + "\n";
-    if (messageCallback)
-        messageCallback(message.c_str());
+    if (!checkLoraAdapterIdle(name))
+        return false;
 
-    // Iterate through each metadata key and store relevant values
-    for (uint32_t i = 0; i < key_count; ++i) {
-        const char *key = gguf_get_key(ctx, i);
-        int64_t key_id = gguf_find_key(ctx, key);
+    llama_adapter_lora *adapter = llama_adapter_lora_init(model, path.c_str());
+    if (!adapter) {
+        error_ = "Error: Failed to load LoRA adapter: " + path;
+        logError(error_);
+        return false;
+    }
 
-        // Ensure the key exists
-        if (key_id < 0) {
-            std::string error = "[ERROR]: Failed to find key: "+std::to_string(key_id)+"\n";
-            if (messageCallback)
-                messageCallback(error.c_str());
-            continue;
-        }
+    // Replacing an adapter under the same name releases the previous one. Sessions
+    // keep selecting the name and scale, the new adapter is applied on their next generation.
+    auto existing = loraAdapters.find(name);
+    if (existing != loraAdapters.end()) {
+        detachLoraAdapter(name);
+        llama_adapter_lora_free(existing->second);
+    }
+
+    loraAdapters[name] = adapter;
+    logInfo("Loaded LoRA adapter '" + name + "' from " + path);
+    return true;
+}
+
+bool LlamaRuntime::unloadLoraAdapter(const std::string &name) {
+    auto it = loraAdapters.find(name);
+    if (it == loraAdapters.end()) {
+        logError("LoRA adapter not found: " + name);
+        return false;
+    }
+
+    if (!checkLoraAdapterIdle(name))
+        return false;
+
+    detachLoraAdapter(name);
+    for (auto& [sessionId, session] : sessions) {
+        if (session->loraAdapter == name)
+            session->loraAdapter.clear();
+    }
+
+    llama_adapter_lora_free(it->second);
+    loraAdapters.erase(it);
+    logInfo("Unloaded LoRA adapter '" + name + "'");
+    return true;
+}
+
+// Removes the adapter from every context still using it so it can be freed
+void LlamaRuntime::detachLoraAdapter(const std::string &name) {
+    for (auto& [sessionId, session] : sessions) {
+        if (session->appliedLoraAdapter == name && session->ctx) {
+            llama_clear_adapter_lora(session->ctx);
+            llama_kv_cache_clear(session->ctx);
+            session->appliedLoraAdapter.clear();
+        }
+    }
+
+    if (fimLoraAdapter == name && fimCtx) {
+        llama_clear_adapter_lora(fimCtx);
+        llama_kv_cache_clear(fimCtx);
+        fimTokens.clear();
+        fimLoraAdapter.clear();
+    }
+}
+
+bool LlamaRuntime::setSessionLoraAdapter(int session_id, const std::string &name, float scale) {
+    LlamaSession *session = getSession(session_id);
+    if (!session) {
+        error_ = "Error: Session is invalid.";
+        logError(error_);
+        return false;
+    }
+
+    if (!name.empty() && !loraAdapters.count(name)) {
+        error_ = "Error: LoRA adapter not found: " + name;
+        logError(error_);
+        return false;
+    }
+
+    session->loraAdapter = name;
+    session->loraScale = scale;
+    return true;
+}
+
+void LlamaRuntime::setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds) {
+    responseCache.setLimits(maxEntries, maxBytes, ttlSeconds);
+}
+
+std::string LlamaRuntime::responseCacheKey(LlamaSession *session, const GenerationOptions &options, const std::string &prompt) {
+    if (!responseCache.enabled())
+        return {};
+
+    // Only greedy decoding without penalties gives the same response for the same input
+    const SamplerSettings sampler = requestSampler(session->sampler, options);
+    if (sampler.temperature > 0.0f || sampler.repetitionPenalty != 1.0f ||
+        sampler.frequencyPenalty != 0.0f || sampler.presencePenalty != 0.0f)
+        return {};
+
+    // An empty KV cache holds no history, whatever the session went through before
+    if (llama_get_kv_cache_used_cells(session->ctx) == 0 && session->pendingPrefill.empty())
+        session->contextHash = 0;
+
+    const std::string &lora = options.lora.empty() ? session->loraAdapter : options.lora;
+    const float loraScale = options.lora.empty() ? session->loraScale : options.loraScale;
+
+    std::string key;
+    key += modelPath + '\x1f' + std::to_string(llama_model_size(model)) + '\x1f' + std::to_string(llama_model_n_params(model));
+    key += '\x1f' + std::to_string(llama_n_ctx(session->ctx));
+    key += '\x1f' + lora + '\x1f' + (lora.empty() ? std::string() : std::to_string(loraScale));
+    key += '\x1f' + options.grammarRoot + '\x1f' + options.grammar + '\x1f' + options.jsonSchema;
+    for (const auto &stop : options.stop)
+        key += '\x1e' + stop;
+    key += '\x1f' + std::to_string(options.maxTokens);
+    key += '\x1f' + std::to_string(session->contextHash);
+    key += '\x1f' + prompt;
+    return key;
+}
+
+bool LlamaRuntime::getSessionSampler(int session_id, SamplerSettings &settings) {
+    LlamaSession *session = getSession(session_id);
+    if (!session) {
+        error_ = "Error: Session is invalid.";
+        logError(error_);
+        return false;
+    }
+
+    settings = session->sampler;
+    return true;
+}
+
+bool LlamaRuntime::setSessionSampler(int session_id, const SamplerSettings &settings) {
+    LlamaSession *session = getSession(session_id);
+    if (!session) {
+        error_ = "Error: Session is invalid.";
+        logError(error_);
+        return false;
+    }
+
+    if (!checkIdle(session))
+        return false;
+
+    // The chain holds no context state, swapping it keeps the KV cache
+    session->clearSampler();
+    session->sampler = settings;
+    session->smpl = createSamplerChain(session->sampler);
+    return true;
+}
+
+bool LlamaRuntime::applyLoraAdapter(llama_context *ctx, const std::string &name, float scale,
+                                    std::string &appliedName, float &appliedScale) {
+    if (name == appliedName && (name.empty() || scale == appliedScale))
+        return true;
+
+    llama_adapter_lora *adapter = nullptr;
+    if (!name.empty()) {
+        auto it = loraAdapters.find(name);
+        if (it == loraAdapters.end()) {
+            error_ = "Error: LoRA adapter not found: " + name;
+            logError(error_);
+            return false;
+        }
+        adapter = it->second;
+    }
+
+    llama_clear_adapter_lora(ctx);
+    appliedName.clear();
+
+    // Cached keys and values were computed with other weights
+    llama_kv_cache_clear(ctx);
+
+    if (adapter && llama_set_adapter_lora(ctx, adapter, scale) != 0) {
+        error_ = "Error: Failed to apply LoRA adapter: " + name;
+        logError(error_);
+        return false;
+    }
+
+    appliedName = name;
+    appliedScale = scale;
+    return true;
+}
+
+bool LlamaRuntime::applySessionLoraAdapter(LlamaSession *session, const GenerationOptions &options) {
+    if (!options.lora.empty())
+        return applyLoraAdapter(session->ctx, options.lora, options.loraScale,
+                                session->appliedLoraAdapter, session->appliedLoraScale);
+
+    return applyLoraAdapter(session->ctx, session->loraAdapter, session->loraScale,
+                            session->appliedLoraAdapter, session->appliedLoraScale);
+}
+
+bool LlamaRuntime::applyChatTemplate(LlamaSession *session, const std::string &input_prompt, std::string &prompt) {
+    // add the user input to the message list and format it
+    session->messages.push_back({"user", strdup(input_prompt.c_str())});
+
+    int new_len = llama_chat_apply_template(llama_model_chat_template(model, nullptr), session->messages.data(), session->messages.size(), true, session->formatted.data(), session->formatted.size());
+    if (new_len > session->formatted.size()) {
+        session->formatted.resize(new_len);
+        new_len = llama_chat_apply_template(llama_model_chat_template(model, nullptr), session->messages.data(), session->messages.size(), true, session->formatted.data(), session->formatted.size());
+    }
+    if (new_len < 0) {
+        error_ = "Error: failed to apply the chat template";
+        logError(error_);
+        return false;
+    }
+
+    // remove previous messages to obtain the prompt to generate the response
+    prompt.assign(session->formatted.begin(), session->formatted.begin() + new_len);
+    return true;
+}
+
+/**
+ * Generates n alternative responses sharing one prefilled prompt.
+ * @param session_id The session identifier.
+ * @param input_prompt The input text prompt.
+ * @param n Number of completions.
+ * @param options Options applied to every completion.
+ * @param responses Receives the completions.
+ * @param reasons Receives the finish reasons.
+ * @return True if successful, false otherwise.
+ */
+bool LlamaRuntime::generateResponses(int session_id, const std::string &input_prompt, int n, const GenerationOptions &options,
+                                     std::vector<std::string> &responses, std::vector<FinishReason> &reasons) {
+    LlamaSession *session = getSession(session_id);
+    if (session == nullptr) {
+        error_ = "Error: Session is invalid.";
+        logError(error_);
+        return false;
+    }
+
+    if (!session->ctx || !model || !vocab) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return false;
+    }
+
+    if (!checkIdle(session))
+        return false;
+
+    if (n < 1 || n > (int)llama_n_seq_max(session->ctx)) {
+        error_ = "Error: Number of completions must be between 1 and " + std::to_string(llama_n_seq_max(session->ctx));
+        logError(error_);
+        return false;
+    }
+
+    if (!applySessionLoraAdapter(session, options))
+        return false;
+
+    std::string prompt;
+    if (!applyChatTemplate(session, input_prompt, prompt))
+        return false;
+
+    const std::string pending = std::move(session->pendingPrefill);
+    session->pendingPrefill.clear();
+
+    if (!generateParallel(session, pending + prompt, n, options, responses, reasons))
+        return false;
+
+    // The first completion continues the conversation
+    session->response = responses[0];
+    session->finishReason = reasons[0];
+    session->contextHash = ResponseCache::hash(prompt + session->response, session->contextHash);
+    session->messages.push_back({"assistant", strdup(session->response.c_str())});
+
+    return true;
+}
+
+bool isValidUtf8(const std::string& str) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str.c_str());
+    int num = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (num == 0) {
+            if ((bytes[i] & 0x80) == 0) continue;  // ASCII (0xxxxxxx)
+            else if ((bytes[i] & 0xE0) == 0xC0) num = 1; // 2-byte (110xxxxx)
+            else if ((bytes[i] & 0xF0) == 0xE0) num = 2; // 3-byte (1110xxxx)
+            else if ((bytes[i] & 0xF8) == 0xF0) num = 3; // 4-byte (11110xxx)
+            else return false;  // Invalid first byte
+        } else {
+            if ((bytes[i] & 0xC0) != 0x80) return false; // Not a valid continuation byte
+            num--;
+        }
+    }
+    return num == 0;
+}
+
+/**
+ * This function executes the actual text generation using a given llama_context
+ * and sampler. The response is processed and streamed via the callback.
+ *
+ * @param session The session for which the response is to be generated.
+ * @param prompt The prompt string to generate a response for.
+ * @param options Additional options for the generation process.
+ * @param callback A callback function to be invoked for each generated token.
+ * @param userData User data to be passed to the callback function.
+ * @return True if the generation is successful, otherwise false.
+ *
+ * Implementation Details:
+ * - The function uses a loop to generate tokens until the context is full or the generation is complete.
+ * - It checks the context size and breaks the loop if the context is exceeded.
+ * - Each generated token is processed and added to the session's response.
+ * - The function uses a callback to stream the generated tokens.
+ * - The `token_count` variable is used to prevent infinite looping.
+ */
+bool LlamaRuntime::generate(LlamaSession *session, const std::string &prompt, const GenerationOptions &options, void (*callback)(const char*, void *), void *userData) {
+
+    GenerationStream stream;
+    if (!beginGeneration(session, prompt, options, stream))
+        return false;
+
+    std::string output;
+    while (!stream.finished) {
+        if (!stepGeneration(session, stream, output))
+            return false;
+
+        if (!output.empty() && callback)
+            callback(output.c_str(), userData);
+    }
+
+    return true;
+}
+
+bool LlamaRuntime::beginGeneration(LlamaSession *session, const std::string &prompt, const GenerationOptions &options, GenerationStream &stream) {
+
+    if(!session) {
+        error_ = "Error: Generate, session is null";
+        logError(error_);
+        return false;
+    }
+
+    // The stream frees the per request samplers on every exit path
+    if (!createGrammarSampler(options, stream.grammar))
+        return false;
+
+    // Sampler overrides get a chain of their own, the session's chain is left untouched
+    if (!options.sampler.empty())
+        stream.requestChain = createSamplerChain(requestSampler(session->sampler, options));
+    stream.chain = stream.requestChain ? stream.requestChain : session->smpl;
+
+    session->response.clear(); // TODO move to LlamaSession
+    session->finishReason = FINISH_ERROR;
+    llama_context* ctx = session->ctx;
+
+    stream.stopMatcher = StopSequenceMatcher(options.stop);
+    stream.maxTokens = options.maxTokens;
+    stream.timeoutMs = options.timeoutMs;
+    stream.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeoutMs);
+
+    const bool is_first = llama_get_kv_cache_used_cells(ctx) == 0;
+
+    stream.promptTokens = tokenizePrompt(prompt, is_first);
+    if (stream.promptTokens.empty()) {
+        error_ = "Error: Failed to tokenize the prompt";
+        logError(error_);
+        return false;
+    }
+
+    logDebug("Total tokens in prompt: " + std::to_string(stream.promptTokens.size())+ "\n");
+
+    stream.batch = llama_batch_get_one(stream.promptTokens.data(), stream.promptTokens.size());
+    stream.tokenCount = 0;
+    stream.finished = false;
+    return true;
+}
+
+bool LlamaRuntime::stepGeneration(LlamaSession *session, GenerationStream &stream, std::string &output) {
+    output.clear();
+    llama_context* ctx = session->ctx;
+
+    int n_ctx_total = llama_n_ctx(ctx);
+    int n_ctx_used = llama_get_kv_cache_used_cells(ctx);
+
+    //logDebug("KV Cache before decoding: " + std::to_string(n_ctx_used) + " / " + std::to_string(n_ctx_total)+ "\n");
+
+    // Checked once per token, a cancellation stops the decode loop within one token
+    if (session->cancelRequested) {
+        session->finishReason = FINISH_CANCELLED;
+        endGeneration(session, stream, output);
+        return true;
+    }
+
+    if (n_ctx_used + stream.batch.n_tokens > n_ctx_total) {
+        logError("Context size exceeded! Used: " + std::to_string(n_ctx_used) + ", Limit: " + std::to_string(n_ctx_total)+ "\n");
+        session->finishReason = FINISH_CONTEXT_FULL;
+        endGeneration(session, stream, output);
+        return true;
+    }
+
+    if (llama_decode(ctx, stream.batch)) {
+        error_ = "Error: failed to decode";
+        logError(error_);
+        return false;
+    }
+
+    stream.token = sampleToken(ctx, stream.chain, stream.grammar, session->candidates, -1);
+
+    if (llama_vocab_is_eog(vocab, stream.token)) {
+        session->finishReason = FINISH_EOG;
+        endGeneration(session, stream, output);
+        return true;
+    }
+
+    char buf[256] = {0};  // Ensures all bytes are initialized to '\0'
+
+    int n = llama_token_to_piece(vocab, stream.token, buf, sizeof(buf), 0, true);
+    if (n < 0) {
+        error_ = "Error: failed to convert token to piece";
+        logError(error_);
+        return false;
+    }
+
+    std::string piece;
+    piece.assign(buf, n);  // More robust than std::string(buf, n)
+
+    if (!isValidUtf8(piece)) {  // Validate UTF-8 (function provided below)
+        logDebug("Warning: Token ID " + std::to_string(stream.token) + " produced invalid UTF-8, skipping.");
+    }
+    else
+    {
+        output = stream.stopMatcher.push(piece);
+        session->response += output;
+
+        if (stream.stopMatcher.stopped()) {
+            session->finishReason = FINISH_STOP_SEQUENCE;
+            endGeneration(session, stream, output);
+            return true;
+        }
+    }
+
+    stream.batch = llama_batch_get_one(&stream.token, 1);
+    stream.tokenCount++; // Prevent infinite looping
+
+    if (stream.maxTokens > 0 && stream.tokenCount >= stream.maxTokens) {
+        session->finishReason = FINISH_MAX_TOKENS;
+        endGeneration(session, stream, output);
+    }
+    else if (stream.timeoutMs > 0 && std::chrono::steady_clock::now() >= stream.deadline) {
+        logWarning("Generation deadline of " + std::to_string(stream.timeoutMs) + " ms reached after " + std::to_string(stream.tokenCount) + " tokens");
+        session->finishReason = FINISH_DEADLINE;
+        endGeneration(session, stream, output);
+    }
+
+    return true;
+}
+
+void LlamaRuntime::endGeneration(LlamaSession *session, GenerationStream &stream, std::string &output) {
+    // Release text withheld as a possible stop string prefix
+    std::string rest = stream.stopMatcher.flush();
+    output += rest;
+    session->response += rest;
+    stream.finished = true;
+}
+
+llama_sampler *LlamaRuntime::createSamplerChain(uint32_t seed) {
+    SamplerSettings settings = samplerSettings;
+    if (settings.seed < 0)
+        settings.seed = seed;
+    return createSamplerChain(settings);
+}
+
+llama_sampler *LlamaRuntime::createSamplerChain(const SamplerSettings &settings) {
+    llama_sampler *chain = llama_sampler_chain_init(llama_sampler_chain_default_params());
+
+    // Samplers left at their neutral value are not added, each one costs a pass over the candidates
+    if (settings.repetitionPenalty != 1.0f || settings.frequencyPenalty != 0.0f || settings.presencePenalty != 0.0f) {
+        llama_sampler_chain_add(chain, llama_sampler_init_penalties(settings.penaltyLastN, settings.repetitionPenalty,
+                                                                    settings.frequencyPenalty, settings.presencePenalty));
+    }
+
+    if (settings.temperature <= 0.0f) {
+        llama_sampler_chain_add(chain, llama_sampler_init_greedy());
+        return chain;
+    }
+
+    // Partial selection leaves a short sorted prefix, min_p and dist then never sort the vocabulary
+    if (settings.topK > 0 || settings.topP < 1.0f)
+        llama_sampler_chain_add(chain, SamplerKernels::initTopKP(settings.topK, settings.topP));
+    if (settings.minP > 0.0f)
+        llama_sampler_chain_add(chain, llama_sampler_init_min_p(settings.minP, 1));
+    llama_sampler_chain_add(chain, llama_sampler_init_temp(settings.temperature));
+    llama_sampler_chain_add(chain, llama_sampler_init_dist(settings.seed < 0 ? LLAMA_DEFAULT_SEED : (uint32_t)settings.seed));
+    return chain;
+}
+
+SamplerSettings LlamaRuntime::requestSampler(const SamplerSettings &base, const GenerationOptions &options) {
+    SamplerSettings settings = base;
+    for (const auto &param : options.sampler) {
+        if (!settings.set(param.first, param.second))
+            logWarning("Unknown sampler parameter: " + param.first);
+    }
+    return settings;
+}
+
+/**
+ * Decodes n completions of one prompt together.
+ *
+ * The prompt is decoded once on sequence 0 and its cells are shared with the
+ * other sequences through llama_kv_cache_seq_cp, no KV data is copied. Every
+ * step decodes one token of each unfinished sequence in a single batch. Each
+ * sequence has its own sampler chain, seeded independently, so completions
+ * diverge. Only sequence 0 is kept in the KV cache afterwards.
+ */
+bool LlamaRuntime::generateParallel(LlamaSession *session, const std::string &prompt, int n,
+                                    const GenerationOptions &options,
+                                    std::vector<std::string> &responses,
+                                    std::vector<FinishReason> &reasons) {
+    llama_context *ctx = session->ctx;
+
+    responses.assign(n, std::string());
+    reasons.assign(n, FINISH_ERROR);
+    session->response.clear();
+    session->finishReason = FINISH_ERROR;
+
+    auto freeSampler = [](llama_sampler *smpl) {
+        if (smpl)
+            llama_sampler_free(smpl);
+    };
+
+    // Per sequence state
+    struct Sequence {
+        std::unique_ptr<llama_sampler, void (*)(llama_sampler*)> chain{nullptr, nullptr};
+        std::unique_ptr<llama_sampler, void (*)(llama_sampler*)> grammar{nullptr, nullptr};
+        StopSequenceMatcher stopMatcher;
+        llama_token token = 0;
+        int batchIndex = -1;
+        bool active = true;
+    };
+
+    const SamplerSettings settings = requestSampler(session->sampler, options);
+
+    std::vector<Sequence> sequences(n);
+    for (int i = 0; i < n; i++) {
+        llama_sampler *grammar = nullptr;
+        if (!createGrammarSampler(options, grammar))
+            return false;
+
+        // Sequence 0 continues the session's chain unless the request overrides it, a fixed seed is offset per sequence
+        SamplerSettings sequenceSettings = settings;
+        if (sequenceSettings.seed >= 0)
+            sequenceSettings.seed += i;
+
+        const bool ownChain = i > 0 || !options.sampler.empty();
+        sequences[i].chain = { ownChain ? createSamplerChain(sequenceSettings) : nullptr, freeSampler };
+        sequences[i].grammar = { grammar, freeSampler };
+        sequences[i].stopMatcher = StopSequenceMatcher(options.stop);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeoutMs);
+    const bool is_first = llama_get_kv_cache_used_cells(ctx) == 0;
+
+    std::vector<llama_token> prompt_tokens = tokenizePrompt(prompt, is_first);
+    if (prompt_tokens.empty()) {
+        error_ = "Error: Failed to tokenize the prompt";
+        logError(error_);
+        return false;
+    }
+
+    const int n_ctx_total = llama_n_ctx(ctx);
+    if (llama_get_kv_cache_used_cells(ctx) + (int)prompt_tokens.size() > n_ctx_total) {
+        logError("Context size exceeded! Prompt of " + std::to_string(prompt_tokens.size()) + " tokens does not fit\n");
+        reasons.assign(n, FINISH_CONTEXT_FULL);
+        session->finishReason = FINISH_CONTEXT_FULL;
+        return true;
+    }
+
+    // Prefill once on sequence 0
+    if (llama_decode(ctx, llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size()))) {
+        error_ = "Error: failed to decode";
+        logError(error_);
+        return false;
+    }
+
+    for (int i = 1; i < n; i++)
+        llama_kv_cache_seq_cp(ctx, 0, i, -1, -1);
+
+    llama_pos pos = llama_kv_cache_seq_pos_max(ctx, 0) + 1;
+
+    llama_batch batch = llama_batch_init(n, 0, 1);
+
+    // Every sequence samples its first token from the prompt logits at batch index -1
+    bool success = true;
+    int active = n;
+    long token_count = 0;
+    while (active > 0 && success) {
+        for (int i = 0; i < n && success; i++) {
+            Sequence &seq = sequences[i];
+            if (!seq.active)
+                continue;
+
+            llama_sampler *chain = seq.chain ? seq.chain.get() : session->smpl;
+            seq.token = sampleToken(ctx, chain, seq.grammar.get(), session->candidates, seq.batchIndex);
+
+            if (llama_vocab_is_eog(vocab, seq.token)) {
+                reasons[i] = FINISH_EOG;
+                seq.active = false;
+                continue;
+            }
+
+            char buf[256] = {0};
+            int len = llama_token_to_piece(vocab, seq.token, buf, sizeof(buf), 0, true);
+            if (len < 0) {
+                error_ = "Error: failed to convert token to piece";
+                logError(error_);
+                success = false;
+                break;
+            }
+
+            std::string piece(buf, len);
+            if (isValidUtf8(piece)) {
+                responses[i] += seq.stopMatcher.push(piece);
+                if (seq.stopMatcher.stopped()) {
+                    reasons[i] = FINISH_STOP_SEQUENCE;
+                    seq.active = false;
+                }
+            }
+        }
+
+        if (!success)
+            break;
+
+        token_count++;
+
+        const bool cancelled = session->cancelRequested;
+        const bool deadlineReached = options.timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline;
+        const bool contextFull = llama_get_kv_cache_used_cells(ctx) + n > n_ctx_total;
+
+        // Queue the next token of every unfinished sequence in one batch
+        batch.n_tokens = 0;
+        active = 0;
+        for (int i = 0; i < n; i++) {
+            Sequence &seq = sequences[i];
+            if (!seq.active)
+                continue;
+
+            if (cancelled)
+                reasons[i] = FINISH_CANCELLED;
+            else if (options.maxTokens > 0 && token_count >= options.maxTokens)
+                reasons[i] = FINISH_MAX_TOKENS;
+            else if (deadlineReached)
+                reasons[i] = FINISH_DEADLINE;
+            else if (contextFull)
+                reasons[i] = FINISH_CONTEXT_FULL;
+
+            if (reasons[i] != FINISH_ERROR) {
+                seq.active = false;
+                continue;
+            }
+
+            batch.token[batch.n_tokens] = seq.token;
+            batch.pos[batch.n_tokens] = pos;
+            batch.n_seq_id[batch.n_tokens] = 1;
+            batch.seq_id[batch.n_tokens][0] = i;
+            batch.logits[batch.n_tokens] = true;
+            seq.batchIndex = batch.n_tokens;
+            batch.n_tokens++;
+            active++;
+        }
+
+        if (active == 0)
+            break;
+
+        if (llama_decode(ctx, batch)) {
+            error_ = "Error: failed to decode";
+            logError(error_);
+            success = false;
+        }
+        pos++;
+    }
+
+    llama_batch_free(batch);
+
+    // Keep the first completion as the conversation, release the forked sequences
+    for (int i = 1; i < n; i++)
+        llama_kv_cache_seq_rm(ctx, i, -1, -1);
+
+    if (!success)
+        return false;
+
+    for (int i = 0; i < n; i++)
+        responses[i] += sequences[i].stopMatcher.flush();
+
+    logDebug("Generated " + std::to_string(n) + " completions in " + std::to_string(token_count) + " steps");
+    return true;
+}
+
+bool LlamaRuntime::createGrammarSampler(const GenerationOptions &options, llama_sampler *&grammar) {
+    grammar = nullptr;
+
+    std::string grammarText = options.grammar;
+    std::string grammarRoot = options.grammarRoot.empty() ? "root" : options.grammarRoot;
 
-        // Determine the value type for the key
-        enum gguf_type type = gguf_get_kv_type(ctx, key_id);
+    if (!options.jsonSchema.empty()) {
+        std::string error;
+        if (!JsonSchemaGrammar::convert(options.jsonSchema, grammarText, &error)) {
+            error_ = "Error: " + error;
+            logError(error_);
+            return false;
+        }
+        grammarRoot = "root";
+    }
+
+    if (grammarText.empty())
+        return true;
+
+    const std::string key = grammarRoot + "\n" + grammarText;
+    auto it = grammarCache.find(key);
+    if (it == grammarCache.end()) {
+        llama_sampler *parsed = llama_sampler_init_grammar(vocab, grammarText.c_str(), grammarRoot.c_str());
+        if (!parsed) {
+            error_ = "Error: Failed to parse grammar";
+            logError(error_);
+            return false;
+        }
+        it = grammarCache.emplace(key, parsed).first;
+    }
+
+    grammar = llama_sampler_clone(it->second);
+    if (!grammar) {
+        error_ = "Error: Failed to create grammar sampler";
+        logError(error_);
+        return false;
+    }
+    return true;
+}
+
+llama_token LlamaRuntime::sampleToken(LlamaSession *session, llama_sampler *grammar, int idx) {
+    return sampleToken(session->ctx, session->smpl, grammar, session->candidates, idx);
+}
+
+llama_token LlamaRuntime::sampleToken(llama_context *ctx, llama_sampler *chain, llama_sampler *grammar,
+                                      std::vector<llama_token_data> &candidates, int idx) {
+    const float *logits = llama_get_logits_ith(ctx, idx);
+    const int n_vocab = llama_vocab_n_tokens(vocab);
+
+    llama_token token;
+    llama_token_data_array cur_p;
+    if (SamplerKernels::isGreedy(chain)) {
+        // Greedy decoding only needs the argmax, the candidate array is not built
+        token = SamplerKernels::argmax(logits, n_vocab);
+    } else {
+        candidates.resize(n_vocab);
+        for (llama_token id = 0; id < n_vocab; id++)
+            candidates[id] = { id, logits[id], 0.0f };
+
+        cur_p = { candidates.data(), candidates.size(), -1, false };
+        llama_sampler_apply(chain, &cur_p);
+        token = cur_p.data[cur_p.selected].id;
+    }
+
+    if (grammar) {
+        // Most sampled tokens are valid, check the single token before masking the vocabulary
+        llama_token_data single = { token, 1.0f, 0.0f };
+        llama_token_data_array single_p = { &single, 1, -1, false };
+        llama_sampler_apply(grammar, &single_p);
+
+        if (single.logit == -INFINITY) {
+            candidates.resize(n_vocab);
+            for (llama_token id = 0; id < n_vocab; id++)
+                candidates[id] = { id, logits[id], 0.0f };
+
+            cur_p = { candidates.data(), candidates.size(), -1, false };
+            llama_sampler_apply(grammar, &cur_p);
+            llama_sampler_apply(chain, &cur_p);
+            token = cur_p.data[cur_p.selected].id;
+        }
+
+        llama_sampler_accept(grammar, token);
+    }
+
+    llama_sampler_accept(chain, token);
+    return token;
+}
+
+FinishReason LlamaRuntime::getFinishReason(int session_id) {
+    LlamaSession *session = getSession(session_id);
+    if (!session)
+        return FINISH_ERROR;
+    return session->finishReason;
+}
+
+const std::string LlamaRuntime::getResponse(int session_id) {
+    LlamaSession *session = getSession(session_id);
+    if (session)
+        return session->response;
+
+    return std::string();
+}
+
+std::vector<llama_token> LlamaRuntime::tokenizePrompt(const std::string &prompt, bool is_first) {
+    std::vector<llama_token> prompt_tokens;
+    tokenize(prompt, is_first, true, prompt_tokens);
+    return prompt_tokens; // empty on failure
+}
+
+bool LlamaRuntime::tokenize(const std::string &text, bool addSpecial, bool parseSpecial, std::vector<llama_token> &tokens) const {
+    tokens.clear();
+    if (!vocab)
+        return false;
+
+    // Every token covers at least one byte, only BOS and EOS come on top, so one pass is enough
+    tokens.resize(text.size() + 2);
+    int n = llama_tokenize(vocab, text.data(), (int32_t)text.size(), tokens.data(), (int32_t)tokens.size(), addSpecial, parseSpecial);
+    if (n < 0 && n != INT32_MIN) {
+        tokens.resize(-n);
+        n = llama_tokenize(vocab, text.data(), (int32_t)text.size(), tokens.data(), (int32_t)tokens.size(), addSpecial, parseSpecial);
+    }
+
+    if (n < 0) {
+        tokens.clear();
+        return false;
+    }
+    tokens.resize(n);
+    return true;
+}
+
+bool LlamaRuntime::detokenize(const llama_token *tokens, size_t count, bool removeSpecial, bool unparseSpecial, std::string &text) const {
+    text.clear();
+    if (!vocab)
+        return false;
+
+    // Most pieces are a few bytes, retry with the exact size otherwise
+    text.resize(count * 8 + 16);
+    int n = llama_detokenize(vocab, tokens, (int32_t)count, &text[0], (int32_t)text.size(), removeSpecial, unparseSpecial);
+    if (n < 0) {
+        text.resize(-n);
+        n = llama_detokenize(vocab, tokens, (int32_t)count, &text[0], (int32_t)text.size(), removeSpecial, unparseSpecial);
+    }
+
+    if (n < 0) {
+        text.clear();
+        return false;
+    }
+    text.resize(n);
+    return true;
+}
+
+bool LlamaRuntime::tokenizeBatch(const std::vector<std::string> &texts, bool addSpecial, bool parseSpecial,
+                                 std::vector<llama_token> &tokens, std::vector<size_t> &offsets) {
+    tokens.clear();
+    offsets.assign(1, 0);
+
+    if (!vocab) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return false;
+    }
+
+    std::call_once(tokenizerPoolOnce, [this]() {
+        tokenizerPool.reset(new ThreadPool());
+    });
+
+    // Texts are tokenized in chunks so short documents do not pay one task each
+    const size_t chunkSize = 64;
+    const size_t chunkCount = (texts.size() + chunkSize - 1) / chunkSize;
+
+    struct Chunk {
+        std::vector<llama_token> tokens;
+        std::vector<size_t> lengths;
+        size_t failed = 0;
+    };
+    std::vector<Chunk> chunks(chunkCount);
+
+    tokenizerPool->run(chunkCount, [&](size_t c) {
+        Chunk &chunk = chunks[c];
+        std::vector<llama_token> textTokens;
+
+        const size_t end = std::min(texts.size(), (c + 1) * chunkSize);
+        for (size_t t = c * chunkSize; t < end; t++) {
+            if (!tokenize(texts[t], addSpecial, parseSpecial, textTokens))
+                chunk.failed++;
+
+            chunk.tokens.insert(chunk.tokens.end(), textTokens.begin(), textTokens.end());
+            chunk.lengths.push_back(textTokens.size());
+        }
+    });
+
+    size_t total = 0;
+    size_t failed = 0;
+    for (const auto &chunk : chunks) {
+        total += chunk.tokens.size();
+        failed += chunk.failed;
+    }
+
+    tokens.reserve(total);
+    offsets.reserve(texts.size() + 1);
+    for (const auto &chunk : chunks) {
+        tokens.insert(tokens.end(), chunk.tokens.begin(), chunk.tokens.end());
+        for (size_t length : chunk.lengths)
+            offsets.push_back(offsets.back() + length);
+    }
+
+    if (failed > 0)
+        logWarning(std::to_string(failed) + " texts failed to tokenize and were left empty");
+    return true;
+}
+
+bool LlamaRuntime::completeInfill(const std::string &prefix, const std::string &suffix, const GenerationOptions &options,
+                                  void (*callback)(const char*, void *), void *userData,
+                                  std::string &completion, FinishReason &reason) {
+    completion.clear();
+    reason = FINISH_ERROR;
+
+    if (!model || !vocab) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return false;
+    }
+
+    const llama_token fimPre = llama_vocab_fim_pre(vocab);
+    const llama_token fimSuf = llama_vocab_fim_suf(vocab);
+    const llama_token fimMid = llama_vocab_fim_mid(vocab);
+    if (fimPre == LLAMA_TOKEN_NULL || fimSuf == LLAMA_TOKEN_NULL || fimMid == LLAMA_TOKEN_NULL) {
+        error_ = "Error: Model does not support fill-in-the-middle";
+        logError(error_);
+        return false;
+    }
+
+    if (!fimCtx) {
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = context_size;
+        ctx_params.n_batch = context_size;
+
+        fimCtx = llama_new_context_with_model(model, ctx_params);
+        if (!fimCtx) {
+            error_ = "Error: Failed to create fill-in-the-middle context";
+            logError(error_);
+            return false;
+        }
+        fimTokens.clear();
+        logInfo("Created fill-in-the-middle context");
+    }
+
+    if (!applyLoraAdapter(fimCtx, options.lora, options.loraScale, fimLoraAdapter, fimLoraScale))
+        return false;
+    if (llama_get_kv_cache_used_cells(fimCtx) == 0)
+        fimTokens.clear();
+
+    const int n_ctx = llama_n_ctx(fimCtx);
+    const int n_batch = llama_n_batch(fimCtx);
+
+    std::vector<llama_token> prefixTokens = tokenizePrompt(prefix, false);
+    std::vector<llama_token> suffixTokens = tokenizePrompt(suffix, false);
+
+    // Keep the text closest to the cursor when the file does not fit, a quarter of the context is left for the middle
+    const int reserve = options.maxTokens > 0 ? std::min(options.maxTokens, n_ctx / 4) : n_ctx / 4;
+    const int budget = n_ctx - reserve - 4;
+    if ((int)(prefixTokens.size() + suffixTokens.size()) > budget) {
+        const int suffixBudget = std::min((int)suffixTokens.size(), budget / 4);
+        const int prefixBudget = budget - suffixBudget;
+        if ((int)prefixTokens.size() > prefixBudget)
+            prefixTokens.erase(prefixTokens.begin(), prefixTokens.end() - prefixBudget);
+        suffixTokens.resize(std::min((int)suffixTokens.size(), budget - (int)prefixTokens.size()));
+    }
+
+    // Prefix-suffix-middle layout
+    std::vector<llama_token> prompt;
+    prompt.reserve(prefixTokens.size() + suffixTokens.size() + 4);
+    if (llama_vocab_get_add_bos(vocab))
+        prompt.push_back(llama_vocab_bos(vocab));
+    prompt.push_back(fimPre);
+    prompt.insert(prompt.end(), prefixTokens.begin(), prefixTokens.end());
+    prompt.push_back(fimSuf);
+    prompt.insert(prompt.end(), suffixTokens.begin(), suffixTokens.end());
+    prompt.push_back(fimMid);
+
+    // Reuse the cached tokens shared with the previous request, at least the last prompt token is decoded for its logits
+    size_t reused = 0;
+    while (reused < fimTokens.size() && reused < prompt.size() && fimTokens[reused] == prompt[reused])
+        reused++;
+    reused = std::min(reused, prompt.size() - 1);
+
+    llama_kv_cache_seq_rm(fimCtx, 0, reused, -1);
+    fimTokens.resize(reused);
+
+    logDebug("Fill-in-the-middle prompt: " + std::to_string(prompt.size()) + " tokens, " + std::to_string(reused) + " reused");
+
+    for (size_t i = reused; i < prompt.size(); i += n_batch) {
+        const int n = std::min((int)(prompt.size() - i), n_batch);
+        if (llama_decode(fimCtx, llama_batch_get_one(prompt.data() + i, n))) {
+            error_ = "Error: failed to decode fill-in-the-middle prompt";
+            logError(error_);
+            llama_kv_cache_seq_rm(fimCtx, 0, fimTokens.size(), -1);
+            return false;
+        }
+        fimTokens.insert(fimTokens.end(), prompt.begin() + i, prompt.begin() + i + n);
+    }
+
+    llama_sampler *grammar = nullptr;
+    if (!createGrammarSampler(options, grammar))
+        return false;
+
+    auto freeSampler = [](llama_sampler *smpl) {
+        if (smpl)
+            llama_sampler_free(smpl);
+    };
+    std::unique_ptr<llama_sampler, void (*)(llama_sampler*)> grammarGuard(grammar, freeSampler);
+    std::unique_ptr<llama_sampler, void (*)(llama_sampler*)> chain(createSamplerChain(requestSampler(samplerSettings, options)), freeSampler);
+
+    // Code models end the middle with EOG or one of the other FIM control tokens
+    const llama_token fimEnd[] = { llama_vocab_fim_pad(vocab), llama_vocab_fim_rep(vocab), llama_vocab_fim_sep(vocab) };
+
+    StopSequenceMatcher stopMatcher(options.stop);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeoutMs);
+
+    long token_count = 0;
+    while (true) {
+        llama_token token = sampleToken(fimCtx, chain.get(), grammar, fimCandidates, -1);
+
+        if (llama_vocab_is_eog(vocab, token) || std::find(std::begin(fimEnd), std::end(fimEnd), token) != std::end(fimEnd)) {
+            reason = FINISH_EOG;
+            break;
+        }
+
+        char buf[256] = {0};
+        int len = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, false);
+        if (len < 0) {
+            error_ = "Error: failed to convert token to piece";
+            logError(error_);
+            return false;
+        }
+
+        std::string output = stopMatcher.push(std::string(buf, len));
+        if (!output.empty()) {
+            if (callback)
+                callback(output.c_str(), userData);
+            completion += output;
+        }
+
+        if (stopMatcher.stopped()) {
+            reason = FINISH_STOP_SEQUENCE;
+            break;
+        }
+
+        token_count++;
+        if (options.maxTokens > 0 && token_count >= options.maxTokens) {
+            reason = FINISH_MAX_TOKENS;
+            break;
+        }
+
+        if (options.timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline) {
+            reason = FINISH_DEADLINE;
+            break;
+        }
+
+        if ((int)fimTokens.size() + 1 > n_ctx) {
+            reason = FINISH_CONTEXT_FULL;
+            break;
+        }
+
+        if (llama_decode(fimCtx, llama_batch_get_one(&token, 1))) {
+            error_ = "Error: failed to decode";
+            logError(error_);
+            return false;
+        }
+        fimTokens.push_back(token);
+    }
+
+    std::string rest = stopMatcher.flush();
+    if (!rest.empty()) {
+        if (callback)
+            callback(rest.c_str(), userData);
+        completion += rest;
+    }
+
+    return true;
+}
+
+GGUFMetadata LlamaRuntime::parseGGUF(const std::string& filepath, void (*messageCallback)(const char* message)) {
+    GGUFMetadata metadata;
+
+    // Only the mapped header is read, arrays such as the vocabulary are not decoded
+    GGUFReader reader;
+    if (!reader.open(filepath)) {
+
+        std::string error = "[ERROR]: Failed to load GGUF file: " + filepath + " (" + reader.error() + ")\n";
+        if (messageCallback)
+            messageCallback(error.c_str());
+        return metadata; // Return empty metadata on failure
+    }
+
+    std::string message = "GGUF Metadata Keys: " + std::to_string(reader.keys().size()) + "\n";
+    if (messageCallback)
+        messageCallback(message.c_str());
+
+    metadata.entries.reserve(reader.keys().size());
+    for (std::string_view key : reader.keys()) {
+        const GGUFReader::Value &value = *reader.find(key);
         GGUFMetadataEntry entry;
 
-        if (type == GGUF_TYPE_UINT32) {
-            // Handle UINT32 type values
-            uint32_t value = gguf_get_val_u32(ctx, key_id);
+        switch (value.type) {
+        case GGUFReader::UINT8:
+        case GGUFReader::UINT16:
+        case GGUFReader::UINT32: {
+            int64_t ivalue = 0;
+            reader.getInt(key, ivalue);
             entry.type = GGUFType::TYPE_UINT32;
-            entry.ivalue = value;
+            entry.ivalue = (uint32_t)ivalue;
+            break;
         }
-        else if (type == GGUF_TYPE_STRING) {
-            // Handle STRING type values
-            const char *value = gguf_get_val_str(ctx, key_id);
+        case GGUFReader::INT8:
+        case GGUFReader::INT16:
+        case GGUFReader::INT32:
+        case GGUFReader::INT64:
+        case GGUFReader::UINT64:
+            reader.getInt(key, entry.lvalue);
+            entry.type = GGUFType::TYPE_INT64;
+            break;
+        case GGUFReader::BOOL:
+            reader.getInt(key, entry.lvalue);
+            entry.type = GGUFType::TYPE_BOOL;
+            break;
+        case GGUFReader::FLOAT32:
+        case GGUFReader::FLOAT64:
+            reader.getFloat(key, entry.fvalue);
+            entry.type = GGUFType::TYPE_FLOAT64;
+            break;
+        case GGUFReader::STRING:
             entry.type = GGUFType::TYPE_STRING;
-            entry.svalue = value;
-        }
-        else {
-            // Handle unknown types gracefully
-            std::string message = "Unknown type for key: " + std::to_string(key_id) + "\n";
-            if (messageCallback)
-                messageCallback(message.c_str());
-            
-            entry.type = GGUFType::TYPE_UNKNOWN;
+            entry.svalue = GGUFReader::toString(value);
+            break;
+        default:
+            entry.type = GGUFType::TYPE_ARRAY;
+            entry.svalue = GGUFReader::toString(value);
+            break;
         }
 
         // Store the metadata entry
-        metadata.entries[key] = entry;
+        metadata.entries.emplace(std::string(key), std::move(entry));
     }
 
-    // Clean up GGUF context
-    gguf_free(ctx);
-
     return metadata;
 }
 
+int LlamaRuntime::getEmbeddingSize() const {
+    if (!model)
+        return -1;
+    return llama_model_n_embd(model);
+}
+
+int LlamaRuntime::embed(const std::vector<std::string> &texts, enum llama_pooling_type pooling, bool normalize, float *output, size_t outputCapacity) {
+    if (!model || !vocab) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return -1;
+    }
+
+    const int n_embd = llama_model_n_embd(model);
+    if (!output || outputCapacity < texts.size() * n_embd) {
+        error_ = "Error: Embedding output buffer too small, " + std::to_string(texts.size() * n_embd) + " floats required";
+        logError(error_);
+        return -1;
+    }
+
+    // A text without tokens would make an empty sequence and fail its whole batch
+    std::vector<std::vector<llama_token>> textTokens(texts.size());
+    for (size_t t = 0; t < texts.size(); t++) {
+        textTokens[t] = tokenizePrompt(texts[t], true);
+        if (textTokens[t].empty()) {
+            error_ = "Error: Embedding input " + std::to_string(t) + " produces no tokens";
+            logError(error_);
+            return -1;
+        }
+    }
+
+    // The pooling type is fixed when a context is created, recreate it when it changes
+    if (embeddingCtx && embeddingPooling != pooling) {
+        llama_free(embeddingCtx);
+        embeddingCtx = nullptr;
+    }
+
+    if (!embeddingCtx) {
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = context_size;
+        ctx_params.n_batch = context_size;
+        ctx_params.n_ubatch = context_size; // pooled sequences must fit in a single ubatch
+        ctx_params.n_seq_max = maxEmbeddingSequences;
+        ctx_params.embeddings = true;
+        ctx_params.pooling_type = pooling;
+
+        embeddingCtx = llama_new_context_with_model(model, ctx_params);
+        if (!embeddingCtx) {
+            error_ = "Error: Failed to create embedding context";
+            logError(error_);
+            return -1;
+        }
+        embeddingPooling = pooling;
+        logInfo("Created embedding context");
+    }
+
+    const int n_batch = llama_n_batch(embeddingCtx);
+    const bool encoderOnly = llama_model_has_encoder(model) && !llama_model_has_decoder(model);
+
+    llama_batch batch = llama_batch_init(n_batch, 0, 1);
+    size_t firstText = 0; // index of the text held in sequence 0 of the current batch
+    int n_seq = 0;
+
+    // Decode the packed batch and copy out one pooled vector per sequence
+    auto flush = [&]() -> bool {
+        if (n_seq == 0)
+            return true;
+
+        llama_kv_cache_clear(embeddingCtx);
+        int ret = encoderOnly ? llama_encode(embeddingCtx, batch) : llama_decode(embeddingCtx, batch);
+        if (ret != 0) {
+            error_ = "Error: Failed to decode embedding batch";
+            logError(error_);
+            return false;
+        }
+
+        for (int s = 0; s < n_seq; s++) {
+            const float *embd = llama_get_embeddings_seq(embeddingCtx, s);
+            if (!embd) {
+                error_ = "Error: Failed to get pooled embedding, pooling is not supported by this model";
+                logError(error_);
+                return false;
+            }
+
+            float *row = output + (firstText + s) * n_embd;
+            double norm = 0.0;
+            for (int i = 0; i < n_embd; i++)
+                norm += (double)embd[i] * embd[i];
+
+            const float scale = (normalize && norm > 0.0) ? (float)(1.0 / std::sqrt(norm)) : 1.0f;
+            for (int i = 0; i < n_embd; i++)
+                row[i] = embd[i] * scale;
+        }
+
+        firstText += n_seq;
+        n_seq = 0;
+        batch.n_tokens = 0;
+        return true;
+    };
+
+    bool success = true;
+    for (size_t t = 0; t < texts.size() && success; t++) {
+        std::vector<llama_token> &tokens = textTokens[t];
+        if ((int)tokens.size() > n_batch) {
+            logWarning("Embedding input " + std::to_string(t) + " truncated to " + std::to_string(n_batch) + " tokens");
+            tokens.resize(n_batch);
+        }
+
+        // Start a new batch once this text no longer fits
+        if (batch.n_tokens + (int)tokens.size() > n_batch || n_seq == maxEmbeddingSequences)
+            success = flush();
+
+        for (size_t i = 0; i < tokens.size() && success; i++) {
+            int n = batch.n_tokens;
+            batch.token[n] = tokens[i];
+            batch.pos[n] = i;
+            batch.n_seq_id[n] = 1;
+            batch.seq_id[n][0] = n_seq;
+            batch.logits[n] = true;
+            batch.n_tokens++;
+        }
+        n_seq++;
+    }
+
+    if (success)
+        success = flush();
+
+    llama_batch_free(batch);
+    return success ? n_embd : -1;
+}
+
+// Log of the softmax denominator over a row of logits
+static float logSumExp(const float *logits, int n_vocab) {
+    float maxLogit = logits[0];
+    for (int i = 1; i < n_vocab; i++)
+        maxLogit = std::max(maxLogit, logits[i]);
+
+    double sum = 0.0;
+    for (int i = 0; i < n_vocab; i++)
+        sum += std::exp(logits[i] - maxLogit);
+
+    return maxLogit + (float)std::log(sum);
+}
+
+bool LlamaRuntime::scoreContinuations(const std::string &prefix, const std::vector<std::string> &candidates, std::vector<float> &totals, TokenScoreCallback tokenCallback) {
+    if (!model || !vocab) {
+        error_ = "Error: Model not loaded.";
+        logError(error_);
+        return false;
+    }
+
+    if (!scoringCtx) {
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = context_size;
+        ctx_params.n_batch = context_size;
+        ctx_params.n_seq_max = maxScoringSequences;
+
+        scoringCtx = llama_new_context_with_model(model, ctx_params);
+        if (!scoringCtx) {
+            error_ = "Error: Failed to create scoring context";
+            logError(error_);
+            return false;
+        }
+        logInfo("Created scoring context");
+    }
+
+    const int n_vocab = llama_vocab_n_tokens(vocab);
+    const int n_batch = llama_n_batch(scoringCtx);
+    const int n_ctx = llama_n_ctx(scoringCtx);
+
+    std::vector<llama_token> prefixTokens = tokenizePrompt(prefix, true);
+    if (prefixTokens.empty()) {
+        error_ = "Error: Scoring prefix is empty";
+        logError(error_);
+        return false;
+    }
+
+    std::vector<std::vector<llama_token>> candidateTokens(candidates.size());
+    for (size_t c = 0; c < candidates.size(); c++) {
+        candidateTokens[c] = tokenizePrompt(candidates[c], false);
+
+        // Every candidate is stored next to the prefix in the shared KV cache, grouped with others only if they fit
+        if (prefixTokens.size() + candidateTokens[c].size() > (size_t)n_ctx) {
+            error_ = "Error: Scoring candidate " + std::to_string(c) + " exceeds the context size";
+            logError(error_);
+            return false;
+        }
+    }
+
+    totals.assign(candidates.size(), 0.0f);
+
+    auto pieceOf = [this](llama_token token) {
+        char buf[256];
+        int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+        return n < 0 ? std::string() : std::string(buf, n);
+    };
+
+    auto report = [&](size_t c, llama_token token, float logprob) {
+        totals[c] += logprob;
+        if (tokenCallback)
+            tokenCallback(c, pieceOf(token), logprob);
+    };
+
+    llama_kv_cache_clear(scoringCtx);
+
+    // Prefill the prefix once on sequence 0, only the last position needs logits
+    const int n_prefix = prefixTokens.size();
+    for (int start = 0; start < n_prefix; start += n_batch) {
+        int n = std::min(n_batch, n_prefix - start);
+        bool last = start + n == n_prefix;
+
+        llama_batch batch = llama_batch_init(n, 0, 1);
+        for (int i = 0; i < n; i++) {
+            batch.token[i] = prefixTokens[start + i];
+            batch.pos[i] = start + i;
+            batch.n_seq_id[i] = 1;
+            batch.seq_id[i][0] = 0;
+            batch.logits[i] = last && i == n - 1;
+        }
+        batch.n_tokens = n;
+
+        int ret = llama_decode(scoringCtx, batch);
+        llama_batch_free(batch);
+        if (ret != 0) {
+            error_ = "Error: Failed to decode scoring prefix";
+            logError(error_);
+            return false;
+        }
+
+        // The first token of every candidate is predicted from the prefix
+        if (last) {
+            const float *logits = llama_get_logits_ith(scoringCtx, n - 1);
+            const float lse = logSumExp(logits, n_vocab);
+            for (size_t c = 0; c < candidates.size(); c++) {
+                if (!candidateTokens[c].empty())
+                    report(c, candidateTokens[c][0], logits[candidateTokens[c][0]] - lse);
+            }
+        }
+    }
+
+    // Remaining tokens are scored in groups of parallel sequences sharing the prefix cells.
+    // Token j is predicted by the logits of token j - 1, so the last token is never decoded.
+    const int groupSize = maxScoringSequences - 1;
+    llama_batch batch = llama_batch_init(n_batch, 0, 1);
+    std::vector<std::pair<size_t, size_t>> outputs; // (candidate, predicted token index) per batch entry
+
+    auto flush = [&]() -> bool {
+        if (batch.n_tokens == 0)
+            return true;
+
+        if (llama_decode(scoringCtx, batch) != 0) {
+            error_ = "Error: Failed to decode scoring candidates";
+            logError(error_);
+            return false;
+        }
+
+        for (int i = 0; i < batch.n_tokens; i++) {
+            const float *logits = llama_get_logits_ith(scoringCtx, i);
+            const size_t c = outputs[i].first;
+            const llama_token token = candidateTokens[c][outputs[i].second];
+            report(c, token, logits[token] - logSumExp(logits, n_vocab));
+        }
+
+        batch.n_tokens = 0;
+        outputs.clear();
+        return true;
+    };
+
+    // A group takes as many candidates as fit together in the cells left after the prefix
+    const size_t freeCells = n_ctx - n_prefix;
+    bool success = true;
+    for (size_t first = 0, last = 0; first < candidates.size() && success; first = last) {
+        size_t usedCells = 0;
+        for (last = first; last < candidates.size() && last - first < (size_t)groupSize; last++) {
+            const size_t cells = candidateTokens[last].empty() ? 0 : candidateTokens[last].size() - 1;
+            if (usedCells + cells > freeCells)
+                break;
+            usedCells += cells;
+        }
+
+        for (size_t c = first; c < last && success; c++) {
+            const llama_seq_id seq = 1 + (c - first);
+            llama_kv_cache_seq_cp(scoringCtx, 0, seq, -1, -1);
+
+            const std::vector<llama_token> &tokens = candidateTokens[c];
+            for (size_t j = 0; j + 1 < tokens.size() && success; j++) {
+                if (batch.n_tokens == n_batch)
+                    success = flush();
+
+                int n = batch.n_tokens;
+                batch.token[n] = tokens[j];
+                batch.pos[n] = n_prefix + j;
+                batch.n_seq_id[n] = 1;
+                batch.seq_id[n][0] = seq;
+                batch.logits[n] = true;
+                batch.n_tokens++;
+                outputs.push_back({c, j + 1});
+            }
+        }
+
+        if (success)
+            success = flush();
+
+        // Release the candidate cells, the prefix stays on sequence 0
+        for (size_t c = first; c < last; c++)
+            llama_kv_cache_seq_rm(scoringCtx, 1 + (c - first), -1, -1);
+    }
+
+    llama_batch_free(batch);
+    return success;
+}
+
 std::string LlamaRuntime::getContextInfo() {
     std::stringstream ss;
     ss << "Llama Context Information\n";
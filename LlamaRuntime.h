@@ -4,21 +4,29 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <atomic>
 #include <iostream> // Optional: fallback to console output
 #include <unordered_map>
+#include <memory>
+#include <mutex>
 
 #include "llama.h"
 #include "gguf.h"
 
 #include "GGUFMetadata.h"
+#include "GenerationOptions.h"
+#include "ResponseCache.h"
 
 class LlamaSession;
+class ThreadPool;
+struct GenerationStream;
 
 /**
  * @class LlamaRuntime
  * @brief Handles model loading, text generation, and logging for the Llama model.
  */
 class LlamaRuntime {
+    friend class BatchProcessor; // shares the model, tokenizer and samplers of the runtime
 public:
     /**
      * @brief Constructs a new LlamaRuntime instance.
@@ -85,6 +93,152 @@ public:
      */
     void setRepetitionPenalty(float penalty);
 
+    /**
+     * @brief Sets a default sampler parameter by its option name.
+     * @param key Name of the parameter, see SamplerSettings::set.
+     * @param value The parameter value.
+     * @return False if the name is not a sampler parameter.
+     */
+    bool setSamplerParameter(const std::string &key, double value);
+
+    // -------------------------------------------------------------------------------------
+    // Model Load Options
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Sets the number of model layers offloaded to the GPU.
+     * @param layers Number of layers (99 offloads the whole model).
+     */
+    void setGpuLayers(int layers);
+
+    /**
+     * @brief Enables or disables memory mapping of the model file.
+     * @param enable When false the weights are read into allocated memory instead.
+     */
+    void setUseMmap(bool enable);
+
+    /**
+     * @brief Enables or disables locking the model weights in RAM.
+     * @param enable When true the weights are mlocked and never paged out.
+     */
+    void setUseMlock(bool enable);
+
+    /**
+     * @brief Enables an explicit readahead of the GGUF file before loading.
+     * @param enable When true the file is pulled into the page cache ahead of the load.
+     */
+    void setReadahead(bool enable);
+
+    /**
+     * @brief Enables a warmup decode once the model and contexts are created.
+     * @param enable When true a short dummy decode runs so the first request does not
+     *               pay the page-fault and kernel initialisation cost.
+     */
+    void setWarmup(bool enable);
+
+    /**
+     * @brief Sets how many sequences a session context can decode in parallel.
+     * @param count Maximum number of completions generated together, applies to contexts created afterwards.
+     */
+    void setMaxSequences(int count);
+
+    /**
+     * @brief Sets the memory the model may use, checked against an estimate before loading.
+     * @param megabytes Budget in MB, 0 for the physical memory of the machine.
+     */
+    void setMemoryBudget(int megabytes);
+
+    /**
+     * @brief Sets how many sessions the automatic context size must leave room for.
+     * @param count Number of sessions, each with its own context.
+     */
+    void setExpectedSessions(int count);
+
+    // -------------------------------------------------------------------------------------
+    // Load Progress
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Defines a load progress callback type.
+     *
+     * Receives the load progress in the range [0, 1]. Returning false cancels the load.
+     */
+    using LoadProgressCallback = std::function<bool(float progress)>;
+
+    /**
+     * @brief Sets a callback receiving fractional progress while the model loads.
+     * @param callback A function receiving the progress, returning false to cancel.
+     */
+    void setLoadProgressCallback(LoadProgressCallback callback);
+
+    /**
+     * @brief Requests cancellation of a model load running on another thread.
+     *
+     * The load stops at the next progress report and loadModel returns false.
+     */
+    void cancelLoad();
+
+    /**
+     * @brief Checks whether the last load was stopped by a cancellation request.
+     * @return True if the load was cancelled, false otherwise.
+     */
+    bool isLoadCancelled() const;
+
+    // -------------------------------------------------------------------------------------
+    // LoRA Adapters
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Loads a LoRA adapter against the loaded base model.
+     *
+     * Adapters share the base weights, each one only costs its own tensors. A
+     * loaded adapter can then be selected per session or per request. Loading
+     * under the name of a loaded adapter replaces it, sessions selecting the
+     * name keep their scale and apply the new adapter on their next generation.
+     *
+     * @param name Name used to select the adapter.
+     * @param path Path to the adapter GGUF file.
+     * @return True if the adapter was loaded, false otherwise, also when it replaces
+     *         an adapter used by a pull generation in progress.
+     */
+    bool loadLoraAdapter(const std::string &name, const std::string &path);
+
+    /**
+     * @brief Unloads a LoRA adapter, sessions using it fall back to the base model.
+     * @param name Name of the adapter.
+     * @return True if the adapter was unloaded, false if it is unknown or a pull
+     *         generation using it is in progress.
+     */
+    bool unloadLoraAdapter(const std::string &name);
+
+    /**
+     * @brief Selects the LoRA adapter used by a session.
+     * @param session_id The ID of the session.
+     * @param name Name of a loaded adapter, empty for the base model.
+     * @param scale Scale applied to the adapter.
+     * @return True on success, false if the session or adapter is unknown.
+     */
+    bool setSessionLoraAdapter(int session_id, const std::string &name, float scale);
+
+    /**
+     * @brief Returns the sampler parameters of a session.
+     * @param session_id The ID of the session.
+     * @param settings Receives the session's sampler parameters.
+     * @return True on success, false if the session is unknown.
+     */
+    bool getSessionSampler(int session_id, SamplerSettings &settings);
+
+    /**
+     * @brief Replaces the sampler parameters of a session.
+     *
+     * Only the session's sampler chain is rebuilt, its context and KV cache are kept.
+     *
+     * @param session_id The ID of the session.
+     * @param settings The new sampler parameters.
+     * @return True on success, false if the session is unknown.
+     */
+    bool setSessionSampler(int session_id, const SamplerSettings &settings);
+
     // -------------------------------------------------------------------------------------
     // Response Generation
     // -------------------------------------------------------------------------------------
@@ -108,11 +262,121 @@ public:
                             const std::string &input_prompt,
                             void (*callback)(const char*, void *userData),
                             void *userData);
+
+    /**
+     * @brief Generates a response for a session with per request options.
+     *
+     * Same as generateResponse, the options can constrain the output with a GBNF
+     * grammar or a JSON schema for this request only.
+     *
+     * @param session_id The ID of the session to use for generating the response.
+     * @param input_prompt The text prompt provided by the user.
+     * @param options Options applied to this request.
+     * @param callback Function pointer for handling generated responses in chunks.
+     * @param userData Optional user-defined data passed to the callback.
+     * @return True if generation was successful, false otherwise.
+     */
+    bool generateResponse(int session_id,
+                            const std::string &input_prompt,
+                            const GenerationOptions &options,
+                            void (*callback)(const char*, void *userData),
+                            void *userData);
+    /**
+     * @brief Generates several alternative responses to one prompt.
+     *
+     * The prompt is prefilled once, its KV cache is shared with n sequences that
+     * are decoded together in one batch per step, each with its own sampler. The
+     * first completion becomes the session's response and history.
+     *
+     * @param session_id The ID of the session to use.
+     * @param input_prompt The text prompt provided by the user.
+     * @param n Number of completions, at most the max_sequences load parameter.
+     * @param options Options applied to every completion.
+     * @param responses Receives the n completions.
+     * @param reasons Receives the finish reason of each completion.
+     * @return True if generation was successful, false otherwise.
+     */
+    bool generateResponses(int session_id,
+                           const std::string &input_prompt,
+                           int n,
+                           const GenerationOptions &options,
+                           std::vector<std::string> &responses,
+                           std::vector<FinishReason> &reasons);
+
+    /**
+     * @brief Starts a generation that the caller advances with nextChunk.
+     *
+     * Prepares the prompt like generateResponse but decodes nothing yet, the
+     * prompt is decoded by the first nextChunk call. Until the generation ends
+     * no other generation can run on the session.
+     *
+     * @param session_id The ID of the session to use.
+     * @param input_prompt The text prompt provided by the user.
+     * @param options Options applied to this request.
+     * @return True if the generation was started, false otherwise.
+     */
+    bool startGeneration(int session_id,
+                         const std::string &input_prompt,
+                         const GenerationOptions &options);
+
+    /**
+     * @brief Generates the next chunk of a generation started with startGeneration.
+     *
+     * Decodes until some text is released, usually a single token. When the
+     * generation ends the response is added to the session's history and the
+     * finish reason is available from getFinishReason.
+     *
+     * @param session_id The ID of the session.
+     * @param chunk Receives the text of the chunk.
+     * @return 1 if a chunk was generated, 0 if the generation has ended, -1 on error.
+     */
+    int nextChunk(int session_id, std::string &chunk);
+
+    /**
+     * @brief Ends a generation started with startGeneration before it is complete.
+     *
+     * The text generated so far becomes the response with FINISH_CANCELLED.
+     *
+     * @param session_id The ID of the session.
+     * @return True if a generation was ended, false if none was in progress.
+     */
+    bool finishGeneration(int session_id);
+
+    /**
+     * @brief Stops the generation running on a session, callable from any thread.
+     *
+     * The generation ends before its next token with FINISH_CANCELLED and the text
+     * generated so far becomes the response. Unlike the other calls this one does
+     * not wait for the engine, it only raises a flag the decode loop checks.
+     *
+     * generateResponse, pull generations and generateResponses check the flag,
+     * completeInfill runs on no session and cannot be cancelled.
+     *
+     * @param session_id The ID of the session.
+     * @return True if the session exists, false otherwise.
+     */
+    bool cancelGeneration(int session_id);
+
+    /**
+     * @brief Drops a cancellation left by an earlier generation, callable from any thread.
+     *
+     * Called when a generation request enters the engine, before it waits for its
+     * turn, so a stop pressed while the request is queued is still honoured.
+     *
+     * @param session_id The ID of the session.
+     */
+    void clearCancelRequest(int session_id);
+
     /**
      * @brief Get the full response.
      */
     const std::string getResponse(int session_id);
 
+    /**
+     * @brief Get the reason the last generation of a session ended.
+     */
+    FinishReason getFinishReason(int session_id);
+
     /**
      * @brief Parses a GGUF file and extracts metadata.
      * @param filepath Path to the GGUF file.
@@ -121,6 +385,149 @@ public:
      */
     static GGUFMetadata parseGGUF(const std::string& filepath, void(*callback)(const char* message));
 
+    /**
+     * @brief Sets the bounds of the response cache.
+     *
+     * Responses of deterministic requests, greedy sampling without repetition
+     * penalties, are cached by model, options, session context and prompt. A hit
+     * is replayed through the stream callback without decoding.
+     *
+     * @param maxEntries Maximum number of cached responses, 0 disables the cache.
+     * @param maxBytes Maximum size of the cache in bytes, 0 for no limit.
+     * @param ttlSeconds Lifetime of a cached response in seconds, 0 for no expiry.
+     */
+    void setResponseCacheLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds);
+
+    // -------------------------------------------------------------------------------------
+    // Tokenizer
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Tokenizes a text with the model's vocabulary.
+     *
+     * Safe to call from several threads, the vocabulary is read only.
+     *
+     * @param text The text to tokenize.
+     * @param addSpecial Add the BOS/EOS tokens the model expects around a text.
+     * @param parseSpecial Parse special token text such as "<|im_start|>" into its token.
+     * @param tokens Receives the tokens, its capacity is reused.
+     * @return True on success, false if no model is loaded or tokenization failed.
+     */
+    bool tokenize(const std::string &text, bool addSpecial, bool parseSpecial, std::vector<llama_token> &tokens) const;
+
+    /**
+     * @brief Converts tokens back to text.
+     * @param tokens The tokens.
+     * @param count Number of tokens.
+     * @param removeSpecial Drop the BOS/EOS tokens added by tokenize.
+     * @param unparseSpecial Render special tokens as their text instead of omitting them.
+     * @param text Receives the text.
+     * @return True on success, false if no model is loaded or a token is invalid.
+     */
+    bool detokenize(const llama_token *tokens, size_t count, bool removeSpecial, bool unparseSpecial, std::string &text) const;
+
+    /**
+     * @brief Tokenizes many texts in parallel into one contiguous buffer.
+     *
+     * Texts are split into chunks tokenized on a worker pool shared by all calls,
+     * the tokens of text i are tokens[offsets[i]] to tokens[offsets[i + 1] - 1].
+     * A text that fails to tokenize is left empty.
+     *
+     * @param texts The texts to tokenize.
+     * @param addSpecial Add the BOS/EOS tokens the model expects around each text.
+     * @param parseSpecial Parse special token text into its token.
+     * @param tokens Receives the tokens of all texts.
+     * @param offsets Receives texts.size() + 1 offsets into tokens.
+     * @return True on success, false if no model is loaded.
+     */
+    bool tokenizeBatch(const std::vector<std::string> &texts, bool addSpecial, bool parseSpecial,
+                       std::vector<llama_token> &tokens, std::vector<size_t> &offsets);
+
+    // -------------------------------------------------------------------------------------
+    // Embeddings
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Computes pooled embeddings for many texts at once.
+     *
+     * The texts are packed as separate sequences into as few decode batches as possible,
+     * each sequence is pooled by llama and the results are written row by row into `output`.
+     *
+     * @param texts The texts to embed.
+     * @param pooling Pooling applied over the token embeddings (mean, CLS or last).
+     * @param normalize When true each vector is L2 normalized.
+     * @param output Caller provided buffer receiving texts.size() * embedding size floats.
+     * @param outputCapacity Number of floats available in `output`.
+     * @return The embedding size on success, -1 on failure, also when a text produces no tokens.
+     */
+    int embed(const std::vector<std::string> &texts,
+              enum llama_pooling_type pooling,
+              bool normalize,
+              float *output,
+              size_t outputCapacity);
+
+    /**
+     * @brief Returns the size of the embedding vectors produced by the loaded model.
+     * @return The embedding size, or -1 if no model is loaded.
+     */
+    int getEmbeddingSize() const;
+
+    // -------------------------------------------------------------------------------------
+    // Scoring
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Defines a callback receiving the log-probability of each scored token.
+     */
+    using TokenScoreCallback = std::function<void(size_t candidate, const std::string &piece, float logprob)>;
+
+    /**
+     * @brief Computes the log-likelihood of candidate continuations of a shared prefix.
+     *
+     * The prefix is decoded once, its KV cells are shared by all candidates, and the
+     * candidates are then evaluated together as parallel sequences in the same batch.
+     *
+     * @param prefix The shared prefix text.
+     * @param candidates The candidate continuations.
+     * @param totals Receives the summed log-probability of each candidate.
+     * @param tokenCallback Optional callback receiving every candidate token and its log-probability.
+     * @return True if scoring succeeded, false otherwise.
+     */
+    bool scoreContinuations(const std::string &prefix,
+                            const std::vector<std::string> &candidates,
+                            std::vector<float> &totals,
+                            TokenScoreCallback tokenCallback = nullptr);
+
+    // -------------------------------------------------------------------------------------
+    // Fill-in-the-middle
+    // -------------------------------------------------------------------------------------
+
+    /**
+     * @brief Completes the text between a prefix and a suffix with a code model.
+     *
+     * The prompt is laid out with the model's FIM special tokens as prefix, suffix,
+     * middle. A dedicated context keeps the tokens of the previous request, only the
+     * part of the prompt that differs from it is decoded again, so successive
+     * requests on the same file mostly reuse the cached prefix.
+     *
+     * @param prefix Text before the cursor.
+     * @param suffix Text after the cursor.
+     * @param options Options applied to the completion.
+     * @param callback Optional function receiving the completion in chunks.
+     * @param userData Optional user-defined data passed to the callback.
+     * @param completion Receives the completed middle text.
+     * @param reason Receives the reason the completion ended.
+     * @return True if the completion succeeded, false otherwise, including when
+     *         the model has no FIM tokens.
+     */
+    bool completeInfill(const std::string &prefix,
+                        const std::string &suffix,
+                        const GenerationOptions &options,
+                        void (*callback)(const char*, void *userData),
+                        void *userData,
+                        std::string &completion,
+                        FinishReason &reason);
+
     // -------------------------------------------------------------------------------------
     // Context
     // -------------------------------------------------------------------------------------
@@ -214,8 +621,179 @@ private:
      */
     bool generate(LlamaSession *session,
                   const std::string &prompt,
+                  const GenerationOptions &options,
                   void (*callback)(const char*, void *),
                   void *userData);
+
+    /**
+     * @brief Prepares a stream for the prompt: samplers, stop strings, limits and prompt tokens.
+     * @return True on success, false if the grammar is invalid or the prompt cannot be tokenized.
+     */
+    bool beginGeneration(LlamaSession *session,
+                         const std::string &prompt,
+                         const GenerationOptions &options,
+                         GenerationStream &stream);
+
+    /**
+     * @brief Decodes the pending batch of a stream and samples one token.
+     *
+     * Sets stream.finished and the session's finish reason when the generation ends.
+     *
+     * @param output Receives the text released by this token, may be empty.
+     * @return True on success, false if decoding failed.
+     */
+    bool stepGeneration(LlamaSession *session, GenerationStream &stream, std::string &output);
+
+    /**
+     * @brief Marks a stream finished and appends the withheld text to output.
+     */
+    void endGeneration(LlamaSession *session, GenerationStream &stream, std::string &output);
+
+    /**
+     * @brief Completes the turn of the session's pull generation and releases its stream.
+     */
+    void endStream(LlamaSession *session);
+
+    /**
+     * @brief Returns false and sets the error if a pull generation is in progress on the session.
+     */
+    bool checkIdle(LlamaSession *session);
+
+    /**
+     * @brief Returns false and sets the error if a pull generation runs on a context using the adapter.
+     *
+     * Detaching an adapter clears the KV cache of those contexts, the next chunk
+     * of the generation would be decoded without its prompt.
+     */
+    bool checkLoraAdapterIdle(const std::string &name);
+
+    /**
+     * @brief Removes a LoRA adapter from the contexts it is set on, leaving the session selections.
+     */
+    void detachLoraAdapter(const std::string &name);
+
+    /**
+     * @brief Caches the session's response if it ended deterministically.
+     */
+    void storeResponse(LlamaSession *session, const std::string &cacheKey);
+
+    /**
+     * @brief Adds the session's response to its chat history and context hash.
+     */
+    void addResponseToHistory(LlamaSession *session, const std::string &prompt);
+
+    /**
+     * @brief Creates the grammar sampler requested by the options.
+     *
+     * Parsed grammars are cached by their text, a request gets a fresh clone of the
+     * cached sampler so the grammar is only parsed once.
+     *
+     * @param options The request options holding a grammar or a JSON schema.
+     * @param grammar Receives the grammar sampler, nullptr if the request is unconstrained.
+     * @return True on success, false if the grammar or schema is invalid.
+     */
+    bool createGrammarSampler(const GenerationOptions &options, llama_sampler *&grammar);
+
+    /**
+     * @brief Creates a sampler chain with the runtime's default parameters.
+     * @param seed Seed of the distribution sampler, LLAMA_DEFAULT_SEED for a random seed.
+     * @return The new sampler chain, owned by the caller.
+     */
+    llama_sampler *createSamplerChain(uint32_t seed = LLAMA_DEFAULT_SEED);
+
+    /**
+     * @brief Creates a sampler chain.
+     * @param settings The sampler parameters, a seed of -1 selects a random seed.
+     * @return The new sampler chain, owned by the caller.
+     */
+    llama_sampler *createSamplerChain(const SamplerSettings &settings);
+
+    /**
+     * @brief Returns the sampler parameters of a request.
+     * @param base The session's or runtime's parameters.
+     * @param options The request options, whose sampler overrides are applied to the base.
+     */
+    SamplerSettings requestSampler(const SamplerSettings &base, const GenerationOptions &options);
+
+    /**
+     * @brief Returns the response cache key of a request.
+     *
+     * The key covers the model, the effective sampler and generation options, the
+     * text already in the session's KV cache and the prompt.
+     *
+     * @param session The session the request runs on.
+     * @param options The request options.
+     * @param prompt The formatted prompt.
+     * @return The key, empty if the request is not deterministic or the cache is disabled.
+     */
+    std::string responseCacheKey(LlamaSession *session, const GenerationOptions &options, const std::string &prompt);
+
+    /**
+     * @brief Samples the next token from the logits at a batch index.
+     *
+     * Without a grammar this applies the session sampler chain. With a grammar the
+     * token sampled by the chain is checked alone first and the grammar is applied to
+     * the whole vocabulary only when that token is rejected, which keeps the constraint
+     * check out of the common path. A greedy chain takes the argmax of the logits
+     * without building the candidate array.
+     *
+     * @param session The session owning the context and sampler chain.
+     * @param grammar Optional grammar sampler constraining the output.
+     * @param idx Batch index of the logits to sample from.
+     * @return The sampled token.
+     */
+    llama_token sampleToken(LlamaSession *session, llama_sampler *grammar, int idx);
+
+    /**
+     * @brief Samples a token with an explicit sampler chain, see sampleToken.
+     */
+    llama_token sampleToken(llama_context *ctx, llama_sampler *chain, llama_sampler *grammar,
+                            std::vector<llama_token_data> &candidates, int idx);
+
+    /**
+     * @brief Sets the LoRA adapter on a context if it differs from the applied one.
+     *
+     * The KV cache is cleared when the adapter changes since it was computed with
+     * other weights.
+     *
+     * @param ctx The context.
+     * @param name Adapter name, empty for the base model.
+     * @param scale Adapter scale.
+     * @param appliedName Name of the adapter set on the context, updated.
+     * @param appliedScale Scale of the adapter set on the context, updated.
+     * @return True on success, false if the adapter is unknown or cannot be set.
+     */
+    bool applyLoraAdapter(llama_context *ctx, const std::string &name, float scale,
+                          std::string &appliedName, float &appliedScale);
+
+    /**
+     * @brief Applies the per request or session LoRA adapter to a session context.
+     */
+    bool applySessionLoraAdapter(LlamaSession *session, const GenerationOptions &options);
+
+    /**
+     * @brief Adds the user input to the session history and formats the chat prompt.
+     * @param session The session receiving the message.
+     * @param input_prompt The text prompt provided by the user.
+     * @param prompt Receives the formatted prompt.
+     * @return True on success, false if the chat template could not be applied.
+     */
+    bool applyChatTemplate(LlamaSession *session, const std::string &input_prompt, std::string &prompt);
+
+    /**
+     * @brief Decodes n completions of a prompt in parallel sequences.
+     * @param session The session providing the context.
+     * @param prompt The formatted prompt.
+     * @param n Number of completions.
+     * @param options Options applied to every completion.
+     * @param responses Receives the completions.
+     * @param reasons Receives the finish reason of each completion.
+     * @return True if successful, false otherwise.
+     */
+    bool generateParallel(LlamaSession *session, const std::string &prompt, int n,
+                          const GenerationOptions &options,
+                          std::vector<std::string> &responses,
+                          std::vector<FinishReason> &reasons);
     /**
      * @brief Tokenizes an input prompt before feeding it to the model.
      * @param prompt The text to tokenize.
@@ -224,6 +802,32 @@ private:
      */
     std::vector<llama_token> tokenizePrompt(const std::string &prompt, bool is_first);
 
+    /**
+     * @brief Asks the operating system to read a file into the page cache.
+     * @param path Path of the file to read ahead.
+     * @return True if the readahead was issued, false otherwise.
+     */
+    bool readaheadFile(const std::string &path);
+
+    /**
+     * @brief Estimates the memory of the model before loading it.
+     *
+     * Picks the largest context fitting the memory budget when the context size
+     * is 0, and rejects a fixed context size that exceeds an explicit budget.
+     *
+     * @param modelPath Path of the GGUF file.
+     * @param n_ctx Requested context size, receives the automatic one.
+     * @return False if the header cannot be read or the model does not fit.
+     */
+    bool fitMemoryBudget(const std::string &modelPath, int &n_ctx);
+
+    /**
+     * @brief Runs a short dummy decode on a context and clears it afterwards.
+     * @param ctx The context to warm up.
+     * @return True if the warmup decode succeeded, false otherwise.
+     */
+    bool warmupContext(llama_context *ctx);
+
     // -------------------------------------------------------------------------------------
     // Model Data Members
     // -------------------------------------------------------------------------------------
@@ -231,6 +835,28 @@ private:
     llama_model *model = nullptr;  ///< Pointer to the loaded model.
     const llama_vocab *vocab = nullptr; ///< Pointer to model vocabulary.
 
+    llama_context *embeddingCtx = nullptr; ///< Context dedicated to embeddings, created on first use.
+    enum llama_pooling_type embeddingPooling = LLAMA_POOLING_TYPE_UNSPECIFIED; ///< Pooling of the embedding context.
+    static const int maxEmbeddingSequences = 64; ///< Maximum number of texts packed into one batch.
+
+    std::unordered_map<std::string, llama_sampler*> grammarCache; ///< Parsed grammar samplers keyed by root and grammar text.
+
+    llama_context *scoringCtx = nullptr; ///< Context dedicated to continuation scoring, created on first use.
+    static const int maxScoringSequences = 64; ///< Prefix sequence plus candidates evaluated together.
+
+    std::unordered_map<std::string, llama_adapter_lora*> loraAdapters; ///< Loaded LoRA adapters by name.
+
+    llama_context *fimCtx = nullptr; ///< Context dedicated to fill-in-the-middle, created on first use.
+    std::string fimLoraAdapter; ///< LoRA adapter set on the FIM context.
+    float fimLoraScale = 0.0f; ///< Scale of the LoRA adapter set on the FIM context.
+    std::vector<llama_token> fimTokens; ///< Tokens held in the KV cache of the FIM context.
+    std::vector<llama_token_data> fimCandidates; ///< Reusable candidate buffer for FIM sampling.
+
+    std::unique_ptr<ThreadPool> tokenizerPool; ///< Workers of tokenizeBatch, started on first use.
+    std::once_flag tokenizerPoolOnce; ///< Starts tokenizerPool once.
+
+    ResponseCache responseCache; ///< Responses of deterministic requests, disabled by default.
+
     /**
      * @brief Llama model version (retrieved from git describe).
      * Run the command '$ git describe' in the llama.cpp repository to obtain this value.
@@ -267,22 +893,32 @@ private:
      * own context and sampler for text generation.
      */
     std::unordered_map<int, LlamaSession*> sessions;
+    std::mutex sessionsMutex; ///< Guards changes to sessions against cancelGeneration on other threads.
 
     // -------------------------------------------------------------------------------------
     // Model Configuration Parameters
     // -------------------------------------------------------------------------------------
 
-    float temperature = 0.8f;      ///< Controls randomness in generation.
+    SamplerSettings samplerSettings; ///< Sampler parameters of new sessions.
     int context_size = 4096;       ///< Number of tokens the model remembers.
     std::string modelPath;         ///< Path to the model file.
-    float topK = 40;               ///< Limits sampling to top-K probable tokens.
-    float topP = 1.0;              ///< Nucleus sampling threshold.
-    float repetitionPenalty = 1.0f; ///< Penalty factor for repeated tokens.
+
+    int gpuLayers = 99;            ///< Number of layers offloaded to the GPU.
+    bool useMmap = true;           ///< Memory map the model file.
+    bool useMlock = false;         ///< Lock the model weights in RAM.
+    bool readahead = false;        ///< Read the model file ahead into the page cache.
+    bool warmup = false;           ///< Run a warmup decode after loading.
+    int maxSequences = 4;          ///< Parallel sequences per session context, bounds n completions.
+    int memoryBudgetMb = 0;        ///< Memory the model may use, 0 for the physical memory.
+    int expectedSessions = 1;      ///< Sessions sized for by the automatic context size.
 
     /**
      * @brief Callback function for handling log messages.
      */
     LogCallback logCallback;
+
+    LoadProgressCallback loadProgressCallback; ///< Receives model load progress.
+    std::atomic<bool> loadCancelled{false};    ///< Set when a load cancellation is requested.
 };
 
 #endif // LlamaRuntime_h
@@ -3,6 +3,9 @@
 
 #include <list>
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <ctime>
 
 #ifdef WIN32
@@ -63,6 +66,8 @@ struct UUID {
 #include "gguf.h"
 
 #include "PromptResponse.h"
+#include "GenerationOptions.h"
+#include "GenerationStream.h"
 
 /**
  * @brief Represents an interactive session with the Llama model.
@@ -89,6 +94,21 @@ public:
     std::vector<char> formatted;              ///< Formatted message buffer.
     std::string response;                     ///< Last generated response.
 
+    std::vector<llama_token_data> candidates; ///< Reusable candidate buffer for sampling.
+    SamplerSettings sampler;                  ///< Parameters of the session's sampler chain.
+
+    uint64_t contextHash = 0;                 ///< Hash of the text in the KV cache, part of response cache keys.
+    std::string pendingPrefill;               ///< Text of cached turns not yet decoded into the KV cache.
+
+    FinishReason finishReason = FINISH_EOG;   ///< Why the last generation ended.
+    std::unique_ptr<GenerationStream> stream; ///< Generation advanced by nextChunk, null when none is in progress.
+    std::atomic<bool> cancelRequested{false}; ///< Set from another thread to stop the running generation.
+
+    std::string loraAdapter;                  ///< Name of the LoRA adapter selected for the session, empty for the base model.
+    float loraScale = 1.0f;                   ///< Scale of the selected LoRA adapter.
+    std::string appliedLoraAdapter;           ///< LoRA adapter currently set on the context.
+    float appliedLoraScale = 0.0f;            ///< Scale of the LoRA adapter currently set on the context.
+
     /**
      * @brief Creates a new LlamaSession with a unique session ID.
      *
@@ -153,6 +173,9 @@ public:
         }
 
         messages.clear();
+        stream.reset();
+        contextHash = 0;
+        pendingPrefill.clear();
 
         //Explicitly Clear the KV Cache
         llama_kv_cache_clear(ctx);
@@ -0,0 +1,157 @@
+#include "MemoryEstimator.h"
+#include "GGUFReader.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint64_t kvElementBytes = 2;      // f16 keys and values
+const uint64_t activationBytes = 4;     // f32 activations and logits
+const uint64_t microBatch = 512;        // llama.cpp default n_ubatch
+const uint64_t kvCellPadding = 32;      // KV cache size granularity without flash attention
+const int contextStep = 256;
+const int unknownContextLimit = 32768;  // search limit when the trained length is absent
+
+// Reads a per-layer hyperparameter stored either as a scalar or as one value per layer
+std::vector<uint64_t> layerValues(const GGUFReader &reader, const std::string &key, size_t layers, uint64_t fallback) {
+    std::vector<double> values;
+    if (reader.getNumberArray(key, values) && values.size() == layers) {
+        std::vector<uint64_t> result(layers);
+        for (size_t i = 0; i < layers; i++)
+            result[i] = (uint64_t)std::max(values[i], 0.0);
+        return result;
+    }
+
+    int64_t value;
+    if (!reader.getInt(key, value) || value < 0)
+        value = (int64_t)fallback;
+    return std::vector<uint64_t>(layers, (uint64_t)value);
+}
+
+} // namespace
+
+bool MemoryEstimator::open(const std::string &path) {
+    *this = MemoryEstimator();
+
+    GGUFReader reader;
+    if (!reader.open(path)) {
+        error_ = reader.error();
+        return false;
+    }
+
+    // A tensor spans up to the next one, the last one up to the end of the file
+    std::vector<uint64_t> offsets;
+    offsets.reserve(reader.tensors().size());
+    for (const auto &tensor : reader.tensors())
+        offsets.push_back(tensor.offset);
+    std::sort(offsets.begin(), offsets.end());
+    if (!offsets.empty())
+        weightBytes_ = reader.fileSize() - reader.dataOffset() - offsets.front();
+
+    std::string_view text;
+    const std::string architecture = reader.getString("general.architecture", text) ? std::string(text) : std::string();
+
+    int64_t value = 0;
+    const size_t layers = reader.getInt(architecture + ".block_count", value) && value > 0 ? (size_t)value : 0;
+    if (reader.getInt(architecture + ".context_length", value) && value > 0)
+        trainedContextLength_ = (int)std::min<int64_t>(value, 1 << 30);
+    if (reader.getInt(architecture + ".embedding_length", value) && value > 0)
+        embeddingLength_ = (uint64_t)value;
+
+    if (const GGUFReader::Value *tokens = reader.find("tokenizer.ggml.tokens"))
+        vocabularySize_ = tokens->type == GGUFReader::ARRAY ? tokens->count : 0;
+
+    if (layers == 0)
+        return true;
+
+    const std::vector<uint64_t> heads = layerValues(reader, architecture + ".attention.head_count", layers, 0);
+    const std::vector<uint64_t> kvHeads = layerValues(reader, architecture + ".attention.head_count_kv", layers, 0);
+    const std::vector<uint64_t> feedForward = layerValues(reader, architecture + ".feed_forward_length", layers, 0);
+
+    headCount_ = *std::max_element(heads.begin(), heads.end());
+    feedForwardLength_ = *std::max_element(feedForward.begin(), feedForward.end());
+
+    // Head dimensions default to the embedding width split over the heads
+    const uint64_t headDim = headCount_ > 0 ? embeddingLength_ / headCount_ : 0;
+    const uint64_t keyLength = layerValues(reader, architecture + ".attention.key_length", 1, headDim)[0];
+    const uint64_t valueLength = layerValues(reader, architecture + ".attention.value_length", 1, headDim)[0];
+
+    // Models without head_count_kv use plain multi-head attention
+    for (size_t i = 0; i < layers; i++) {
+        const uint64_t kvHeadCount = reader.find(architecture + ".attention.head_count_kv") ? kvHeads[i] : heads[i];
+        kvValuesPerToken_ += kvHeadCount * (keyLength + valueLength);
+    }
+
+    return true;
+}
+
+MemoryEstimator::Estimate MemoryEstimator::estimate(int contextSize, int sessionCount, int sequences) const {
+    Estimate result;
+    result.contextSize = std::max(contextSize, 1);
+    result.sessionCount = std::max(sessionCount, 0);
+
+    const uint64_t sessions = (uint64_t)result.sessionCount;
+    const uint64_t cells = ((uint64_t)result.contextSize + kvCellPadding - 1) / kvCellPadding * kvCellPadding;
+    const uint64_t tokens = std::min(microBatch, cells);
+
+    // The graph allocator reuses memory between layers, the largest tensors of one
+    // micro batch dominate: logits, attention scores and the feed-forward activations
+    const uint64_t compute = activationBytes * tokens *
+                             (vocabularySize_ + headCount_ * cells + 4 * embeddingLength_ + 2 * feedForwardLength_);
+    const uint64_t output = activationBytes * vocabularySize_ * (uint64_t)std::max(sequences, 1);
+
+    result.weightBytes = weightBytes_;
+    result.kvCacheBytes = sessions * kvElementBytes * kvValuesPerToken_ * cells;
+    result.computeBytes = sessions * (compute + output);
+    result.totalBytes = result.weightBytes + result.kvCacheBytes + result.computeBytes;
+    return result;
+}
+
+int MemoryEstimator::fitContextSize(uint64_t budgetBytes, int sessionCount, int sequences) const {
+    const int limit = trainedContextLength_ > 0 ? trainedContextLength_ : unknownContextLimit;
+
+    // The estimate grows with the context, bisect over multiples of the step
+    int low = 0;
+    int high = std::max(limit / contextStep, 1);
+    while (low < high) {
+        const int middle = (low + high + 1) / 2;
+        if (estimate(middle * contextStep, sessionCount, sequences).totalBytes <= budgetBytes)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    // A trained length below the step still fits as is
+    if (low == 0 && limit < contextStep && estimate(limit, sessionCount, sequences).totalBytes <= budgetBytes)
+        return limit;
+    return std::min(low * contextStep, limit);
+}
+
+int MemoryEstimator::fitSessionCount(uint64_t budgetBytes, int contextSize, int sequences) const {
+    if (budgetBytes < weightBytes_)
+        return 0;
+
+    const uint64_t session = estimate(contextSize, 1, sequences).totalBytes - weightBytes_;
+    if (session == 0)
+        return 0;
+    return (int)std::min<uint64_t>((budgetBytes - weightBytes_) / session, 1 << 20);
+}
+
+uint64_t MemoryEstimator::physicalMemory() {
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? (uint64_t)status.ullTotalPhys : 0;
+#else
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGE_SIZE);
+    return pages > 0 && pageSize > 0 ? (uint64_t)pages * (uint64_t)pageSize : 0;
+#endif
+}
@@ -0,0 +1,95 @@
+#ifndef MemoryEstimator_h
+#define MemoryEstimator_h
+
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief Predicts the memory a model needs before it is loaded.
+ *
+ * The weight size is the sum of the tensor data sizes recorded in the GGUF
+ * header, the KV cache follows from the layer count and the key/value head
+ * dimensions, and the compute buffer is approximated from the largest tensors
+ * of one micro batch. The numbers describe the contexts LlamaRuntime creates:
+ * an f16 KV cache, no flash attention, micro batches of 512 tokens and one
+ * context per session. Weights are counted once whether they live in RAM or
+ * are offloaded to a GPU.
+ */
+class MemoryEstimator {
+public:
+    /**
+     * @brief Memory needed for one configuration, in bytes.
+     */
+    struct Estimate {
+        uint64_t weightBytes = 0;   ///< Model weights, shared by all sessions.
+        uint64_t kvCacheBytes = 0;  ///< KV cache of all sessions.
+        uint64_t computeBytes = 0;  ///< Compute and output buffers of all sessions.
+        uint64_t totalBytes = 0;
+        int contextSize = 0;
+        int sessionCount = 0;
+    };
+
+    /**
+     * @brief Reads the tensor sizes and hyperparameters of a model file.
+     * @param path Path to the GGUF file.
+     * @return True on success, false if the header cannot be read, see error().
+     */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Returns the reason the last open failed.
+     */
+    const std::string &error() const { return error_; }
+
+    /**
+     * @brief Returns the context length the model was trained with, 0 if unknown.
+     */
+    int trainedContextLength() const { return trainedContextLength_; }
+
+    /**
+     * @brief Predicts the memory of a configuration.
+     * @param contextSize Context size of each session in tokens.
+     * @param sessionCount Number of sessions, each with its own context.
+     * @param sequences Parallel sequences per context, sizes the logits buffer.
+     */
+    Estimate estimate(int contextSize, int sessionCount, int sequences = 4) const;
+
+    /**
+     * @brief Finds the largest context size fitting a memory budget.
+     *
+     * Candidates are multiples of 256 up to the trained context length.
+     *
+     * @param budgetBytes Memory available to the model.
+     * @param sessionCount Number of sessions that must fit.
+     * @param sequences Parallel sequences per context.
+     * @return The context size, 0 if not even 256 tokens fit.
+     */
+    int fitContextSize(uint64_t budgetBytes, int sessionCount, int sequences = 4) const;
+
+    /**
+     * @brief Finds the largest number of sessions fitting a memory budget.
+     * @param budgetBytes Memory available to the model.
+     * @param contextSize Context size of each session.
+     * @param sequences Parallel sequences per context.
+     * @return The session count, 0 if not even one session fits.
+     */
+    int fitSessionCount(uint64_t budgetBytes, int contextSize, int sequences = 4) const;
+
+    /**
+     * @brief Returns the physical memory of the machine, 0 if it cannot be queried.
+     */
+    static uint64_t physicalMemory();
+
+private:
+    std::string error_;
+
+    uint64_t weightBytes_ = 0;
+    uint64_t kvValuesPerToken_ = 0;  ///< Key and value elements of one token over all layers.
+    uint64_t embeddingLength_ = 0;
+    uint64_t feedForwardLength_ = 0;
+    uint64_t headCount_ = 0;
+    uint64_t vocabularySize_ = 0;
+    int trainedContextLength_ = 0;
+};
+
+#endif // MemoryEstimator_h
@@ -0,0 +1,210 @@
+#include "ModelCatalog.h"
+#include "GGUFReader.h"
+#include "JsonValue.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+const int indexVersion = 1;
+
+bool byPath(const ModelCatalog::Entry &a, const ModelCatalog::Entry &b) {
+    return a.path < b.path;
+}
+
+JsonValue toJson(const ModelCatalog::Entry &entry) {
+    JsonValue value = JsonValue::object();
+    value.set("path", entry.path);
+    value.set("size", (double)entry.size);
+    value.set("modified", entry.modified);
+    value.set("valid", entry.valid);
+    if (!entry.error.empty())
+        value.set("error", entry.error);
+    value.set("name", entry.name);
+    value.set("architecture", entry.architecture);
+    value.set("file_type", (long long)entry.fileType);
+    value.set("context_length", (long long)entry.contextLength);
+    value.set("embedding_length", (long long)entry.embeddingLength);
+    value.set("block_count", (long long)entry.blockCount);
+    value.set("vocabulary_size", (double)entry.vocabularySize);
+    value.set("tensor_count", (double)entry.tensorCount);
+    value.set("parameter_count", (double)entry.parameterCount);
+    return value;
+}
+
+bool fromJson(const JsonValue &value, ModelCatalog::Entry &entry) {
+    if (!value.isObject() || value.getString("path").empty())
+        return false;
+
+    entry.path = value.getString("path");
+    entry.size = (uint64_t)value.getNumber("size");
+    entry.modified = value.getString("modified");
+    const JsonValue *valid = value.get("valid");
+    entry.valid = valid && valid->isBool() && valid->boolValue;
+    entry.error = value.getString("error");
+    entry.name = value.getString("name");
+    entry.architecture = value.getString("architecture");
+    entry.fileType = (int64_t)value.getNumber("file_type", -1);
+    entry.contextLength = (int64_t)value.getNumber("context_length");
+    entry.embeddingLength = (int64_t)value.getNumber("embedding_length");
+    entry.blockCount = (int64_t)value.getNumber("block_count");
+    entry.vocabularySize = (uint64_t)value.getNumber("vocabulary_size");
+    entry.tensorCount = (uint64_t)value.getNumber("tensor_count");
+    entry.parameterCount = (uint64_t)value.getNumber("parameter_count");
+    return true;
+}
+
+} // namespace
+
+bool ModelCatalog::load(const std::string &indexPath) {
+    entries_.clear();
+
+    std::ifstream file(indexPath, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    JsonValue index;
+    if (!JsonValue::parse(text.str(), index) || index.getNumber("version") != indexVersion)
+        return false;
+
+    const JsonValue *models = index.get("models");
+    if (!models || !models->isArray())
+        return false;
+
+    for (const JsonValue &model : models->arrayValue) {
+        Entry entry;
+        if (fromJson(model, entry))
+            entries_.push_back(std::move(entry));
+    }
+    std::sort(entries_.begin(), entries_.end(), byPath);
+    return true;
+}
+
+bool ModelCatalog::save(const std::string &indexPath) const {
+    JsonValue models = JsonValue::array();
+    for (const Entry &entry : entries_)
+        models.append(toJson(entry));
+
+    JsonValue index = JsonValue::object();
+    index.set("version", indexVersion);
+    index.set("models", std::move(models));
+
+    // Written next to the index and renamed over it, a reader never sees a partial index
+    const std::string temporaryPath = indexPath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file << index.dump() << '\n';
+        if (!file.flush())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, indexPath, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+int ModelCatalog::scan(const std::string &directory) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    fs::directory_iterator it(directory, error);
+    if (error)
+        return -1;
+
+    std::unordered_map<std::string, const Entry *> known;
+    for (const Entry &entry : entries_)
+        known[entry.path] = &entry;
+
+    // Listing and stat only, unchanged files are not opened
+    std::vector<Entry> scanned;
+    std::vector<size_t> changed;
+    for (; it != fs::directory_iterator(); it.increment(error)) {
+        if (error)
+            return -1;
+
+        const fs::directory_entry &file = *it;
+        if (!file.is_regular_file(error) || file.path().extension() != ".gguf")
+            continue;
+
+        Entry entry;
+        // Normalized so "models", "models/" or paths through ".." give the same key
+        entry.path = fs::weakly_canonical(file.path(), error).string();
+        entry.size = (uint64_t)file.file_size(error);
+        entry.modified = std::to_string(file.last_write_time(error).time_since_epoch().count());
+
+        auto found = known.find(entry.path);
+        if (found != known.end() && found->second->size == entry.size && found->second->modified == entry.modified) {
+            scanned.push_back(*found->second);
+        }
+        else {
+            changed.push_back(scanned.size());
+            scanned.push_back(std::move(entry));
+        }
+    }
+
+    if (!changed.empty()) {
+        ThreadPool pool((unsigned)std::min<size_t>(changed.size(), std::max(1u, std::thread::hardware_concurrency())));
+        pool.run(changed.size(), [&](size_t i) {
+            Entry &entry = scanned[changed[i]];
+            readEntry(entry.path, entry);
+        });
+    }
+
+    std::sort(scanned.begin(), scanned.end(), byPath);
+    entries_ = std::move(scanned);
+    return (int)changed.size();
+}
+
+const ModelCatalog::Entry *ModelCatalog::find(const std::string &path) const {
+    Entry key;
+    key.path = path;
+    auto found = std::lower_bound(entries_.begin(), entries_.end(), key, byPath);
+    return (found != entries_.end() && found->path == path) ? &*found : nullptr;
+}
+
+void ModelCatalog::readEntry(const std::string &path, Entry &entry) {
+    entry.name = std::filesystem::path(path).stem().string();
+
+    GGUFReader reader;
+    if (!reader.open(path)) {
+        entry.valid = false;
+        entry.error = reader.error();
+        return;
+    }
+
+    std::string_view text;
+    if (reader.getString("general.name", text) && !text.empty())
+        entry.name = std::string(text);
+    if (reader.getString("general.architecture", text))
+        entry.architecture = std::string(text);
+
+    reader.getInt("general.file_type", entry.fileType);
+    reader.getInt(entry.architecture + ".context_length", entry.contextLength);
+    reader.getInt(entry.architecture + ".embedding_length", entry.embeddingLength);
+    reader.getInt(entry.architecture + ".block_count", entry.blockCount);
+
+    if (const GGUFReader::Value *tokens = reader.find("tokenizer.ggml.tokens"))
+        entry.vocabularySize = tokens->type == GGUFReader::ARRAY ? tokens->count : 0;
+
+    entry.tensorCount = reader.tensors().size();
+    entry.parameterCount = 0;
+    for (const auto &tensor : reader.tensors())
+        entry.parameterCount += tensor.elementCount();
+
+    entry.valid = true;
+    entry.error.clear();
+}
@@ -0,0 +1,86 @@
+#ifndef ModelCatalog_h
+#define ModelCatalog_h
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Index of the GGUF models in a directory.
+ *
+ * Metadata is extracted once per file with GGUFReader and kept in a JSON index
+ * keyed by path, size and modification time. A scan only lists the directory
+ * and compares those three values, files whose entry still matches are not
+ * opened, so a warm scan costs a stat per model. New and changed files are
+ * read in parallel.
+ */
+class ModelCatalog {
+public:
+    /**
+     * @brief Metadata of one model file.
+     */
+    struct Entry {
+        std::string path;             ///< Absolute path of the file.
+        uint64_t size = 0;            ///< File size in bytes.
+        std::string modified;         ///< Modification time in file clock ticks, compared for equality only.
+
+        bool valid = false;           ///< The GGUF header was read successfully.
+        std::string error;            ///< Why the header could not be read.
+
+        std::string name;             ///< general.name, or the file name.
+        std::string architecture;     ///< general.architecture
+        int64_t fileType = -1;        ///< general.file_type, the quantization of the weights.
+        int64_t contextLength = 0;    ///< Training context length.
+        int64_t embeddingLength = 0;  ///< Width of the hidden state.
+        int64_t blockCount = 0;       ///< Number of transformer blocks.
+        uint64_t vocabularySize = 0;  ///< Number of tokens, from the array length without decoding it.
+        uint64_t tensorCount = 0;
+        uint64_t parameterCount = 0;  ///< Sum of the element counts of all tensors.
+    };
+
+    /**
+     * @brief Reads an index written by save, a missing or invalid index leaves the catalogue empty.
+     * @param indexPath Path of the index file.
+     * @return True if the index was read.
+     */
+    bool load(const std::string &indexPath);
+
+    /**
+     * @brief Writes the index, replacing the file atomically.
+     * @param indexPath Path of the index file.
+     * @return True on success.
+     */
+    bool save(const std::string &indexPath) const;
+
+    /**
+     * @brief Brings the catalogue in line with the .gguf files of a directory.
+     *
+     * Entries of removed files are dropped, new and changed files are read.
+     *
+     * @param directory The models directory, not searched recursively.
+     * @return The number of files that had to be read, -1 if the directory cannot be listed.
+     */
+    int scan(const std::string &directory);
+
+    /**
+     * @brief Returns the entries sorted by path.
+     */
+    const std::vector<Entry> &entries() const { return entries_; }
+
+    /**
+     * @brief Returns the entry of a file, nullptr if it is not in the catalogue.
+     */
+    const Entry *find(const std::string &path) const;
+
+    /**
+     * @brief Reads the metadata of one model file.
+     * @param path Path of the GGUF file.
+     * @param entry Receives the metadata, valid is false if the header cannot be read.
+     */
+    static void readEntry(const std::string &path, Entry &entry);
+
+private:
+    std::vector<Entry> entries_;
+};
+
+#endif // ModelCatalog_h
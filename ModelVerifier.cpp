@@ -0,0 +1,240 @@
+#include "ModelVerifier.h"
+#include "GGUFReader.h"
+#include "Sha256.h"
+#include "ThreadPool.h"
+
+#include "ggml.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <vector>
+
+namespace {
+
+const size_t readSize = 8 * 1024 * 1024;
+
+std::string normalizedDigest(const std::string &digest) {
+    std::string text;
+    for (char c : digest) {
+        if (!std::isspace((unsigned char)c))
+            text += (char)std::tolower((unsigned char)c);
+    }
+    return text;
+}
+
+} // namespace
+
+bool ModelVerifier::checkTensors(const std::string &path) {
+    error_.clear();
+
+    GGUFReader reader;
+    if (!reader.open(path))
+        return fail(reader.error());
+
+    int64_t alignment = 32;
+    reader.getInt("general.alignment", alignment);
+    if (alignment <= 0)
+        return fail("Invalid alignment " + std::to_string(alignment));
+
+    if (reader.dataOffset() > reader.fileSize())
+        return fail("File ends before the tensor data, the file is truncated");
+    const uint64_t dataSize = reader.fileSize() - reader.dataOffset();
+
+    struct Span {
+        uint64_t begin;
+        uint64_t end;
+        std::string_view name;
+    };
+    std::vector<Span> spans;
+    spans.reserve(reader.tensors().size());
+
+    for (const auto &tensor : reader.tensors()) {
+        const std::string name(tensor.name);
+        const ggml_type type = (ggml_type)tensor.type;
+
+        if (tensor.type >= GGML_TYPE_COUNT || ggml_blck_size(type) <= 0)
+            return fail("Tensor " + name + " has unknown type " + std::to_string(tensor.type));
+
+        const int64_t rowLength = tensor.dims.empty() ? 1 : (int64_t)tensor.dims[0];
+        if (rowLength < 0 || rowLength % ggml_blck_size(type) != 0)
+            return fail("Tensor " + name + " has a row length that is not a multiple of the " +
+                        ggml_type_name(type) + " block size");
+
+        if (tensor.offset % (uint64_t)alignment != 0)
+            return fail("Tensor " + name + " is not aligned to " + std::to_string(alignment) + " bytes");
+
+        uint64_t size = ggml_row_size(type, rowLength);
+        for (size_t i = 1; i < tensor.dims.size(); i++) {
+            if (tensor.dims[i] != 0 && size > UINT64_MAX / tensor.dims[i])
+                return fail("Tensor " + name + " has an invalid shape");
+            size *= tensor.dims[i];
+        }
+
+        if (tensor.offset > dataSize || size > dataSize - tensor.offset)
+            return fail("Tensor " + name + " extends past the end of the file, the file is truncated");
+
+        spans.push_back({ tensor.offset, tensor.offset + size, tensor.name });
+    }
+
+    std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) { return a.begin < b.begin; });
+    for (size_t i = 1; i < spans.size(); i++) {
+        if (spans[i].begin < spans[i - 1].end)
+            return fail("Tensors " + std::string(spans[i - 1].name) + " and " + std::string(spans[i].name) + " overlap");
+    }
+
+    return true;
+}
+
+bool ModelVerifier::computeDigest(const std::string &path, DigestType type) {
+    error_.clear();
+    digest_.clear();
+
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+        return fail("Cannot open file: " + path);
+
+    switch (type) {
+    case DIGEST_SHA256:
+        return sequentialDigest(path, size);
+    case DIGEST_CHUNKED_SHA256:
+        return chunkedDigest(path, size);
+    default:
+        return fail("Unknown digest type");
+    }
+}
+
+bool ModelVerifier::verify(const std::string &path, DigestType type, const std::string &expectedDigest, bool tensors) {
+    digest_.clear();
+
+    // The tensor check only reads the header, a truncated file fails it without hashing gigabytes
+    if (tensors && !checkTensors(path))
+        return false;
+
+    if (type == DIGEST_NONE) {
+        error_.clear();
+        return true;
+    }
+
+    if (!computeDigest(path, type))
+        return false;
+
+    if (!expectedDigest.empty() && normalizedDigest(expectedDigest) != digest_)
+        return fail("Digest mismatch: expected " + normalizedDigest(expectedDigest) + ", got " + digest_);
+    return true;
+}
+
+// Reads the next block on a second thread while the current one is hashed
+bool ModelVerifier::sequentialDigest(const std::string &path, uint64_t size) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return fail("Cannot open file: " + path);
+
+    std::vector<char> buffers[2] = { std::vector<char>(readSize), std::vector<char>(readSize) };
+    auto readBlock = [&file](std::vector<char> *buffer) -> size_t {
+        file.read(buffer->data(), buffer->size());
+        return (size_t)file.gcount();
+    };
+
+    Sha256 sha;
+    uint64_t hashed = 0;
+    std::future<size_t> pending = std::async(std::launch::async, readBlock, &buffers[0]);
+    for (int current = 0;; current ^= 1) {
+        const size_t count = pending.get();
+        if (count == 0)
+            break;
+
+        pending = std::async(std::launch::async, readBlock, &buffers[current ^ 1]);
+        sha.update(buffers[current].data(), count);
+        hashed += count;
+
+        if (!reportProgress(hashed, size)) {
+            pending.wait();
+            return fail("Verification cancelled");
+        }
+    }
+
+    if (file.bad() || hashed != size)
+        return fail("Read error while hashing " + path);
+
+    uint8_t digest[Sha256::digestSize];
+    sha.finish(digest);
+    digest_ = Sha256::toHex(digest);
+    return true;
+}
+
+// Hashes fixed chunks on every core, each task reading its own range of the file
+bool ModelVerifier::chunkedDigest(const std::string &path, uint64_t size) {
+    const size_t chunkCount = (size_t)((size + chunkSize - 1) / chunkSize);
+    std::vector<uint8_t> chunkDigests(chunkCount * Sha256::digestSize);
+
+    std::atomic<uint64_t> hashed{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+
+    if (chunkCount > 0) {
+        ThreadPool pool((unsigned)std::min<size_t>(chunkCount, std::max(1u, std::thread::hardware_concurrency())));
+        pool.run(chunkCount, [&](size_t chunk) {
+            if (cancelled || failed)
+                return;
+
+            std::ifstream file(path, std::ios::binary);
+            file.seekg((std::streamoff)(chunk * chunkSize));
+            if (!file) {
+                failed = true;
+                return;
+            }
+
+            std::vector<char> buffer(readSize);
+            uint64_t remaining = std::min(chunkSize, size - chunk * chunkSize);
+            Sha256 sha;
+            while (remaining > 0) {
+                file.read(buffer.data(), (std::streamsize)std::min<uint64_t>(buffer.size(), remaining));
+                const size_t count = (size_t)file.gcount();
+                if (count == 0) {
+                    failed = true;
+                    return;
+                }
+
+                sha.update(buffer.data(), count);
+                remaining -= count;
+
+                if (!reportProgress(hashed += count, size))
+                    cancelled = true;
+                if (cancelled || failed)
+                    return;
+            }
+            sha.finish(&chunkDigests[chunk * Sha256::digestSize]);
+        });
+    }
+
+    if (cancelled)
+        return fail("Verification cancelled");
+    if (failed)
+        return fail("Read error while hashing " + path);
+
+    Sha256 sha;
+    sha.update(chunkDigests.data(), chunkDigests.size());
+    uint8_t digest[Sha256::digestSize];
+    sha.finish(digest);
+    digest_ = Sha256::toHex(digest);
+    return true;
+}
+
+bool ModelVerifier::reportProgress(uint64_t hashed, uint64_t size) {
+    if (!progressCallback)
+        return true;
+
+    std::lock_guard<std::mutex> lock(progressMutex);
+    return progressCallback(size > 0 ? (float)((double)hashed / (double)size) : 1.0f);
+}
+
+bool ModelVerifier::fail(const std::string &message) {
+    error_ = message;
+    return false;
+}
@@ -0,0 +1,83 @@
+#ifndef ModelVerifier_h
+#define ModelVerifier_h
+
+#include <string>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * @brief Checks that a GGUF file is complete and intact before it is loaded.
+ *
+ * Two checks are available. The tensor check walks the tensor infos of the
+ * header and verifies that every tensor has a known type, is aligned and lies
+ * inside the file without overlapping another one; a truncated download fails
+ * it after reading only the header. The digest check hashes the whole file
+ * and compares it with a known digest.
+ *
+ * SHA-256 of a whole file is inherently sequential, so DIGEST_SHA256 overlaps
+ * reading with hashing on two threads. DIGEST_CHUNKED_SHA256 hashes 64 MB chunks
+ * in parallel on every core and hashes the concatenated chunk digests; it is
+ * not comparable with a plain SHA-256 such as the one published on Hugging
+ * Face, it is meant for digests recorded locally by a previous verification.
+ */
+class ModelVerifier {
+public:
+    enum DigestType {
+        DIGEST_NONE,           ///< No digest, verify only runs the tensor check.
+        DIGEST_SHA256,         ///< SHA-256 of the file, matches sha256sum.
+        DIGEST_CHUNKED_SHA256  ///< SHA-256 over the SHA-256 of each 64 MB chunk, computed in parallel.
+    };
+
+    /**
+     * @brief Receives the fraction of the file hashed, returns false to cancel.
+     *
+     * Called from the hashing threads, never concurrently.
+     */
+    typedef std::function<bool(float progress)> ProgressCallback;
+
+    static const uint64_t chunkSize = 64ull * 1024 * 1024;
+
+    void setProgressCallback(ProgressCallback callback) { progressCallback = std::move(callback); }
+
+    /**
+     * @brief Checks the bounds, alignment and types of the tensors in a GGUF file.
+     * @param path Path to the GGUF file.
+     * @return True if every tensor is valid, false otherwise, see error().
+     */
+    bool checkTensors(const std::string &path);
+
+    /**
+     * @brief Hashes a file.
+     * @param path Path to the file.
+     * @param type The digest to compute.
+     * @return True on success, the hex digest is available from digest().
+     */
+    bool computeDigest(const std::string &path, DigestType type);
+
+    /**
+     * @brief Runs the tensor check and computes the digest, comparing it with an expected one.
+     * @param path Path to the GGUF file.
+     * @param type The digest to compute, DIGEST_NONE to skip hashing.
+     * @param expectedDigest Hex digest to compare with, empty to only compute it.
+     * @param tensors Also run checkTensors, before hashing.
+     * @return True if every requested check passed.
+     */
+    bool verify(const std::string &path, DigestType type, const std::string &expectedDigest, bool tensors);
+
+    const std::string &digest() const { return digest_; }
+    const std::string &error() const { return error_; }
+
+private:
+    bool sequentialDigest(const std::string &path, uint64_t size);
+    bool chunkedDigest(const std::string &path, uint64_t size);
+    bool reportProgress(uint64_t hashed, uint64_t size);
+    bool fail(const std::string &message);
+
+    ProgressCallback progressCallback;
+    std::mutex progressMutex;
+    std::string digest_;
+    std::string error_;
+};
+
+#endif // ModelVerifier_h
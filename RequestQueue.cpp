@@ -0,0 +1,99 @@
+#include "RequestQueue.h"
+
+#include <cmath>
+
+void RequestQueue::setLimits(size_t depth, int waitMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxDepth = depth;
+    maxWaitMs = waitMs;
+}
+
+size_t RequestQueue::waiting() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto &queue : queues)
+        count += queue.size();
+    return count;
+}
+
+// The ticket is next when no request holds the engine and it heads the highest non-empty class
+bool RequestQueue::isNext(RequestPriority priority, uint64_t ticket) const {
+    if (busy)
+        return false;
+
+    for (int p = 0; p < (int)priority; p++) {
+        if (!queues[p].empty())
+            return false;
+    }
+    return queues[(int)priority].front() == ticket;
+}
+
+void RequestQueue::acquire(RequestPriority priority, uint64_t ticket, std::unique_lock<std::mutex> &lock, bool first) {
+    if (first)
+        queues[(int)priority].push_front(ticket);
+    else
+        queues[(int)priority].push_back(ticket);
+    turn.wait(lock, [&] { return isNext(priority, ticket); });
+
+    queues[(int)priority].pop_front();
+    busy = true;
+    busySince = std::chrono::steady_clock::now();
+}
+
+void RequestQueue::release(RequestPriority priority) {
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - busySince).count();
+
+    // Background work runs for minutes between yields and would skew the wait estimate
+    if (priority != RequestPriority::Background)
+        averageServiceMs = averageServiceMs == 0.0 ? elapsedMs : 0.8 * averageServiceMs + 0.2 * elapsedMs;
+
+    busy = false;
+    turn.notify_all();
+}
+
+bool RequestQueue::enter(RequestPriority priority, std::string &error) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    size_t depth = 0;
+    size_t ahead = busy ? 1 : 0;
+    for (int p = 0; p < priorityCount; p++) {
+        depth += queues[p].size();
+        if (p <= (int)priority)
+            ahead += queues[p].size();
+    }
+
+    if (maxDepth > 0 && depth >= maxDepth) {
+        error = "Error: Request queue is full (" + std::to_string(depth) + " requests waiting)";
+        return false;
+    }
+
+    const double expectedWaitMs = ahead * averageServiceMs;
+    if (maxWaitMs > 0 && ahead > 0 && expectedWaitMs > maxWaitMs) {
+        error = "Error: Expected wait of " + std::to_string((long)std::lround(expectedWaitMs)) +
+                " ms exceeds the limit of " + std::to_string(maxWaitMs) + " ms";
+        return false;
+    }
+
+    acquire(priority, nextTicket++, lock);
+    return true;
+}
+
+void RequestQueue::leave(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    release(priority);
+}
+
+void RequestQueue::yield(RequestPriority priority) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    bool higherWaiting = false;
+    for (int p = 0; p < (int)priority; p++)
+        higherWaiting = higherWaiting || !queues[p].empty();
+    if (!higherWaiting)
+        return;
+
+    release(priority);
+
+    // Re-queue ahead of requests of the same class, admission limits do not apply to a request already running
+    acquire(priority, nextTicket++, lock, true);
+}
@@ -0,0 +1,130 @@
+#ifndef RequestQueue_h
+#define RequestQueue_h
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Priority class of an engine request, lower values are served first.
+ */
+enum class RequestPriority {
+    Interactive = 0, ///< A user is waiting on the response.
+    Normal = 1,      ///< Default for programmatic requests.
+    Background = 2   ///< Batch jobs, yield to every other request.
+};
+
+/**
+ * @brief Serialises engine requests by priority with admission control.
+ *
+ * The engine serves one request at a time. Waiting requests are queued per
+ * priority class and served highest priority first, FIFO within a class. A
+ * request is rejected immediately when the queue is full or when its expected
+ * wait, estimated from the average service time of recent requests, exceeds
+ * the configured limit. Long background work calls yield() between steps to
+ * let waiting requests of a higher priority run first.
+ */
+class RequestQueue {
+public:
+    /**
+     * @brief Holds the engine for the lifetime of the scope.
+     */
+    class Scope {
+    public:
+        /**
+         * @brief Waits for the request's turn.
+         * @param queue The queue.
+         * @param priority Priority of the request.
+         */
+        Scope(RequestQueue &queue, RequestPriority priority)
+            : queue(queue), priority(priority) {
+            admitted = queue.enter(priority, error);
+        }
+
+        ~Scope() {
+            if (admitted)
+                queue.leave(priority);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        /**
+         * @brief Returns true if the request was admitted and holds the engine.
+         */
+        bool isAdmitted() const { return admitted; }
+
+        /**
+         * @brief Returns the reason the request was rejected.
+         */
+        const std::string &getError() const { return error; }
+
+        /**
+         * @brief Lets waiting requests of a higher priority run, then takes the engine back.
+         */
+        void yield() {
+            if (admitted)
+                queue.yield(priority);
+        }
+
+    private:
+        RequestQueue &queue;
+        RequestPriority priority;
+        bool admitted = false;
+        std::string error;
+    };
+
+    /**
+     * @brief Sets the admission limits.
+     * @param maxDepth Maximum number of waiting requests, 0 for no limit.
+     * @param maxWaitMs Maximum expected wait in milliseconds, 0 for no limit.
+     */
+    void setLimits(size_t maxDepth, int maxWaitMs);
+
+    /**
+     * @brief Waits until the request may use the engine.
+     * @param priority Priority of the request.
+     * @param error Receives the reason of a rejection.
+     * @return True once the request holds the engine, false if it was rejected.
+     */
+    bool enter(RequestPriority priority, std::string &error);
+
+    /**
+     * @brief Releases the engine to the next waiting request.
+     * @param priority Priority the request entered with.
+     */
+    void leave(RequestPriority priority);
+
+    /**
+     * @brief Hands the engine to waiting requests of a higher priority, if any.
+     * @param priority Priority of the request yielding.
+     */
+    void yield(RequestPriority priority);
+
+    /**
+     * @brief Returns the number of waiting requests.
+     */
+    size_t waiting() const;
+
+private:
+    static const int priorityCount = 3;
+
+    bool isNext(RequestPriority priority, uint64_t ticket) const;
+    void release(RequestPriority priority);
+    void acquire(RequestPriority priority, uint64_t ticket, std::unique_lock<std::mutex> &lock, bool first = false);
+
+    mutable std::mutex mutex;
+    std::condition_variable turn;
+    std::deque<uint64_t> queues[priorityCount]; ///< Waiting tickets per priority.
+    uint64_t nextTicket = 0;
+    bool busy = false;                          ///< True while a request holds the engine.
+    std::chrono::steady_clock::time_point busySince;
+    double averageServiceMs = 0.0;              ///< Moving average of foreground service times.
+    size_t maxDepth = 64;
+    int maxWaitMs = 0;
+};
+
+#endif // RequestQueue_h
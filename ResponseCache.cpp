@@ -0,0 +1,78 @@
+#include "ResponseCache.h"
+
+#include <iterator>
+
+void ResponseCache::setLimits(size_t entryLimit, size_t byteLimit, int ttl) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxEntries = entryLimit;
+    maxBytes = byteLimit;
+    ttlSeconds = ttl;
+    evict();
+}
+
+bool ResponseCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxEntries > 0;
+}
+
+bool ResponseCache::lookup(const std::string &key, std::string &response, FinishReason &reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = index.find(hash(key));
+    if (found == index.end())
+        return false;
+
+    auto it = found->second;
+    if (it->key != key)
+        return false; // hash collision, the other request keeps its entry
+
+    if (ttlSeconds > 0 && std::chrono::steady_clock::now() >= it->expires) {
+        erase(it);
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it);
+    response = it->response;
+    reason = it->reason;
+    return true;
+}
+
+void ResponseCache::store(const std::string &key, const std::string &response, FinishReason reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (maxEntries == 0)
+        return;
+
+    const uint64_t keyHash = hash(key);
+    auto found = index.find(keyHash);
+    if (found != index.end())
+        erase(found->second);
+
+    const size_t size = key.size() + response.size();
+    if (maxBytes > 0 && size > maxBytes)
+        return;
+
+    entries.push_front({ keyHash, key, response, reason,
+                         std::chrono::steady_clock::now() + std::chrono::seconds(ttlSeconds) });
+    index[keyHash] = entries.begin();
+    bytes += size;
+    evict();
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+void ResponseCache::erase(std::list<Entry>::iterator it) {
+    bytes -= it->key.size() + it->response.size();
+    index.erase(it->hash);
+    entries.erase(it);
+}
+
+// Drops least recently used entries until the cache is within its limits
+void ResponseCache::evict() {
+    while (!entries.empty() && (entries.size() > maxEntries || (maxBytes > 0 && bytes > maxBytes)))
+        erase(std::prev(entries.end()));
+}
@@ -0,0 +1,93 @@
+#ifndef ResponseCache_h
+#define ResponseCache_h
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "GenerationOptions.h"
+
+/**
+ * @brief Least recently used cache of complete responses keyed by request identity.
+ *
+ * Keys are opaque strings describing everything that determines a response:
+ * model, sampler and generation options, the context already in the KV cache
+ * and the prompt. Only deterministic requests may be cached, the caller decides
+ * which ones are. Entries are evicted least recently used first when the entry
+ * or byte limit is reached, and expire after the time to live.
+ */
+class ResponseCache {
+public:
+    /**
+     * @brief Returns the 64 bit FNV-1a hash of data, chained from a previous hash.
+     * @param data The bytes to hash.
+     * @param hash The previous hash, or the FNV offset basis to start a new one.
+     */
+    static uint64_t hash(const std::string &data, uint64_t hash = 14695981039346656037ull) {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Sets the cache bounds, evicting entries beyond them.
+     * @param maxEntries Maximum number of cached responses, 0 disables the cache.
+     * @param maxBytes Maximum size of keys and responses together, 0 for no limit.
+     * @param ttlSeconds Lifetime of an entry in seconds, 0 for no expiry.
+     */
+    void setLimits(size_t maxEntries, size_t maxBytes, int ttlSeconds);
+
+    /**
+     * @brief Returns true if responses are cached.
+     */
+    bool enabled() const;
+
+    /**
+     * @brief Looks up a response and marks it as recently used.
+     * @param key The request key.
+     * @param response Receives the cached response.
+     * @param reason Receives the cached finish reason.
+     * @return True on a hit, false on a miss or expired entry.
+     */
+    bool lookup(const std::string &key, std::string &response, FinishReason &reason);
+
+    /**
+     * @brief Stores a response, replacing an entry with the same key.
+     * @param key The request key.
+     * @param response The complete response.
+     * @param reason Why the generation ended.
+     */
+    void store(const std::string &key, const std::string &response, FinishReason reason);
+
+    /**
+     * @brief Removes every entry.
+     */
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        std::string response;
+        FinishReason reason;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    void erase(std::list<Entry>::iterator it);
+    void evict();
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries;                                        ///< Most recently used first.
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;  ///< Entries by key hash.
+    size_t bytes = 0;
+    size_t maxEntries = 0;
+    size_t maxBytes = 0;
+    int ttlSeconds = 0;
+};
+
+#endif // ResponseCache_h
@@ -0,0 +1,149 @@
+#include "SamplerKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+bool byLogit(const llama_token_data &a, const llama_token_data &b) {
+    return a.logit > b.logit;
+}
+
+struct TopKPContext {
+    int k;
+    float p;
+};
+
+const char *topKPName(const llama_sampler *) {
+    return "top-k-p";
+}
+
+void topKPApply(llama_sampler *smpl, llama_token_data_array *cur_p) {
+    const TopKPContext *ctx = (const TopKPContext *)smpl->ctx;
+    SamplerKernels::selectTopK(cur_p, ctx->k);
+    SamplerKernels::selectTopP(cur_p, ctx->p, 1);
+}
+
+llama_sampler *topKPClone(const llama_sampler *smpl) {
+    const TopKPContext *ctx = (const TopKPContext *)smpl->ctx;
+    return SamplerKernels::initTopKP(ctx->k, ctx->p);
+}
+
+void topKPFree(llama_sampler *smpl) {
+    delete (TopKPContext *)smpl->ctx;
+}
+
+const llama_sampler_i topKPInterface = {
+    topKPName,
+    nullptr,
+    topKPApply,
+    nullptr,
+    topKPClone,
+    topKPFree,
+};
+
+} // namespace
+
+llama_token SamplerKernels::argmax(const float *logits, int n) {
+    // Independent lanes carry no dependency between iterations, the compiler keeps them in vector registers
+    constexpr int lanes = 8;
+    float best[lanes];
+    int bestIndex[lanes];
+    for (int j = 0; j < lanes; j++) {
+        best[j] = -INFINITY;
+        bestIndex[j] = 0;
+    }
+
+    int i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        for (int j = 0; j < lanes; j++) {
+            const bool greater = logits[i + j] > best[j];
+            best[j] = greater ? logits[i + j] : best[j];
+            bestIndex[j] = greater ? i + j : bestIndex[j];
+        }
+    }
+
+    float value = best[0];
+    int index = bestIndex[0];
+    for (int j = 1; j < lanes; j++) {
+        if (best[j] > value || (best[j] == value && bestIndex[j] < index)) {
+            value = best[j];
+            index = bestIndex[j];
+        }
+    }
+
+    for (; i < n; i++) {
+        if (logits[i] > value) {
+            value = logits[i];
+            index = i;
+        }
+    }
+    return index;
+}
+
+void SamplerKernels::selectTopK(llama_token_data_array *cur_p, int k) {
+    if (k <= 0 || (size_t)k >= cur_p->size)
+        return;
+
+    // Linear partition around the k-th candidate, only the kept ones are sorted
+    if (!cur_p->sorted) {
+        llama_token_data *first = cur_p->data;
+        std::nth_element(first, first + k, first + cur_p->size, byLogit);
+        std::sort(first, first + k, byLogit);
+        cur_p->sorted = true;
+    }
+    cur_p->size = k;
+}
+
+void SamplerKernels::selectTopP(llama_token_data_array *cur_p, float p, size_t minKeep) {
+    const size_t n = cur_p->size;
+    if (p >= 1.0f || n == 0)
+        return;
+
+    llama_token_data *data = cur_p->data;
+
+    float maxLogit = data[0].logit;
+    if (!cur_p->sorted) {
+        for (size_t i = 1; i < n; i++)
+            maxLogit = std::max(maxLogit, data[i].logit);
+    }
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        sum += std::exp(data[i].logit - maxLogit);
+    const float target = p * sum;
+
+    // Sort the next most probable chunk only when the kept prefix reaches the end of the sorted part
+    size_t sortedCount = cur_p->sorted ? n : 0;
+    size_t chunk = 64;
+    float cumulative = 0.0f;
+    size_t kept = 0;
+    while (kept < n) {
+        if (kept == sortedCount) {
+            const size_t end = std::min(n, sortedCount + chunk);
+            if (end < n)
+                std::nth_element(data + sortedCount, data + end, data + n, byLogit);
+            std::sort(data + sortedCount, data + end, byLogit);
+            sortedCount = end;
+            chunk *= 4;
+        }
+
+        cumulative += std::exp(data[kept].logit - maxLogit);
+        kept++;
+        if (cumulative >= target && kept >= minKeep)
+            break;
+    }
+
+    cur_p->size = kept;
+    cur_p->sorted = true;
+}
+
+llama_sampler *SamplerKernels::initTopKP(int k, float p) {
+    return llama_sampler_init(&topKPInterface, new TopKPContext{ k, p });
+}
+
+bool SamplerKernels::isGreedy(const llama_sampler *chain) {
+    return llama_sampler_chain_n(chain) == 1 &&
+           std::strcmp(llama_sampler_name(llama_sampler_chain_get(chain, 0)), "greedy") == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef SamplerKernels_h
+#define SamplerKernels_h
+
+#include <cstddef>
+
+#include "llama.h"
+
+/**
+ * @brief Sampling kernels that avoid sorting the whole vocabulary.
+ *
+ * The generic llama.cpp samplers sort every candidate before top-p and before
+ * drawing from the distribution, which costs more than the rest of a decode step
+ * on small models with large vocabularies. These kernels find the argmax in a
+ * single pass over the logits and cut top-k and top-p with partial selection,
+ * leaving a short sorted prefix for the rest of the chain.
+ */
+class SamplerKernels {
+public:
+    /**
+     * @brief Returns the index of the largest logit, the first one on ties.
+     * @param logits The logits.
+     * @param n Number of logits.
+     */
+    static llama_token argmax(const float *logits, int n);
+
+    /**
+     * @brief Keeps the k most probable candidates, sorted by descending logit.
+     * @param cur_p The candidates, truncated in place.
+     * @param k Number of candidates to keep, 0 or less keeps all.
+     */
+    static void selectTopK(llama_token_data_array *cur_p, int k);
+
+    /**
+     * @brief Keeps the smallest prefix of candidates whose probability reaches p.
+     *
+     * The prefix is grown by partial selection, only the candidates that end up
+     * in it are sorted.
+     *
+     * @param cur_p The candidates, truncated in place and sorted by descending logit.
+     * @param p Probability mass to keep, 1.0 or more keeps all.
+     * @param minKeep Minimum number of candidates to keep.
+     */
+    static void selectTopP(llama_token_data_array *cur_p, float p, size_t minKeep);
+
+    /**
+     * @brief Creates a sampler applying selectTopK then selectTopP.
+     *
+     * Replaces the llama.cpp top-k and top-p samplers in a chain.
+     *
+     * @param k Number of candidates to keep, 0 or less to disable.
+     * @param p Probability mass to keep, 1.0 or more to disable.
+     * @return The new sampler, owned by the caller or the chain it is added to.
+     */
+    static llama_sampler *initTopKP(int k, float p);
+
+    /**
+     * @brief Returns true if the chain only holds a greedy sampler.
+     *
+     * The caller may then pick the argmax itself without building candidates.
+     */
+    static bool isGreedy(const llama_sampler *chain);
+};
+
+#endif // SamplerKernels_h
@@ -0,0 +1,47 @@
+#ifndef Sha256_h
+#define Sha256_h
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4).
+ */
+class Sha256 {
+public:
+    static const size_t digestSize = 32;
+
+    Sha256() { reset(); }
+
+    /**
+     * @brief Starts a new digest.
+     */
+    void reset();
+
+    /**
+     * @brief Hashes the next bytes of the message.
+     */
+    void update(const void *data, size_t size);
+
+    /**
+     * @brief Completes the digest, the object must be reset before hashing again.
+     * @param digest Receives the 32 byte digest.
+     */
+    void finish(uint8_t digest[digestSize]);
+
+    /**
+     * @brief Formats a digest as 64 lowercase hex characters.
+     */
+    static std::string toHex(const uint8_t digest[digestSize]);
+
+private:
+    void transform(const uint8_t *block);
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t length = 0;
+};
+
+#endif // Sha256_h
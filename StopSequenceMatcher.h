@@ -0,0 +1,104 @@
+#ifndef StopSequenceMatcher_h
+#define StopSequenceMatcher_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief Matches stop strings incrementally over a detokenized stream.
+ *
+ * Text is pushed piece by piece as tokens are generated. Bytes that could still
+ * be the start of a stop string are withheld until the following pieces confirm
+ * or rule out a match, so a stop string spanning several tokens never reaches
+ * the caller. Once a stop string is found the text before it is released and
+ * the matcher reports stopped.
+ */
+class StopSequenceMatcher {
+public:
+    /**
+     * @brief Constructs a matcher for a set of stop strings.
+     * @param stops The stop strings, empty strings are ignored.
+     */
+    explicit StopSequenceMatcher(const std::vector<std::string>& stops = {}) {
+        for (const auto& stop : stops) {
+            if (!stop.empty())
+                patterns.push_back(stop);
+        }
+    }
+
+    /**
+     * @brief Returns true if there are no stop strings to match.
+     */
+    bool empty() const { return patterns.empty(); }
+
+    /**
+     * @brief Returns true once a stop string has been matched.
+     */
+    bool stopped() const { return isStopped; }
+
+    /**
+     * @brief Feeds the next piece of generated text.
+     * @param text The detokenized piece.
+     * @return The text that is safe to emit, possibly empty.
+     */
+    std::string push(const std::string& text) {
+        if (isStopped)
+            return std::string();
+
+        if (patterns.empty())
+            return text;
+
+        pending += text;
+
+        // Earliest complete match wins
+        size_t matchPos = std::string::npos;
+        for (const auto& pattern : patterns) {
+            size_t pos = pending.find(pattern);
+            if (pos < matchPos)
+                matchPos = pos;
+        }
+
+        if (matchPos != std::string::npos) {
+            isStopped = true;
+            std::string output = pending.substr(0, matchPos);
+            pending.clear();
+            return output;
+        }
+
+        // Withhold the longest tail that is still a prefix of a stop string
+        size_t held = 0;
+        for (const auto& pattern : patterns) {
+            size_t maxLength = std::min(pattern.size() - 1, pending.size());
+            for (size_t length = maxLength; length > held; length--) {
+                if (pending.compare(pending.size() - length, length, pattern, 0, length) == 0) {
+                    held = length;
+                    break;
+                }
+            }
+        }
+
+        std::string output = pending.substr(0, pending.size() - held);
+        pending.erase(0, pending.size() - held);
+        return output;
+    }
+
+    /**
+     * @brief Releases withheld text when generation ends without a match.
+     * @return The withheld text, empty if a stop string was matched.
+     */
+    std::string flush() {
+        std::string output;
+        if (!isStopped)
+            output.swap(pending);
+        pending.clear();
+        return output;
+    }
+
+private:
+    std::vector<std::string> patterns; ///< Stop strings to match.
+    std::string pending;               ///< Withheld text that may start a stop string.
+    bool isStopped = false;            ///< True once a stop string was matched.
+};
+
+#endif // StopSequenceMatcher_h
@@ -0,0 +1,129 @@
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+/**
+ * @brief Fixed set of worker threads running indexed tasks in parallel.
+ *
+ * Workers are started once and sleep between jobs, so a job costs a wake-up
+ * instead of a thread creation. A job is a task count and a function called
+ * once per task index; workers take indices from a shared counter so uneven
+ * tasks balance themselves. The calling thread takes part in the job and
+ * run() returns when every task has finished. Jobs are serialised, run() may
+ * be called from several threads.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the workers.
+     * @param threads Number of threads running a job including the caller, 0 for the hardware concurrency.
+     */
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the number of threads running a job, including the caller.
+     */
+    unsigned size() const { return (unsigned)workers.size() + 1; }
+
+    /**
+     * @brief Runs task(0) ... task(count - 1) on the pool and waits for all of them.
+     * @param count Number of tasks.
+     * @param task Function called with each task index.
+     */
+    void run(size_t count, const std::function<void(size_t)> &task) {
+        if (count == 0)
+            return;
+
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            taskCount = count;
+            nextTask = 0;
+            pending = count;
+            generation++;
+        }
+        wake.notify_all();
+
+        runTasks(task);
+
+        // Workers still inside the job hold a pointer to the task, wait for them to leave
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0 && active == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runTasks(const std::function<void(size_t)> &task) {
+        size_t index;
+        while ((index = nextTask.fetch_add(1)) < taskCount) {
+            task(index);
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop() {
+        size_t seen = 0;
+        while (true) {
+            const std::function<void(size_t)> *task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || (job && generation != seen); });
+                if (stopping)
+                    return;
+                seen = generation;
+                task = job;
+                active++;
+            }
+            runTasks(*task);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0)
+                done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;                        ///< Serialises callers of run().
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)> *job = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask{0};
+    std::atomic<size_t> pending{0};
+    size_t generation = 0;
+    unsigned active = 0;                        ///< Workers inside the current job.
+    bool stopping = false;
+};
+
+#endif // ThreadPool_h